@@ -0,0 +1,115 @@
+#include <glmlv/BVH.hpp>
+#include <glmlv/load_obj.hpp>
+#include <glmlv/parallel.hpp>
+#include <glmlv/filesystem.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+// CPU benchmark of glmlv::SceneBVH: build time, then rays per second for primary rays and shadow rays.
+// Usage: bvh-benchmark [path/to/model.obj] [resolution]
+// The default model is the crytek-sponza scene of the forward-renderer assets.
+int main(int argc, char** argv)
+{
+    const auto appPath = glmlv::fs::path{ argv[0] };
+    const auto objPath = argc > 1 ? glmlv::fs::path{ argv[1] } : appPath.parent_path() / "assets" / "forward-renderer" / "models/crytek-sponza/sponza.obj";
+    const size_t resolution = argc > 2 ? std::stoul(argv[2]) : 512;
+
+    try {
+        glmlv::ObjData data;
+        glmlv::loadObjCached(objPath, data, false);
+
+        const auto buildStartTime = std::chrono::steady_clock::now();
+        const glmlv::SceneBVH bvh(data);
+        const auto buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStartTime).count();
+
+        // Primary rays through the six faces of a cube centered in the scene, then shadow rays from their hits towards a directional light
+        const auto center = 0.5f * (data.bboxMin + data.bboxMax);
+        const glm::vec3 faceAxes[6][3] = {
+            { glm::vec3(1, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0) },
+            { glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0) },
+            { glm::vec3(0, 1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1) },
+            { glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1) },
+            { glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0) },
+            { glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0) }
+        };
+        const auto rayCount = 6 * resolution * resolution;
+        const auto lightDirection = glm::normalize(glm::vec3(0.3f, 1.f, 0.2f));
+        const auto epsilon = 1e-4f * glm::length(data.bboxMax - data.bboxMin);
+
+        const auto primaryRay = [&](size_t ray)
+        {
+            const auto face = ray / (resolution * resolution);
+            const auto pixel = ray % (resolution * resolution);
+            const auto x = (2.f * (pixel % resolution) + 1.f) / resolution - 1.f;
+            const auto y = (2.f * (pixel / resolution) + 1.f) / resolution - 1.f;
+            return glmlv::Ray{ center, faceAxes[face][0] + x * faceAxes[face][1] + y * faceAxes[face][2] };
+        };
+
+        std::vector<glmlv::RayHit> hits(rayCount);
+        std::atomic<size_t> hitCount{ 0 }, occludedCount{ 0 };
+
+        const auto runPrimary = [&](size_t threadCount)
+        {
+            hitCount = 0;
+            const auto startTime = std::chrono::steady_clock::now();
+            glmlv::parallelFor(6 * resolution, [&](size_t row)
+            {
+                size_t rowHitCount = 0;
+                for (auto ray = row * resolution; ray < (row + 1) * resolution; ++ray)
+                {
+                    hits[ray] = glmlv::RayHit();
+                    rowHitCount += bvh.intersect(primaryRay(ray), hits[ray]) ? 1 : 0;
+                }
+                hitCount += rowHitCount;
+            }, threadCount);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        };
+
+        const auto runShadow = [&](size_t threadCount)
+        {
+            occludedCount = 0;
+            const auto startTime = std::chrono::steady_clock::now();
+            glmlv::parallelFor(6 * resolution, [&](size_t row)
+            {
+                size_t rowOccludedCount = 0;
+                for (auto ray = row * resolution; ray < (row + 1) * resolution; ++ray)
+                {
+                    if (hits[ray].t == std::numeric_limits<float>::max()) {
+                        continue;
+                    }
+                    const auto primary = primaryRay(ray);
+                    const glmlv::Ray shadowRay{ primary.origin + hits[ray].t * primary.direction + epsilon * lightDirection, lightDirection };
+                    rowOccludedCount += bvh.occluded(shadowRay, std::numeric_limits<float>::max()) ? 1 : 0;
+                }
+                occludedCount += rowOccludedCount;
+            }, threadCount);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        };
+
+        const auto threadCount = glmlv::defaultThreadCount();
+        const auto primarySingleTime = runPrimary(1);
+        const auto primaryTime = runPrimary(threadCount);
+        const auto shadowSingleTime = runShadow(1);
+        const auto shadowTime = runShadow(threadCount);
+
+        const auto megaRays = [](size_t count, double seconds)
+        {
+            return count / seconds * 1e-6;
+        };
+        std::cout << objPath << ": " << data.indexBuffer.size() / 3 << " triangles, " << data.indexCountPerShape.size() << " shapes" << std::endl;
+        std::cout << "BVH build: " << buildTime << " ms, " << bvh.triangleBVH().nodes().size() << " nodes" << std::endl;
+        std::cout << "Primary rays: " << rayCount << " (" << hitCount << " hits), "
+            << megaRays(rayCount, primarySingleTime) << " Mrays/s on 1 thread, " << megaRays(rayCount, primaryTime) << " Mrays/s on " << threadCount << " threads" << std::endl;
+        std::cout << "Shadow rays: " << hitCount << " (" << occludedCount << " occluded), "
+            << megaRays(hitCount, shadowSingleTime) << " Mrays/s on 1 thread, " << megaRays(hitCount, shadowTime) << " Mrays/s on " << threadCount << " threads" << std::endl;
+    }
+    catch (const std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,11 +1,14 @@
 #include "Application.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
 #include <imgui.h>
 #include <glmlv/imgui_impl_glfw_gl3.hpp>
 #include <glmlv/load_obj.hpp>
+#include <glmlv/quantize_geometry.hpp>
+#include <glmlv/frustum_culling.hpp>
 
 int Application::run()
 {
@@ -15,6 +18,7 @@ int Application::run()
     {
         const auto seconds = glfwGetTime();
         
+        m_readbackRing.update(); // Captures of previous iterations are passed to m_imageWriter
         
         
         // Rendering
@@ -23,71 +27,106 @@ int Application::run()
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_FBO);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
-        m_program.use();
-        
         glm::mat4 MVMatrix;
         glm::mat4 MVPMatrix;
         glm::mat4 NormalMatrix;
         
-        MVMatrix = m_viewController.getViewMatrix();
+        // Vertex positions are quantized: the dequantization matrix acts as model matrix, but it does not apply to normals
+        MVMatrix = m_viewController.getViewMatrix() * m_dequantizationMatrix;
         MVPMatrix = m_projectionMatrix * MVMatrix;
-        NormalMatrix = glm::transpose(glm::inverse(MVMatrix));
-        glUniformMatrix4fv(m_uModelViewMatrix, 1, GL_FALSE, &MVMatrix[0][0]);
-        glUniformMatrix4fv(m_uModelViewProjMatrix, 1, GL_FALSE, &MVPMatrix[0][0]);
-        glUniformMatrix4fv(m_uNormalMatrix, 1, GL_FALSE, &NormalMatrix[0][0]);
+        NormalMatrix = glm::transpose(glm::inverse(m_viewController.getViewMatrix()));
         
         m_directionalLightDir = glm::normalize(m_directionalLightDir);
         glm::vec3 directionnalLightDirViewSpace = glm::vec3(m_viewController.getViewMatrix() * glm::vec4(m_directionalLightDir, 0));
-        glUniform3fv(m_uDirectionalLightIntensity, 1, &m_directionalLightIntensity[0]);
-        glUniform3fv(m_uDirectionalLightDir, 1, &directionnalLightDirViewSpace[0]);
         
         glBindVertexArray(m_vaoModel);
         
-        for(GLuint i = 0; i < 4; ++i)
-            glBindSampler(i, m_sampler);
+        if (m_bindless) {
+            // Materials reference their textures by handle, no texture is bound
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_materialBuffer);
+        }
+        else {
+            // Every texture array is bound for the whole frame, to units 0 to m_textureArrays.arrayCount() - 1
+            m_textureArrays.bind(0, m_sampler);
+        }
         
-        glUniform1i(m_uSamplerKa, 0);
-        glUniform1i(m_uSamplerKd, 1);
-        glUniform1i(m_uSamplerKs, 2);
-        glUniform1i(m_uSamplerShininess, 3);
+        // Bounding boxes are in object space, before quantization
+        m_visibleShapes.assign(m_objData.indexCountPerShape.size(), 1);
+        m_visibleShapeCount = m_visibleShapes.size();
+        if (m_frustumCulling) {
+            const auto frustum = glmlv::extractFrustum(m_projectionMatrix * m_viewController.getViewMatrix());
+            m_visibleShapeCount = glmlv::cullBoxes(frustum, m_objData.bboxMinPerShape, m_objData.bboxMaxPerShape, m_visibleShapes);
+        }
         
-        auto indexOffset = 0;
-        int shape = 0; // num of current shape
-        for (const auto indexCount: m_objData.indexCountPerShape)
+        // Shapes are drawn by permutation of the geometry pass, so that each program is used once per frame
+        for (const auto & pass : m_geometryPasses)
         {
-            auto & material = m_objData.materialIDPerShape[shape] >= 0 ? 
-            m_objData.materials[m_objData.materialIDPerShape[shape]] : m_defaultMaterial;
+            auto & program = *pass.pProgram;
+            program.use();
+            program.setUniform(pass.uModelViewMatrix, MVMatrix);
+            program.setUniform(pass.uModelViewProjMatrix, MVPMatrix);
+            program.setUniform(pass.uNormalMatrix, NormalMatrix);
             
-            glUniform3fv(m_uKa, 1, &material.Ka[0]);
-            glUniform3fv(m_uKd, 1, &material.Kd[0]);
-            glUniform3fv(m_uKs, 1, &material.Ks[0]);
-            glUniform1f(m_uShininess, material.shininess);
-            
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, m_texIds[material.KaTextureId]);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, m_texIds[material.KdTextureId]);            
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, m_texIds[material.KsTextureId]);            
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, m_texIds[material.shininessTextureId]);
-            
-            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (const GLvoid*) (indexOffset * sizeof(GLuint)));
-            indexOffset += indexCount;
-            ++shape;
+            for (const auto shape : pass.shapes)
+            {
+                if (!m_visibleShapes[shape]) {
+                    continue;
+                }
+                
+                if (m_bindless) {
+                    // The default material follows the materials of the scene in m_materialBuffer
+                    const auto materialId = m_objData.materialIDPerShape[shape];
+                    program.setUniform(pass.uMaterialIndex, materialId >= 0 ? GLuint(materialId) : GLuint(m_objData.materials.size()));
+                }
+                else {
+                    auto & material = m_objData.materialIDPerShape[shape] >= 0 ? 
+                    m_objData.materials[m_objData.materialIDPerShape[shape]] : m_defaultMaterial;
+                    
+                    // Consecutive shapes often share their material: the program skips the values that did not change
+                    program.setUniform(pass.uKa, material.Ka);
+                    program.setUniform(pass.uKd, material.Kd);
+                    program.setUniform(pass.uKs, material.Ks);
+                    program.setUniform(pass.uShininess, material.shininess);
+                    
+                    const auto & KaLayer = m_textureLayers[material.KaTextureId];
+                    const auto & KdLayer = m_textureLayers[material.KdTextureId];
+                    const auto & KsLayer = m_textureLayers[material.KsTextureId];
+                    const auto & shininessLayer = m_textureLayers[material.shininessTextureId];
+                    program.setUniform(pass.uSamplerKa, KaLayer.array);
+                    program.setUniform(pass.uSamplerKd, KdLayer.array);
+                    program.setUniform(pass.uSamplerKs, KsLayer.array);
+                    program.setUniform(pass.uSamplerShininess, shininessLayer.array);
+                    program.setUniform(pass.uTextureLayers, glm::ivec4(KaLayer.layer, KdLayer.layer, KsLayer.layer, shininessLayer.layer));
+                }
+                
+                glDrawElements(GL_TRIANGLES, m_objData.indexCountPerShape[shape], GL_UNSIGNED_INT, (const GLvoid*) (m_indexOffsetPerShape[shape] * sizeof(GLuint)));
+            }
         }
         
-        for(GLuint i = 0; i < 4; ++i)
-            glBindSampler(i, 0);
+        if (m_bindless) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        }
+        else {
+            m_textureArrays.unbind(0);
+        }
         
         glBindVertexArray(0);
         
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        
+        if (m_dumpGBuffer) {
+            dumpGBuffer();
+            m_dumpGBuffer = false;
+        }
+        if (m_captureFrames && captureTexture(m_GBufferTextures[m_blitPass], m_AppPath.parent_path() / "captures" / (m_AppName + "-" + std::to_string(m_capturedFrameCount) + ".png"))) {
+            ++m_capturedFrameCount;
+        }
+        
         glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
         glReadBuffer(GL_COLOR_ATTACHMENT0 + m_blitPass);
         m_shadingProgram.use();
-        glUniform3fv(m_uDirectionalLightIntensity, 1, &m_directionalLightIntensity[0]);
-        glUniform3fv(m_uDirectionalLightDir, 1, &directionnalLightDirViewSpace[0]);
+        m_shadingProgram.setUniform(m_uDirectionalLightIntensity, m_directionalLightIntensity);
+        m_shadingProgram.setUniform(m_uDirectionalLightDir, directionnalLightDirViewSpace);
 //         glBlitFramebuffer(0, 0, m_nWindowWidth, m_nWindowHeight,
 //                           0, 0, m_nWindowWidth, m_nWindowHeight,
 //                           GL_COLOR_BUFFER_BIT, GL_LINEAR);
@@ -106,6 +145,10 @@ int Application::run()
             ImGui::SliderFloat3("dir dirlight", &m_directionalLightDir[0], -1, 1);
             ImGui::SliderFloat3("intensity dirlight", &m_directionalLightIntensity[0], 0., 1.);
             
+            ImGui::Checkbox("Frustum culling", &m_frustumCulling);
+            ImGui::Text("Shapes: %d drawn, %d culled", int(m_visibleShapeCount), int(m_visibleShapes.size() - m_visibleShapeCount));
+            ImGui::Text("Textures: %s", m_bindless ? "bindless handles" : "texture arrays");
+            
             ImGui::Text("Blit pass:");
             ImGui::RadioButton("GPosition", &m_blitPass, 0); ImGui::SameLine();
             ImGui::RadioButton("GNormal", &m_blitPass, 1); ImGui::SameLine();
@@ -113,6 +156,21 @@ int Application::run()
             ImGui::RadioButton("GDiffuse", &m_blitPass, 3); ImGui::SameLine();
             ImGui::RadioButton("GGlossyShininess", &m_blitPass, 4);
             
+            if (ImGui::Button("Dump G-buffer")) {
+                m_dumpGBuffer = true;
+            }
+            ImGui::SameLine();
+            if (ImGui::Checkbox("Capture frames", &m_captureFrames) && m_captureFrames) {
+                glmlv::fs::create_directories(m_AppPath.parent_path() / "captures");
+            }
+            const auto writerStatistics = m_imageWriter.statistics();
+            const auto & readbackStatistics = m_readbackRing.statistics();
+            ImGui::Text("%d images written, %d failed, %d queued", int(writerStatistics.writtenImageCount), int(writerStatistics.failedImageCount), int(m_imageWriter.queuedImageCount()));
+            if (readbackStatistics.readCount) {
+                ImGui::Text("Read backs: %d, %d dropped, %.3f ms each on the GL thread, %.1f ms latency", int(readbackStatistics.readCount), int(readbackStatistics.droppedCount),
+                    1000. * readbackStatistics.glThreadSeconds / readbackStatistics.readCount, 1000. * readbackStatistics.latencySeconds / readbackStatistics.readCount);
+            }
+            
             ImGui::End();
         }
         
@@ -149,11 +207,15 @@ m_viewController(m_GLFWHandle.window())
     
     glEnable(GL_DEPTH_TEST);
     
-    glmlv::loadObj(m_AssetsRootPath / m_AppName / "models/crytek-sponza/sponza.obj", m_objData);
+    glmlv::loadObjCached(m_AssetsRootPath / m_AppName / "models/crytek-sponza/sponza.obj", m_objData, false, true);
+    
+    // The G-buffer pass is bandwidth bound, so vertices are sent with the 16 bytes quantized format instead of the 32 bytes one
+    const auto quantizedGeometry = glmlv::quantizeGeometry(m_objData);
+    m_dequantizationMatrix = quantizedGeometry.dequantizationMatrix;
     
     glGenBuffers(1, &m_vboModel);
     glBindBuffer(GL_ARRAY_BUFFER, m_vboModel);
-    glBufferStorage(GL_ARRAY_BUFFER, m_objData.vertexBuffer.size() * sizeof(glmlv::Vertex3f3f2f), m_objData.vertexBuffer.data(), 0);
+    glBufferStorage(GL_ARRAY_BUFFER, quantizedGeometry.vertexBuffer.size() * sizeof(glmlv::Vertex4us2s2h), quantizedGeometry.vertexBuffer.data(), 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     
     glGenBuffers(1, &m_iboModel);
@@ -172,28 +234,101 @@ m_viewController(m_GLFWHandle.window())
     glEnableVertexAttribArray(VERTEX_ATTR_NORMAL);  
     glEnableVertexAttribArray(VERTEX_ATTR_UV);
     glBindBuffer(GL_ARRAY_BUFFER, m_vboModel);
-    glVertexAttribPointer(VERTEX_ATTR_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(glmlv::Vertex3f3f2f), (const GLvoid*) offsetof(glmlv::Vertex3f3f2f, position));
-    glVertexAttribPointer(VERTEX_ATTR_NORMAL,   3, GL_FLOAT, GL_FALSE, sizeof(glmlv::Vertex3f3f2f), (const GLvoid*) offsetof(glmlv::Vertex3f3f2f, normal));
-    glVertexAttribPointer(VERTEX_ATTR_UV,       2, GL_FLOAT, GL_FALSE, sizeof(glmlv::Vertex3f3f2f), (const GLvoid*) offsetof(glmlv::Vertex3f3f2f, texCoords));
+    glVertexAttribPointer(VERTEX_ATTR_POSITION, 4, GL_UNSIGNED_SHORT, GL_TRUE,  sizeof(glmlv::Vertex4us2s2h), (const GLvoid*) offsetof(glmlv::Vertex4us2s2h, position));
+    glVertexAttribPointer(VERTEX_ATTR_NORMAL,   2, GL_SHORT,          GL_TRUE,  sizeof(glmlv::Vertex4us2s2h), (const GLvoid*) offsetof(glmlv::Vertex4us2s2h, normal));
+    glVertexAttribPointer(VERTEX_ATTR_UV,       2, GL_HALF_FLOAT,     GL_FALSE, sizeof(glmlv::Vertex4us2s2h), (const GLvoid*) offsetof(glmlv::Vertex4us2s2h, texCoords));
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     
-    // init shader
-    m_program = glmlv::compileProgram({ m_ShadersRootPath / m_AppName / "/geometryPass.vs.glsl", m_ShadersRootPath / m_AppName / "/geometryPass.fs.glsl" });
-    m_uModelViewProjMatrix = glGetUniformLocation(m_program.glId(), "uModelViewProjMatrix");
-    m_uModelViewMatrix = glGetUniformLocation(m_program.glId(), "uModelViewMatrix");
-    m_uNormalMatrix = glGetUniformLocation(m_program.glId(), "uNormalMatrix");
-    m_uSamplerKa = glGetUniformLocation(m_program.glId(), "uSamplerKa ");
-    m_uSamplerKd = glGetUniformLocation(m_program.glId(), "uSamplerKd");
-    m_uSamplerKs = glGetUniformLocation(m_program.glId(), "uSamplerKs");
-    m_uSamplerShininess = glGetUniformLocation(m_program.glId(), "uSamplerShininess");
-    m_uKa = glGetUniformLocation(m_program.glId(), "uKa");
-    m_uKd = glGetUniformLocation(m_program.glId(), "uKd");
-    m_uKs = glGetUniformLocation(m_program.glId(), "uKs");
-    m_uShininess = glGetUniformLocation(m_program.glId(), "uShininess");
-    m_uDirectionalLightDir = glGetUniformLocation(m_program.glId(), "uDirectionalLightDir");
-    m_uDirectionalLightIntensity = glGetUniformLocation(m_program.glId(), "uDirectionalLightIntensity");
-    m_program.use();
+    // bindless textures when supported, unless --no-bindless is given (e.g. to compare with texture arrays); without GL_ARB_bindless_texture only
+    // the texture array path can run
+    auto bindlessDisabled = false;
+    for (auto i = 1; i < argc; ++i) {
+        bindlessDisabled = bindlessDisabled || std::string(argv[i]) == "--no-bindless";
+    }
+    m_bindless = !bindlessDisabled && glmlv::GLBindlessTextures::isSupported();
+    std::clog << "Textures: " << (m_bindless ? "bindless handles" : "texture arrays") << std::endl;
+    
+    // init shaders: one permutation of the geometry pass for each combination of textures of the materials (and for the default material),
+    // compiled together so that the driver can compile them concurrently
+    m_indexOffsetPerShape.reserve(m_objData.indexCountPerShape.size());
+    auto indexOffset = size_t(0);
+    for (const auto indexCount : m_objData.indexCountPerShape) {
+        m_indexOffsetPerShape.push_back(indexOffset);
+        indexOffset += indexCount;
+    }
+    
+    m_geometryPassPermutations = glmlv::GLProgramPermutations({ m_ShadersRootPath / m_AppName / "/geometryPass.vs.glsl", m_ShadersRootPath / m_AppName / "/geometryPass.fs.glsl" });
+    const auto getMaterialDefines = [&](int32_t materialId)
+    {
+        glmlv::ShaderDefines defines;
+        if (m_bindless) {
+            defines.emplace_back("BINDLESS", "");
+        }
+        if (materialId >= 0)
+        {
+            // Before textureless materials point toward the white texture
+            const auto & material = m_objData.materials[materialId];
+            const std::pair<int32_t, const char *> textures[] = { { material.KaTextureId, "KA_TEXTURE" }, { material.KdTextureId, "KD_TEXTURE" },
+                { material.KsTextureId, "KS_TEXTURE" }, { material.shininessTextureId, "SHININESS_TEXTURE" } };
+            for (const auto & texture : textures) {
+                if (texture.first >= 0) {
+                    defines.emplace_back(texture.second, "");
+                }
+            }
+        }
+        return defines;
+    };
+    std::vector<glmlv::ShaderDefines> permutations;
+    for (size_t shape = 0; shape < m_objData.indexCountPerShape.size(); ++shape)
+    {
+        const auto defines = getMaterialDefines(m_objData.materialIDPerShape[shape]);
+        const auto it = std::find(begin(permutations), end(permutations), defines);
+        if (it == end(permutations))
+        {
+            permutations.push_back(defines);
+            m_geometryPasses.emplace_back();
+            m_geometryPasses.back().shapes.push_back(shape);
+        }
+        else {
+            m_geometryPasses[it - begin(permutations)].shapes.push_back(shape);
+        }
+    }
+    m_geometryPassPermutations.prepare(permutations);
+    for (size_t i = 0; i < permutations.size(); ++i)
+    {
+        auto & pass = m_geometryPasses[i];
+        pass.pProgram = &m_geometryPassPermutations.get(permutations[i]);
+        const auto & program = *pass.pProgram;
+        pass.uModelViewProjMatrix = program.getUniformLocation("uModelViewProjMatrix");
+        pass.uModelViewMatrix = program.getUniformLocation("uModelViewMatrix");
+        pass.uNormalMatrix = program.getUniformLocation("uNormalMatrix");
+        // Material uniforms required by the defines of the permutation are reported when missing, the others are not declared
+        const auto hasDefine = [&](const char * name)
+        {
+            return std::find_if(begin(permutations[i]), end(permutations[i]), [&](const std::pair<std::string, std::string> & define) { return define.first == name; }) != end(permutations[i]);
+        };
+        const auto getMaterialUniformLocation = [&](const char * name, bool required)
+        {
+            return required ? program.getUniformLocation(name) : program.findUniformLocation(name);
+        };
+        const auto bindless = hasDefine("BINDLESS");
+        const auto textureArrays = !bindless && (hasDefine("KA_TEXTURE") || hasDefine("KD_TEXTURE") || hasDefine("KS_TEXTURE") || hasDefine("SHININESS_TEXTURE"));
+        pass.uSamplerKa = getMaterialUniformLocation("uSamplerKa", !bindless && hasDefine("KA_TEXTURE"));
+        pass.uSamplerKd = getMaterialUniformLocation("uSamplerKd", !bindless && hasDefine("KD_TEXTURE"));
+        pass.uSamplerKs = getMaterialUniformLocation("uSamplerKs", !bindless && hasDefine("KS_TEXTURE"));
+        pass.uSamplerShininess = getMaterialUniformLocation("uSamplerShininess", !bindless && hasDefine("SHININESS_TEXTURE"));
+        pass.uTextureLayers = getMaterialUniformLocation("uTextureLayers", textureArrays);
+        pass.uMaterialIndex = getMaterialUniformLocation("uMaterialIndex", bindless);
+        pass.uKa = getMaterialUniformLocation("uKa", !bindless);
+        pass.uKd = getMaterialUniformLocation("uKd", !bindless);
+        pass.uKs = getMaterialUniformLocation("uKs", !bindless);
+        pass.uShininess = getMaterialUniformLocation("uShininess", !bindless);
+        program.checkUniformsLookedUp();
+    }
+    std::clog << m_geometryPasses.size() << " permutations of the geometry pass" << std::endl;
+    
+    m_shadingProgram = glmlv::compileProgram({ m_ShadersRootPath / m_AppName / "/shadingPass.vs.glsl", m_ShadersRootPath / m_AppName / "/shadingPass.fs.glsl" });
     
     // init matrices
     const auto sceneDiagonalSize = glm::length(m_objData.bboxMax - m_objData.bboxMin);
@@ -201,36 +336,38 @@ m_viewController(m_GLFWHandle.window())
     m_viewController.setSpeed(sceneDiagonalSize * 0.1f);
     m_viewController.setViewMatrix(glm::lookAt(glm::vec3(0, 0, 4), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)));
     
-    // textures
-    m_texIds = std::vector<GLuint>(m_objData.textures.size());
-    glGenTextures(m_texIds.size(), m_texIds.data());
-    for(auto i = 0; i < m_texIds.size(); ++i) {
-        glBindTexture(GL_TEXTURE_2D, m_texIds[i]);
-        auto & tex = m_objData.textures[i];
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, tex.width(), tex.height());
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex.width(), tex.height(), GL_RGBA, GL_UNSIGNED_BYTE, tex.data());
+    // samplers, created first since bindless handles are bound to them
+    glGenSamplers(1, &m_sampler);
+    glSamplerParameteri(m_sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glSamplerParameteri(m_sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);   
+    
+    // textures, block compressed and cached next to their images; with texture arrays, textures of the same format and size are packed in the layers of the same array
+    std::vector<glmlv::CompressedImage2D> textures(m_objData.texturePaths.size());
+    glmlv::readCompressedTextures(m_objData.texturePaths, [&](size_t textureId, glmlv::CompressedImage2D && texture)
+    {
+        textures[textureId] = std::move(texture);
+    });
+    // make textureless materials pointing toward the white texture, which follows the textures of the scene
+    textures.push_back(glmlv::compressImage(glmlv::Image2DRGBA(1, 1, 255, 255, 255, 255), glmlv::BlockFormat::BC1));
+    std::vector<GLuint64> textureHandles;
+    for(const auto & texture : textures) {
+        if (m_bindless) {
+            textureHandles.push_back(m_bindlessTextures.add(texture, m_sampler));
+        }
+        else {
+            m_textureLayers.push_back(m_textureArrays.add(texture));
+        }
     }
-    glGenTextures(1, &m_whiteTexture);
-    glBindTexture(GL_TEXTURE_2D, m_whiteTexture);
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB32F, 1, 1);
-    glm::vec4 white(1.f, 1.f, 1.f, 1.f);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_FLOAT, &white);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    const auto whiteTextureId = int32_t(textures.size() - 1);
+    textures.clear();
     
-    // make textureless materials pointing toward whiteTexture
-    m_texIds.push_back(m_whiteTexture);
     for(auto & material : m_objData.materials) {
-        if(material.KaTextureId < 0) material.KaTextureId = m_texIds.size() - 1;
-        if(material.KdTextureId < 0) material.KdTextureId = m_texIds.size() - 1;
-        if(material.KsTextureId < 0) material.KsTextureId = m_texIds.size() - 1;
-        if(material.shininessTextureId < 0) material.shininessTextureId = m_texIds.size() - 1;
+        if(material.KaTextureId < 0) material.KaTextureId = whiteTextureId;
+        if(material.KdTextureId < 0) material.KdTextureId = whiteTextureId;
+        if(material.KsTextureId < 0) material.KsTextureId = whiteTextureId;
+        if(material.shininessTextureId < 0) material.shininessTextureId = whiteTextureId;
     }
     
-    // samplers
-    glGenSamplers(1, &m_sampler);
-    glSamplerParameteri(m_sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glSamplerParameteri(m_sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);   
-    
     // lights
     m_directionalLightDir = glm::vec3(1, -1, 0);
     m_directionalLightIntensity = glm::vec3(1, 1, 1);
@@ -242,7 +379,16 @@ m_viewController(m_GLFWHandle.window())
     m_defaultMaterial.KaTextureId 
     = m_defaultMaterial.KdTextureId 
     = m_defaultMaterial.KsTextureId
-    = m_defaultMaterial.shininessTextureId = m_texIds.size() - 1;
+    = m_defaultMaterial.shininessTextureId = whiteTextureId;
+    
+    // materials of the bindless path, followed by the default material
+    if (m_bindless) {
+        const auto materials = glmlv::makeBindlessMaterials(m_objData.materials, m_defaultMaterial, textureHandles);
+        glGenBuffers(1, &m_materialBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+        glBufferStorage(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(glmlv::BindlessMaterial), materials.data(), 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
     
     
     // specific to deffered shading
@@ -273,9 +419,8 @@ m_viewController(m_GLFWHandle.window())
     }
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
     
-    m_shadingProgram = glmlv::compileProgram({ m_ShadersRootPath / m_AppName / "/shadingPass.vs.glsl", m_ShadersRootPath / m_AppName / "/shadingPass.fs.glsl" });
-    m_uDirectionalLightDir = glGetUniformLocation(m_shadingProgram.glId(), "uDirectionalLightDir");
-    m_uDirectionalLightIntensity = glGetUniformLocation(m_shadingProgram.glId(), "uDirectionalLightIntensity");
+    m_uDirectionalLightDir = m_shadingProgram.getUniformLocation("uDirectionalLightDir");
+    m_uDirectionalLightIntensity = m_shadingProgram.getUniformLocation("uDirectionalLightIntensity");
     
     
     float triangleBuffer[] = { -1, 1, 3, -1, -1, 3 };
@@ -293,11 +438,34 @@ m_viewController(m_GLFWHandle.window())
     glBindVertexArray(0);
 }
 
+void Application::dumpGBuffer()
+{
+    static const char * const textureNames[GDepth] = { "position", "normal", "ambient", "diffuse", "glossyShininess" };
+    const auto dumpsPath = m_AppPath.parent_path() / "dumps";
+    glmlv::fs::create_directories(dumpsPath);
+    for(int i = 0; i < GDepth; ++i) {
+        captureTexture(m_GBufferTextures[i], dumpsPath / (m_AppName + "-" + std::to_string(m_dumpCount) + "-" + textureNames[i] + ".png"));
+    }
+    ++m_dumpCount;
+}
+
+bool Application::captureTexture(GLuint texture, const glmlv::fs::path & path)
+{
+    // Components are clamped to [0, 1] by the conversion to 8 bits, as in the blit pass. Dropped when every buffer is used by a pending read
+    // or by an image not written yet.
+    return m_readbackRing.readTexture(texture, [this, path](glmlv::Image2DRGBA && image)
+    {
+        m_imageWriter.write(std::move(image), path, true); // The first row of OpenGL textures is the bottom one
+    });
+}
+
 Application::~Application()
 {
+    m_readbackRing.finish(); // The last captures, written before the destruction of m_imageWriter
+    
     glDeleteBuffers(1, &m_vboModel);
     glDeleteBuffers(1, &m_iboModel);
     glDeleteVertexArrays(1, &m_vaoModel);
-    
+    glDeleteBuffers(1, &m_materialBuffer);
 }
 
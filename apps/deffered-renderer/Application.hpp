@@ -3,11 +3,18 @@
 #include <glmlv/filesystem.hpp>
 #include <glmlv/GLFWHandle.hpp>
 #include <glmlv/GLProgram.hpp>
+#include <glmlv/GLProgramPermutations.hpp>
 #include <glmlv/simple_geometry.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glmlv/ViewController.hpp>
 #include <glmlv/Image2DRGBA.hpp>
 #include <glmlv/load_obj.hpp>
+#include <glmlv/texture_compression.hpp>
+#include <glmlv/GLTextureArrays.hpp>
+#include <glmlv/GLBindlessTextures.hpp>
+#include <glmlv/bindless_material.hpp>
+#include <glmlv/GLReadbackRing.hpp>
+#include <glmlv/ImageWriter.hpp>
 
 class Application
 {
@@ -17,6 +24,9 @@ public:
 
     int run();
 private:
+    void dumpGBuffer(); // Read back every color texture of the G-buffer
+    bool captureTexture(GLuint texture, const glmlv::fs::path & path); // Read back texture, written to a PNG file once delivered by m_readbackRing
+
     const size_t m_nWindowWidth = 1280;
     const size_t m_nWindowHeight = 720;
     glmlv::GLFWHandle m_GLFWHandle{ m_nWindowWidth, m_nWindowHeight, "Template" }; // Note: the handle must be declared before the creation of any object managing OpenGL resource (e.g. GLProgram, GLShader)
@@ -33,27 +43,43 @@ private:
            m_vboModel,
            m_iboModel;
            
-    // shader
-    glmlv::GLProgram m_program;
+    std::vector<size_t> m_indexOffsetPerShape;
+           
+    // shader, specialized for each material (see geometryPass.fs.glsl)
+    glmlv::GLProgramPermutations m_geometryPassPermutations;
+    struct GeometryPass // A permutation of the geometry pass, with the locations of its uniforms and the shapes drawn with it
+    {
+        glmlv::GLProgram * pProgram;
+        GLint uModelViewProjMatrix;
+        GLint uModelViewMatrix;
+        GLint uNormalMatrix;
+        GLint uSamplerKa,
+              uSamplerKd,
+              uSamplerKs,
+              uSamplerShininess;
+        GLint uTextureLayers;
+        GLint uKa,
+              uKd,
+              uKs,
+              uShininess;
+        GLint uMaterialIndex;
+        std::vector<size_t> shapes;
+    };
+    std::vector<GeometryPass> m_geometryPasses;
     
-    GLint m_uModelViewProjMatrix;
-    GLint m_uModelViewMatrix;
-    GLint m_uNormalMatrix;
     glm::mat4 m_projectionMatrix;
+    glm::mat4 m_dequantizationMatrix; // Model matrix of the quantized vertex positions
     
     // textures & materials
-    std::vector<GLuint> m_texIds;
+    glmlv::GLTextureArrays m_textureArrays; // Bound once per frame, shapes only select their arrays and layers with uniforms
+    std::vector<glmlv::GLTextureArrays::Layer> m_textureLayers; // Indexed by texture id, followed by the white layer
     GLuint m_sampler;
-    GLint m_uSamplerKa,
-          m_uSamplerKd,
-          m_uSamplerKs,
-          m_uSamplerShininess;
-    GLint m_uKa,
-          m_uKd,
-          m_uKs,
-          m_uShininess;
     glmlv::ObjData::PhongMaterial m_defaultMaterial;
-    GLuint m_whiteTexture;
+
+    // bindless path, used instead of texture arrays when GL_ARB_bindless_texture is supported (unless --no-bindless is given)
+    bool m_bindless = false;
+    glmlv::GLBindlessTextures m_bindlessTextures;
+    GLuint m_materialBuffer = 0; // Materials of the scene followed by the default material, bound to the shader storage binding 0
           
     // light
     GLint m_uDirectionalLightDir;
@@ -63,6 +89,11 @@ private:
     
     glmlv::ViewController m_viewController;
     
+    // frustum culling
+    bool m_frustumCulling = true;
+    std::vector<uint8_t> m_visibleShapes; // 1 for each shape intersecting the view frustum in the current frame
+    size_t m_visibleShapeCount = 0;
+    
     
     
      // specific to deffered shading
@@ -81,6 +112,16 @@ private:
     GLuint m_FBO;
     int m_blitPass = 1;
     
+    // G-buffer capture, in PNG files next to the executable; textures are read back without waiting for the GPU and written in the background
+    glmlv::GLReadbackRing m_readbackRing{ 2 * GDepth, m_nWindowWidth * m_nWindowHeight * glmlv::Image2DRGBA::NumComponents }; // Room for two dumps
+    // Declared after m_readbackRing, so that images still borrowing its buffers are written before its destruction. As many images as read back
+    // buffers: when writing is slower than rendering, captures are dropped by the readback ring instead of waiting for the writer.
+    glmlv::ImageWriter m_imageWriter{ 2 * GDepth };
+    bool m_dumpGBuffer = false;
+    bool m_captureFrames = false; // Capture the texture of the blit pass every frame
+    size_t m_dumpCount = 0;
+    size_t m_capturedFrameCount = 0;
+    
     glmlv::GLProgram m_shadingProgram;
     
     GLuint m_vaoTriangleBuffer,
@@ -1,4 +1,14 @@
-#version 330 core
+#version 430 core
+
+// Permutations, specialized for each material by its defines:
+// BINDLESS: material read from the material buffer, with bindless textures, instead of uniforms with texture arrays
+// KA_TEXTURE, KD_TEXTURE, KS_TEXTURE, SHININESS_TEXTURE: the material has the texture, without it the factor is used alone
+
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#include "../glmlv/bindless_material.glsl"
+uniform uint uMaterialIndex;
+#endif
 
 in vec3 vViewSpacePosition;
 in vec3 vViewSpaceNormal;
@@ -10,20 +20,59 @@ layout(location = 2) out vec3 fAmbient;
 layout(location = 3) out vec3 fDiffuse;
 layout(location = 4) out vec4 fGlossyShininess;
 
-uniform sampler2D uSamplerKa;
-uniform sampler2D uSamplerKd;
-uniform sampler2D uSamplerKs;
-uniform sampler2D uSamplerShininess;
+#ifdef BINDLESS
+#define TEXTURE_KA vec3(texture(sampler2D(material.textures[0]), vTexCoords))
+#define TEXTURE_KD vec3(texture(sampler2D(material.textures[1]), vTexCoords))
+#define TEXTURE_KS vec3(texture(sampler2D(material.textures[2]), vTexCoords))
+#define TEXTURE_SHININESS vec3(texture(sampler2D(material.textures[3]), vTexCoords))
+#else
+uniform sampler2DArray uSamplerKa;
+uniform sampler2DArray uSamplerKd;
+uniform sampler2DArray uSamplerKs;
+uniform sampler2DArray uSamplerShininess;
+uniform ivec4 uTextureLayers; // Layers of Ka, Kd, Ks and shininess textures in their arrays
 
 uniform vec3 uKa;
 uniform vec3 uKd;
 uniform vec3 uKs;
 uniform float uShininess;
 
+#define TEXTURE_KA vec3(texture(uSamplerKa, vec3(vTexCoords, uTextureLayers[0])))
+#define TEXTURE_KD vec3(texture(uSamplerKd, vec3(vTexCoords, uTextureLayers[1])))
+#define TEXTURE_KS vec3(texture(uSamplerKs, vec3(vTexCoords, uTextureLayers[2])))
+#define TEXTURE_SHININESS vec3(texture(uSamplerShininess, vec3(vTexCoords, uTextureLayers[3])))
+#endif
+
 void main() {
+#ifdef BINDLESS
+    Material material = uMaterials[uMaterialIndex];
+    vec3 ambient = material.Ka.xyz;
+    vec3 diffuse = material.Kd.xyz;
+    vec3 glossy = material.KsShininess.xyz;
+    float shininess = material.KsShininess.w;
+#else
+    vec3 ambient = uKa;
+    vec3 diffuse = uKd;
+    vec3 glossy = uKs;
+    float shininess = uShininess;
+#endif
+    float glossyShininess = shininess;
+#ifdef KA_TEXTURE
+    ambient *= TEXTURE_KA;
+#endif
+#ifdef KD_TEXTURE
+    diffuse *= TEXTURE_KD;
+#endif
+#ifdef KS_TEXTURE
+    glossy *= TEXTURE_KS;
+#endif
+#ifdef SHININESS_TEXTURE
+    glossyShininess *= TEXTURE_SHININESS.x;
+#endif
+
     fPosition = vViewSpacePosition;
     fNormal = normalize(vViewSpaceNormal);
-    fAmbient = uKa * vec3(texture(uSamplerKa, vTexCoords));
-    fDiffuse = uKd * vec3(texture(uSamplerKd, vTexCoords));
-    fGlossyShininess = vec4(uShininess * vec3(texture(uSamplerKs, vTexCoords)), uShininess * vec3(texture(uSamplerShininess, vTexCoords)));
+    fAmbient = ambient;
+    fDiffuse = diffuse;
+    fGlossyShininess = vec4(glossy, glossyShininess);
 }
@@ -1,7 +1,8 @@
 #version 330 core
 
-layout(location = 0) in vec3 aPosition;
-layout(location = 1) in vec3 aNormal;
+// Quantized vertex attributes (glmlv::Vertex4us2s2h), all normalized by the vertex fetch except texture coordinates
+layout(location = 0) in vec4 aPosition; // In [0, 1] relative to the scene bounding box, w = 1
+layout(location = 1) in vec2 aNormal; // Octahedral encoding
 layout(location = 2) in vec2 aTexCoords;
 
 uniform mat4 uModelViewProjMatrix;
@@ -12,9 +13,18 @@ out vec3 vViewSpacePosition;
 out vec3 vViewSpaceNormal;
 out vec2 vTexCoords;
 
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0) {
+        n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0 ? 1.0 : -1.0, e.y >= 0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
 void main() {
-    vec4 position = vec4(aPosition, 1);
-    vec4 normal = vec4(aNormal, 0);
+    vec4 position = aPosition;
+    vec4 normal = vec4(octahedralDecode(aNormal), 0);
     
     vViewSpacePosition = vec3(uModelViewMatrix * position);
     vViewSpaceNormal = vec3(uNormalMatrix * normal);
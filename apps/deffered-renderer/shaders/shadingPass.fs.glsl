@@ -1,5 +1,7 @@
 #version 330 core
 
+#include "../glmlv/phong.glsl"
+
 uniform sampler2D uGPosition;
 uniform sampler2D uGNormal;
 uniform sampler2D uGAmbient;
@@ -19,9 +21,5 @@ void main() {
     vec3 glossy   = vec3(texelFetch(uGlossyShininess, ivec2(gl_FragCoord.xy), 0));
     float shininess = float(texelFetch(uGlossyShininess, ivec2(gl_FragCoord.xy), 0).w);
 
-
-    vec3 halfVector = 0.5 * (uDirectionalLightDir + position);
-    fColor = uDirectionalLightIntensity * (
-             diffuse * max(0.0, dot(normal, uDirectionalLightDir))
-             + glossy * pow(max(0, dot(halfVector, normal)), shininess));
+    fColor = directionalLightPhong(uDirectionalLightDir, uDirectionalLightIntensity, position, normal, diffuse, glossy, shininess);
 }
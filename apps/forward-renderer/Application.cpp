@@ -1,10 +1,14 @@
 #include "Application.hpp"
 
 #include <iostream>
+#include <algorithm>
+#include <stdexcept>
 
 #include <imgui.h>
 #include <glmlv/imgui_impl_glfw_gl3.hpp>
 #include <glmlv/load_obj.hpp>
+#include <glmlv/mesh_optimizer.hpp>
+#include <glmlv/frustum_culling.hpp>
 
 int Application::run()
 {
@@ -14,68 +18,89 @@ int Application::run()
     {
         const auto seconds = glfwGetTime();
 
+        processLoadingEvents();
+        m_readbackRing.update(); // Captured frames of previous iterations are passed to m_imageWriter
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Rendering
         
         
-        glm::mat4 MVMatrix;
-        glm::mat4 MVPMatrix;
-        glm::mat4 NormalMatrix;
-        
-        MVMatrix = m_viewController.getViewMatrix();
-        MVPMatrix = m_projectionMatrix * MVMatrix;
-        NormalMatrix = glm::transpose(glm::inverse(MVMatrix));
-        glUniformMatrix4fv(m_uModelViewMatrix, 1, GL_FALSE, &MVMatrix[0][0]);
-        glUniformMatrix4fv(m_uModelViewProjMatrix, 1, GL_FALSE, &MVPMatrix[0][0]);
-        glUniformMatrix4fv(m_uNormalMatrix, 1, GL_FALSE, &NormalMatrix[0][0]);
+        // Every uniform of the frame in one upload, shapes only change the base instance of their draws
+        FrameUniforms frameUniforms;
+        frameUniforms.uModelViewMatrix = m_viewController.getViewMatrix();
+        frameUniforms.uModelViewProjMatrix = m_projectionMatrix * frameUniforms.uModelViewMatrix;
+        frameUniforms.uNormalMatrix = glm::transpose(glm::inverse(frameUniforms.uModelViewMatrix));
         
         m_directionalLightDir = glm::normalize(m_directionalLightDir);
-        glm::vec3 directionnalLightDirViewSpace = glm::vec3(m_viewController.getViewMatrix() * glm::vec4(m_directionalLightDir, 0));
-        glUniform3fv(m_uDirectionalLightIntensity, 1, &m_directionalLightIntensity[0]);
-        glUniform3fv(m_uDirectionalLightDir, 1, &directionnalLightDirViewSpace[0]);
+        frameUniforms.uDirectionalLightDir = glm::vec3(m_viewController.getViewMatrix() * glm::vec4(m_directionalLightDir, 0));
+        frameUniforms.uDirectionalLightIntensity = m_directionalLightIntensity;
+        m_frameBuffer.update(frameUniforms);
+        m_frameBuffer.bindBase(GL_UNIFORM_BUFFER, 0);
         
         glBindVertexArray(m_vaoModel);
         
-        for(GLuint i = 0; i < 4; ++i)
-            glBindSampler(i, m_sampler);
+        if (m_materialBufferOutdated) {
+            updateMaterialBuffer();
+        }
+        if (m_bindless) {
+            // Materials reference their textures by handle, no texture is bound
+            m_bindlessMaterialBuffer.bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        else {
+            // Every texture array is bound for the whole frame, to units 0 to m_textureArrays.arrayCount() - 1
+            m_arrayMaterialBuffer.bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+            m_textureArrays.bind(0, m_sampler);
+        }
+        
+        const auto viewportSize = m_GLFWHandle.framebufferSize();
+        m_drawnTriangleCount = 0;
         
-        glUniform1i(m_uSamplerKa, 0);
-        glUniform1i(m_uSamplerKd, 1);
-        glUniform1i(m_uSamplerKs, 2);
-        glUniform1i(m_uSamplerShininess, 3);
+        m_visibleShapes.assign(m_objData.indexCountPerShape.size(), 1);
+        m_visibleShapeCount = m_visibleShapes.size();
+        if (m_frustumCulling) {
+            const auto frustum = glmlv::extractFrustum(m_projectionMatrix * m_viewController.getViewMatrix());
+            m_visibleShapeCount = glmlv::cullBoxes(frustum, m_objData.bboxMinPerShape, m_objData.bboxMaxPerShape, m_visibleShapes);
+        }
         
         auto indexOffset = 0;
         int shape = 0; // num of current shape
         for (const auto indexCount: m_objData.indexCountPerShape)
         {
-            auto & material = m_objData.materialIDPerShape[shape] >= 0 ? 
-            m_objData.materials[m_objData.materialIDPerShape[shape]] : m_defaultMaterial;
-                 
-            glUniform3fv(m_uKa, 1, &material.Ka[0]);
-            glUniform3fv(m_uKd, 1, &material.Kd[0]);
-            glUniform3fv(m_uKs, 1, &material.Ks[0]);
-            glUniform1f(m_uShininess, material.shininess);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, m_texIds[material.KaTextureId]);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, m_texIds[material.KdTextureId]);            
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, m_texIds[material.KsTextureId]);            
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, m_texIds[material.shininessTextureId]);
+            if (!m_visibleShapes[shape]) {
+                indexOffset += indexCount;
+                ++shape;
+                continue;
+            }
             
-            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (const GLvoid*) (indexOffset * sizeof(GLuint)));
+            auto drawOffset = indexOffset;
+            auto drawCount = indexCount;
+            if (m_lods.levelCount)
+            {
+                const auto level = m_useLods ? selectLod(shape, m_viewController.getViewMatrix(), float(viewportSize.y)) : 0;
+                drawOffset = m_lods.indexOffsets[level * m_lods.shapeCount + shape];
+                drawCount = m_lods.indexCounts[level * m_lods.shapeCount + shape];
+            }
+            m_drawnTriangleCount += drawCount / 3;
+            
+            // The base instance selects the material index of the shape in m_materialIndexBuffer
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, drawCount, GL_UNSIGNED_INT, (const GLvoid*) (drawOffset * sizeof(GLuint)), 1, GLuint(shape));
             indexOffset += indexCount;
             ++shape;
         }
         
-        for(GLuint i = 0; i < 4; ++i)
-            glBindSampler(i, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
+        if (!m_bindless) {
+            m_textureArrays.unbind(0);
+        }
         
         glBindVertexArray(0);
         
+        if (m_captureFrames) {
+            captureFrame(); // Before the GUI is drawn
+        }
+        
         // GUI code:
         ImGui_ImplGlfwGL3_NewFrame();
 
@@ -88,10 +113,40 @@ int Application::run()
             }
             ImGui::SliderFloat3("dir dirlight", &m_directionalLightDir[0], -1, 1);
             ImGui::SliderFloat3("intensity dirlight", &m_directionalLightIntensity[0], 0., 1.);
+            ImGui::Text("First frame after %.1f ms", 1000. * m_firstFrameTime);
+            if (m_geometryLoadedTime < 0) {
+                ImGui::Text("Loading geometry...");
+            }
+            else if (m_sceneLoadedTime < 0) {
+                ImGui::Text("Loading textures: %d/%d", int(m_residentTextureCount), int(m_objData.texturePaths.size()));
+            }
+            else {
+                ImGui::Text("Scene loaded after %.1f ms (geometry after %.1f ms)", 1000. * m_sceneLoadedTime, 1000. * m_geometryLoadedTime);
+            }
+            if (m_lods.levelCount) {
+                ImGui::Checkbox("Levels of detail", &m_useLods);
+                ImGui::SliderFloat("LOD error (pixels)", &m_lodPixelError, 0.1f, 16.f);
+            }
+            ImGui::Checkbox("Frustum culling", &m_frustumCulling);
+            ImGui::Text("Shapes: %d drawn, %d culled", int(m_visibleShapeCount), int(m_visibleShapes.size() - m_visibleShapeCount));
+            ImGui::Text("Triangles: %d", int(m_drawnTriangleCount));
+            ImGui::Text("Textures: %s", m_bindless ? "bindless handles" : "texture arrays");
+            const auto uploadStatistics = m_uploadRing.statistics();
+            if (uploadStatistics.uploadCount) {
+                ImGui::Text("Uploads: %d, %.1f MB at %.1f MB/s (loading stalled %.1f ms)", int(uploadStatistics.uploadCount), uploadStatistics.uploadedByteCount / (1024. * 1024.),
+                    uploadStatistics.uploadedByteCount / (1024. * 1024. * std::max(uploadStatistics.uploadSeconds, 1e-6)), 1000. * uploadStatistics.stallSeconds);
+            }
+            if (ImGui::Checkbox("Capture frames", &m_captureFrames) && m_captureFrames) {
+                glmlv::fs::create_directories(m_AppPath.parent_path() / "captures");
+            }
+            const auto & readbackStatistics = m_readbackRing.statistics();
+            if (readbackStatistics.readCount) {
+                ImGui::Text("Captured %d frames, %d dropped, %.3f ms per frame on the GL thread, %.1f ms latency", int(readbackStatistics.readCount), int(readbackStatistics.droppedCount),
+                    1000. * readbackStatistics.glThreadSeconds / readbackStatistics.readCount, 1000. * readbackStatistics.latencySeconds / readbackStatistics.readCount);
+            }
             ImGui::End();
         }
 
-        const auto viewportSize = m_GLFWHandle.framebufferSize();
         glViewport(0, 0, viewportSize.x, viewportSize.y);
         ImGui::Render();
 
@@ -101,6 +156,11 @@ int Application::run()
         /* Swap front and back buffers*/
         m_GLFWHandle.swapBuffers();
 
+        if (!iterationCount) {
+            m_firstFrameTime = glfwGetTime() - m_startTime;
+            std::clog << "First frame after " << 1000. * m_firstFrameTime << " ms" << std::endl;
+        }
+
         auto ellapsedTime = glfwGetTime() - seconds;
         auto guiHasFocus = ImGui::GetIO().WantCaptureMouse || ImGui::GetIO().WantCaptureKeyboard;
         if (!guiHasFocus) {
@@ -117,6 +177,7 @@ Application::Application(int argc, char** argv):
     m_ImGuiIniFilename { m_AppName + ".imgui.ini" },
     m_ShadersRootPath { m_AppPath.parent_path() / "shaders" },
     m_AssetsRootPath { m_AppPath.parent_path() / "assets" },
+    m_startTime { glfwGetTime() },
     m_viewController(m_GLFWHandle.window())
 {
     ImGui::GetIO().IniFilename = m_ImGuiIniFilename.c_str(); // At exit, ImGUI will store its windows positions in this file
@@ -124,7 +185,198 @@ Application::Application(int argc, char** argv):
     
     glEnable(GL_DEPTH_TEST);
     
-    glmlv::loadObj(m_AssetsRootPath / m_AppName / "models/crytek-sponza/sponza.obj", m_objData);
+    // bindless textures when supported, unless --no-bindless is given (e.g. to compare with texture arrays); without GL_ARB_bindless_texture only
+    // the texture array path can run
+    auto bindlessDisabled = false;
+    for (auto i = 1; i < argc; ++i) {
+        bindlessDisabled = bindlessDisabled || std::string(argv[i]) == "--no-bindless";
+    }
+    m_bindless = !bindlessDisabled && glmlv::GLBindlessTextures::isSupported();
+    std::clog << "Textures: " << (m_bindless ? "bindless handles" : "texture arrays") << std::endl;
+    
+    // init shader; texture arrays are selected in an array of samplers as large as the units of the fragment shader
+    GLint textureUnitCount = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnitCount);
+    m_program = glmlv::compileProgram({ m_ShadersRootPath / m_AppName / "/forward.vs.glsl", m_ShadersRootPath / m_AppName / (m_bindless ? "/forwardBindless.fs.glsl" : "/forward.fs.glsl") },
+        m_bindless ? glmlv::ShaderDefines() : glmlv::ShaderDefines{ { "TEXTURE_ARRAY_COUNT", std::to_string(textureUnitCount) } });
+    m_program.use();
+    for (GLint unit = 0; !m_bindless && unit < textureUnitCount; ++unit) {
+        m_program.setUniform(("uTextureArrays[" + std::to_string(unit) + "]").c_str(), unit);
+    }
+    // Arrays are created while textures are loaded, each one must have a sampler: adding a texture that needs one more throws
+    m_textureArrays.setMaxArrayCount(size_t(textureUnitCount));
+    m_program.checkUniformsLookedUp();
+    
+    // The C++ structures of the blocks must match their layouts in the program
+    const auto frameLayoutMatches = m_program.checkBlockLayout(GL_UNIFORM_BLOCK, "Frame", { sizeof(FrameUniforms), {
+        { "uModelViewProjMatrix", offsetof(FrameUniforms, uModelViewProjMatrix), sizeof(FrameUniforms::uModelViewProjMatrix) },
+        { "uModelViewMatrix", offsetof(FrameUniforms, uModelViewMatrix), sizeof(FrameUniforms::uModelViewMatrix) },
+        { "uNormalMatrix", offsetof(FrameUniforms, uNormalMatrix), sizeof(FrameUniforms::uNormalMatrix) },
+        { "uDirectionalLightDir", offsetof(FrameUniforms, uDirectionalLightDir), sizeof(FrameUniforms::uDirectionalLightDir) },
+        { "uDirectionalLightIntensity", offsetof(FrameUniforms, uDirectionalLightIntensity), sizeof(FrameUniforms::uDirectionalLightIntensity) } } });
+    const auto materialLayoutMatches = m_bindless ?
+        m_program.checkBlockLayout(GL_SHADER_STORAGE_BLOCK, "Materials", { sizeof(glmlv::BindlessMaterial), {
+            { "uMaterials[0].Ka", offsetof(glmlv::BindlessMaterial, Ka), sizeof(glmlv::BindlessMaterial::Ka) },
+            { "uMaterials[0].Kd", offsetof(glmlv::BindlessMaterial, Kd), sizeof(glmlv::BindlessMaterial::Kd) },
+            { "uMaterials[0].KsShininess", offsetof(glmlv::BindlessMaterial, KsShininess), sizeof(glmlv::BindlessMaterial::KsShininess) },
+            { "uMaterials[0].textures[0]", offsetof(glmlv::BindlessMaterial, textures), sizeof(glmlv::BindlessMaterial::textures) } } }) :
+        m_program.checkBlockLayout(GL_SHADER_STORAGE_BLOCK, "Materials", { sizeof(ArrayMaterial), {
+            { "uMaterials[0].Ka", offsetof(ArrayMaterial, Ka), sizeof(ArrayMaterial::Ka) },
+            { "uMaterials[0].Kd", offsetof(ArrayMaterial, Kd), sizeof(ArrayMaterial::Kd) },
+            { "uMaterials[0].KsShininess", offsetof(ArrayMaterial, KsShininess), sizeof(ArrayMaterial::KsShininess) },
+            { "uMaterials[0].textureArrays", offsetof(ArrayMaterial, textureArrays), sizeof(ArrayMaterial::textureArrays) },
+            { "uMaterials[0].textureLayers", offsetof(ArrayMaterial, textureLayers), sizeof(ArrayMaterial::textureLayers) } } });
+    if (!frameLayoutMatches || !materialLayoutMatches) {
+        throw std::runtime_error("Shader blocks differ from their C++ structures");
+    }
+    
+    // init matrices, updated when the geometry is loaded
+    m_projectionMatrix = glm::perspective(glm::radians(70.f), m_nWindowWidth / (float) m_nWindowHeight, 0.01f, 100.f);
+    m_viewController.setViewMatrix(glm::lookAt(glm::vec3(0, 0, 4), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)));
+    
+    // samplers, created first since bindless handles are bound to them
+    glGenSamplers(1, &m_sampler);
+    glSamplerParameteri(m_sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glSamplerParameteri(m_sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);   
+    
+    // textures
+    const auto white = glmlv::compressImage(glmlv::Image2DRGBA(1, 1, 255, 255, 255, 255), glmlv::BlockFormat::BC1);
+    if (m_bindless) {
+        m_whiteHandle = m_bindlessTextures.add(white, m_sampler);
+    }
+    else {
+        m_whiteLayer = m_textureArrays.add(white);
+    }
+    
+    // lights
+    m_directionalLightDir = glm::vec3(1, -1, 0);
+    m_directionalLightIntensity = glm::vec3(1, 1, 1);
+    
+    // build default material
+    auto whiteK = glm::vec3(1, 1, 1);
+    m_defaultMaterial.Ka = m_defaultMaterial.Kd = m_defaultMaterial.Ks = whiteK;
+    m_defaultMaterial.shininess = 0;
+    
+    // The scene is loaded in background, geometry and textures are uploaded by processLoadingEvents() as soon as they are ready.
+    // Started last: nothing may throw once the loading thread runs, since it would be destroyed while joinable.
+    startLoading(m_AssetsRootPath / m_AppName / "models/crytek-sponza/sponza.obj");
+}
+
+Application::~Application()
+{
+    m_readbackRing.finish(); // The last captured frames, written before the destruction of m_imageWriter
+
+    m_stopLoading = true;
+    m_uploadRing.close(); // The loading thread can be waiting for space in the ring
+    if (m_loadingThread.joinable()) {
+        m_loadingThread.join();
+    }
+
+    glDeleteBuffers(1, &m_vboModel);
+    glDeleteBuffers(1, &m_iboModel);
+    glDeleteVertexArrays(1, &m_vaoModel);
+
+    glDeleteBuffers(1, &m_materialIndexBuffer);
+    glDeleteSamplers(1, &m_sampler);
+}
+
+void Application::captureFrame()
+{
+    const auto framebufferSize = m_GLFWHandle.framebufferSize();
+    const auto path = m_AppPath.parent_path() / "captures" / (m_AppName + "-" + std::to_string(m_capturedFrameCount) + ".png");
+    // Dropped when every buffer is used by a pending read or by an image not written yet
+    const auto read = m_readbackRing.readPixels(0, 0, framebufferSize.x, framebufferSize.y, [this, path](glmlv::Image2DRGBA && image)
+    {
+        m_imageWriter.write(std::move(image), path, true);
+    });
+    if (read) {
+        ++m_capturedFrameCount;
+    }
+}
+
+void Application::startLoading(const glmlv::fs::path & objPath)
+{
+    m_loadingThread = std::thread([this, objPath]()
+    {
+        try {
+            std::unique_ptr<glmlv::ObjData> pGeometry(new glmlv::ObjData);
+            glmlv::loadObjCached(objPath, *pGeometry, false, true);
+            const auto texturePaths = pGeometry->texturePaths;
+            // pGeometry is moved to the GL thread, so the levels of detail are generated from a copy of its buffers
+            glmlv::ObjData lodsGeometry;
+            lodsGeometry.vertexBuffer = pGeometry->vertexBuffer;
+            lodsGeometry.indexBuffer = pGeometry->indexBuffer;
+            lodsGeometry.indexCountPerShape = pGeometry->indexCountPerShape;
+
+            LoadingEvent geometryEvent;
+            geometryEvent.pGeometry = std::move(pGeometry);
+            m_loadingEvents.push(std::move(geometryEvent));
+
+            glmlv::readCompressedTextures(texturePaths, [this](size_t textureId, glmlv::CompressedImage2D && texture)
+            {
+                if (m_stopLoading) {
+                    throw std::runtime_error("Loading cancelled");
+                }
+                LoadingEvent textureEvent;
+                textureEvent.textureId = int32_t(textureId);
+                // Textures larger than the upload ring are uploaded from client memory by the GL thread
+                textureEvent.upload = m_uploadRing.allocate(texture.data.size());
+                if (textureEvent.upload) {
+                    std::copy(begin(texture.data), end(texture.data), textureEvent.upload.data);
+                    texture.data = std::vector<unsigned char>();
+                }
+                else if (m_stopLoading) {
+                    throw std::runtime_error("Loading cancelled");
+                }
+                textureEvent.texture = std::move(texture);
+                m_loadingEvents.push(std::move(textureEvent));
+            });
+
+            if (m_stopLoading) {
+                return;
+            }
+            LoadingEvent lodsEvent;
+            lodsEvent.pLods.reset(new glmlv::MeshLods(glmlv::generateLods(lodsGeometry)));
+            m_loadingEvents.push(std::move(lodsEvent));
+        }
+        catch (const std::exception & e) {
+            if (!m_stopLoading) {
+                LoadingEvent errorEvent;
+                errorEvent.error = e.what();
+                m_loadingEvents.push(std::move(errorEvent));
+            }
+        }
+    });
+}
+
+void Application::processLoadingEvents()
+{
+    m_uploadRing.update();
+
+    LoadingEvent event;
+    while (m_loadingEvents.tryPop(event))
+    {
+        if (!event.error.empty()) {
+            throw std::runtime_error("Unable to load scene: " + event.error);
+        }
+        if (event.pGeometry) {
+            initGeometry(std::move(event.pGeometry));
+        }
+        if (event.textureId >= 0) {
+            initTexture(event.textureId, event.texture, event.upload);
+            event.texture = glmlv::CompressedImage2D(); // Release blocks now rather than at the next event
+        }
+        if (event.pLods) {
+            initLods(std::move(event.pLods));
+        }
+    }
+}
+
+void Application::initGeometry(std::unique_ptr<glmlv::ObjData> pGeometry)
+{
+    m_objData = std::move(*pGeometry);
+    m_geometryLoadedTime = glfwGetTime() - m_startTime;
+    std::clog << "Geometry loaded after " << 1000. * m_geometryLoadedTime << " ms" << std::endl;
     
     glGenBuffers(1, &m_vboModel);
     glBindBuffer(GL_ARRAY_BUFFER, m_vboModel);
@@ -136,9 +388,21 @@ Application::Application(int argc, char** argv):
     glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, m_objData.indexBuffer.size() * sizeof(uint32_t), m_objData.indexBuffer.data(), 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     
+    // The default material follows the materials of the scene in the material buffer
+    std::vector<GLuint> materialIndices;
+    materialIndices.reserve(m_objData.materialIDPerShape.size());
+    for (const auto materialId : m_objData.materialIDPerShape) {
+        materialIndices.push_back(materialId >= 0 ? GLuint(materialId) : GLuint(m_objData.materials.size()));
+    }
+    glGenBuffers(1, &m_materialIndexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_materialIndexBuffer);
+    glBufferStorage(GL_ARRAY_BUFFER, materialIndices.size() * sizeof(GLuint), materialIndices.data(), 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
     const GLuint VERTEX_ATTR_POSITION = 0;
     const GLuint VERTEX_ATTR_NORMAL = 1;
     const GLuint VERTEX_ATTR_UV = 2;
+    const GLuint VERTEX_ATTR_MATERIAL_INDEX = 3;
     
     glGenVertexArrays(1, &m_vaoModel);
     glBindVertexArray(m_vaoModel);
@@ -150,81 +414,134 @@ Application::Application(int argc, char** argv):
     glVertexAttribPointer(VERTEX_ATTR_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(glmlv::Vertex3f3f2f), (const GLvoid*) offsetof(glmlv::Vertex3f3f2f, position));
     glVertexAttribPointer(VERTEX_ATTR_NORMAL,   3, GL_FLOAT, GL_FALSE, sizeof(glmlv::Vertex3f3f2f), (const GLvoid*) offsetof(glmlv::Vertex3f3f2f, normal));
     glVertexAttribPointer(VERTEX_ATTR_UV,       2, GL_FLOAT, GL_FALSE, sizeof(glmlv::Vertex3f3f2f), (const GLvoid*) offsetof(glmlv::Vertex3f3f2f, texCoords));
+    glEnableVertexAttribArray(VERTEX_ATTR_MATERIAL_INDEX);
+    glBindBuffer(GL_ARRAY_BUFFER, m_materialIndexBuffer);
+    glVertexAttribIPointer(VERTEX_ATTR_MATERIAL_INDEX, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+    glVertexAttribDivisor(VERTEX_ATTR_MATERIAL_INDEX, 1);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     
-    // init shader
-    m_program = glmlv::compileProgram({ m_ShadersRootPath / m_AppName / "/forward.vs.glsl", m_ShadersRootPath / m_AppName / "/forward.fs.glsl" });
-    m_uModelViewProjMatrix = glGetUniformLocation(m_program.glId(), "uModelViewProjMatrix");
-    m_uModelViewMatrix = glGetUniformLocation(m_program.glId(), "uModelViewMatrix");
-    m_uNormalMatrix = glGetUniformLocation(m_program.glId(), "uNormalMatrix");
-    m_uSamplerKa = glGetUniformLocation(m_program.glId(), "uSamplerKa ");
-    m_uSamplerKd = glGetUniformLocation(m_program.glId(), "uSamplerKd");
-    m_uSamplerKs = glGetUniformLocation(m_program.glId(), "uSamplerKs");
-    m_uSamplerShininess = glGetUniformLocation(m_program.glId(), "uSamplerShininess");
-    m_uKa = glGetUniformLocation(m_program.glId(), "uKa");
-    m_uKd = glGetUniformLocation(m_program.glId(), "uKd");
-    m_uKs = glGetUniformLocation(m_program.glId(), "uKs");
-    m_uShininess = glGetUniformLocation(m_program.glId(), "uShininess");
-    m_uDirectionalLightDir = glGetUniformLocation(m_program.glId(), "uDirectionalLightDir");
-    m_uDirectionalLightIntensity = glGetUniformLocation(m_program.glId(), "uDirectionalLightIntensity");
-    m_program.use();
-    
     // init matrices
     const auto sceneDiagonalSize = glm::length(m_objData.bboxMax - m_objData.bboxMin);
     m_projectionMatrix = glm::perspective(glm::radians(70.f), m_nWindowWidth / (float) m_nWindowHeight, 0.01f * sceneDiagonalSize, 100.f * sceneDiagonalSize);
     m_viewController.setSpeed(sceneDiagonalSize * 0.1f);
-    m_viewController.setViewMatrix(glm::lookAt(glm::vec3(0, 0, 4), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)));
     
-    // textures
-    m_texIds = std::vector<GLuint>(m_objData.textures.size());
-    glGenTextures(m_texIds.size(), m_texIds.data());
-    for(auto i = 0; i < m_texIds.size(); ++i) {
-        glBindTexture(GL_TEXTURE_2D, m_texIds[i]);
-        auto & tex = m_objData.textures[i];
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, tex.width(), tex.height());
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex.width(), tex.height(), GL_RGBA, GL_UNSIGNED_BYTE, tex.data());
-    }
-    glGenTextures(1, &m_whiteTexture);
-    glBindTexture(GL_TEXTURE_2D, m_whiteTexture);
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB32F, 1, 1);
-    glm::vec4 white(1.f, 1.f, 1.f, 1.f);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_FLOAT, &white);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    
-    // make textureless materials pointing toward whiteTexture
-    m_texIds.push_back(m_whiteTexture);
-    for(auto & material : m_objData.materials) {
-        if(material.KaTextureId < 0) material.KaTextureId = m_texIds.size() - 1;
-        if(material.KdTextureId < 0) material.KdTextureId = m_texIds.size() - 1;
-        if(material.KsTextureId < 0) material.KsTextureId = m_texIds.size() - 1;
-        if(material.shininessTextureId < 0) material.shininessTextureId = m_texIds.size() - 1;
+    // every texture is white until it is resident
+    m_textureLayers = std::vector<glmlv::GLTextureArrays::Layer>(m_objData.texturePaths.size(), m_whiteLayer);
+    m_textureHandles = std::vector<GLuint64>(m_objData.texturePaths.size(), m_whiteHandle);
+    if (m_objData.texturePaths.empty()) {
+        m_sceneLoadedTime = m_geometryLoadedTime;
     }
     
-    // samplers
-    glGenSamplers(1, &m_sampler);
-    glSamplerParameteri(m_sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glSamplerParameteri(m_sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);   
-    
-    // lights
-    m_directionalLightDir = glm::vec3(1, -1, 0);
-    m_directionalLightIntensity = glm::vec3(1, 1, 1);
-    
-    // build default material
-    auto whiteK = glm::vec3(1, 1, 1);
-    m_defaultMaterial.Ka = m_defaultMaterial.Kd = m_defaultMaterial.Ks = whiteK;
-    m_defaultMaterial.shininess = 0;
+    // make textureless materials pointing toward the white layer
+    m_textureLayers.push_back(m_whiteLayer);
+    m_textureHandles.push_back(m_whiteHandle);
+    for(auto & material : m_objData.materials) {
+        if(material.KaTextureId < 0) material.KaTextureId = m_textureLayers.size() - 1;
+        if(material.KdTextureId < 0) material.KdTextureId = m_textureLayers.size() - 1;
+        if(material.KsTextureId < 0) material.KsTextureId = m_textureLayers.size() - 1;
+        if(material.shininessTextureId < 0) material.shininessTextureId = m_textureLayers.size() - 1;
+    }
     m_defaultMaterial.KaTextureId 
         = m_defaultMaterial.KdTextureId 
         = m_defaultMaterial.KsTextureId
-        = m_defaultMaterial.shininessTextureId = m_texIds.size() - 1;
+        = m_defaultMaterial.shininessTextureId = m_textureLayers.size() - 1;
+    m_materialBufferOutdated = true;
 }
 
-Application::~Application()
+void Application::initTexture(int32_t textureId, const glmlv::CompressedImage2D & texture, const glmlv::GLUploadRing::Allocation & upload)
 {
-    glDeleteBuffers(1, &m_vboModel);
+    // Blocks in upload are read by the GPU from the upload ring, bound as pixel unpack buffer, rather than copied by the driver
+    const GLvoid * levels = texture.data.data();
+    if (upload) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadRing.glId());
+        levels = (const GLvoid *) upload.offset;
+    }
+    if (m_bindless) {
+        m_textureHandles[textureId] = m_bindlessTextures.add(texture, levels, m_sampler);
+    }
+    else {
+        m_textureLayers[textureId] = m_textureArrays.add(texture, levels);
+    }
+    m_materialBufferOutdated = true; // Uploaded once for all the textures received before the next frame
+    if (upload) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_uploadRing.release(upload);
+    }
+    
+    if (++m_residentTextureCount == m_objData.texturePaths.size()) {
+        m_sceneLoadedTime = glfwGetTime() - m_startTime;
+        std::clog << "Scene loaded after " << 1000. * m_sceneLoadedTime << " ms" << std::endl;
+        const auto uploadStatistics = m_uploadRing.statistics();
+        std::clog << "Uploaded " << uploadStatistics.uploadedByteCount / (1024. * 1024.) << " MB of textures through the upload ring in " << 1000. * uploadStatistics.uploadSeconds
+            << " ms (loading stalled " << 1000. * uploadStatistics.stallSeconds << " ms)" << std::endl;
+    }
+}
+
+void Application::initLods(std::unique_ptr<glmlv::MeshLods> pLods)
+{
+    m_lods = std::move(*pLods);
+
+    // The index buffer of the levels of detail starts with the full resolution indices, so it replaces the index buffer of the scene
     glDeleteBuffers(1, &m_iboModel);
-    glDeleteVertexArrays(1, &m_vaoModel);
+    glGenBuffers(1, &m_iboModel);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iboModel);
+    glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, m_lods.indexBuffer.size() * sizeof(uint32_t), m_lods.indexBuffer.data(), 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(m_vaoModel);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iboModel);
+    glBindVertexArray(0);
+}
 
+void Application::updateMaterialBuffer()
+{
+    if (m_bindless)
+    {
+        m_bindlessMaterialBuffer.update(glmlv::makeBindlessMaterials(m_objData.materials, m_defaultMaterial, m_textureHandles));
+    }
+    else
+    {
+        std::vector<ArrayMaterial> materials;
+        materials.reserve(m_objData.materials.size() + 1);
+        const auto addMaterial = [&](const glmlv::ObjData::PhongMaterial & material)
+        {
+            const auto & KaLayer = m_textureLayers[material.KaTextureId];
+            const auto & KdLayer = m_textureLayers[material.KdTextureId];
+            const auto & KsLayer = m_textureLayers[material.KsTextureId];
+            const auto & shininessLayer = m_textureLayers[material.shininessTextureId];
+            ArrayMaterial arrayMaterial;
+            arrayMaterial.Ka = glm::vec4(material.Ka, 0);
+            arrayMaterial.Kd = glm::vec4(material.Kd, 0);
+            arrayMaterial.KsShininess = glm::vec4(material.Ks, material.shininess);
+            arrayMaterial.textureArrays = glm::ivec4(KaLayer.array, KdLayer.array, KsLayer.array, shininessLayer.array);
+            arrayMaterial.textureLayers = glm::ivec4(KaLayer.layer, KdLayer.layer, KsLayer.layer, shininessLayer.layer);
+            materials.push_back(arrayMaterial);
+        };
+        for (const auto & material : m_objData.materials) {
+            addMaterial(material);
+        }
+        addMaterial(m_defaultMaterial);
+        m_arrayMaterialBuffer.update(materials);
+    }
+    m_materialBufferOutdated = false;
 }
 
+size_t Application::selectLod(size_t shape, const glm::mat4 & viewMatrix, float viewportHeight) const
+{
+    const auto & sphere = m_objData.boundingSpherePerShape[shape];
+    const auto distance = glm::length(glm::vec3(viewMatrix * glm::vec4(glm::vec3(sphere), 1))) - sphere.w;
+    if (distance <= 0.f) {
+        return 0;
+    }
+
+    // Size in pixels of an object space unit at the nearest point of the bounding sphere
+    const auto pixelsPerUnit = 0.5f * viewportHeight * m_projectionMatrix[1][1] / distance;
+    for (auto level = m_lods.levelCount - 1; level > 0; --level)
+    {
+        if (m_lods.errors[level * m_lods.shapeCount + shape] * pixelsPerUnit <= m_lodPixelError) {
+            return level;
+        }
+    }
+    return 0;
+}
@@ -3,11 +3,25 @@
 #include <glmlv/filesystem.hpp>
 #include <glmlv/GLFWHandle.hpp>
 #include <glmlv/GLProgram.hpp>
+#include <glmlv/GLBlockBuffer.hpp>
 #include <glmlv/simple_geometry.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glmlv/ViewController.hpp>
 #include <glmlv/Image2DRGBA.hpp>
 #include <glmlv/load_obj.hpp>
+#include <glmlv/texture_compression.hpp>
+#include <glmlv/GLTextureArrays.hpp>
+#include <glmlv/GLBindlessTextures.hpp>
+#include <glmlv/bindless_material.hpp>
+#include <glmlv/GLUploadRing.hpp>
+#include <glmlv/GLReadbackRing.hpp>
+#include <glmlv/ImageWriter.hpp>
+#include <glmlv/mesh_optimizer.hpp>
+#include <glmlv/MPSCQueue.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
 
 class Application
 {
@@ -17,6 +31,27 @@ public:
 
     int run();
 private:
+    // Resource produced by the loading thread, to be uploaded by the GL thread
+    struct LoadingEvent
+    {
+        std::unique_ptr<glmlv::ObjData> pGeometry; // Scene without its textures
+        std::unique_ptr<glmlv::MeshLods> pLods; // Levels of detail of the scene, generated after textures are read
+        int32_t textureId = -1; // Texture of the scene, when >= 0
+        glmlv::CompressedImage2D texture; // Without its blocks when they are in upload
+        glmlv::GLUploadRing::Allocation upload; // Blocks of the texture, copied to m_uploadRing by the loading thread
+        std::string error; // Set when loading failed
+    };
+
+    void startLoading(const glmlv::fs::path & objPath);
+    void processLoadingEvents(); // Upload resources received from the loading thread
+    void initGeometry(std::unique_ptr<glmlv::ObjData> pGeometry);
+    void initTexture(int32_t textureId, const glmlv::CompressedImage2D & texture, const glmlv::GLUploadRing::Allocation & upload);
+    void initLods(std::unique_ptr<glmlv::MeshLods> pLods);
+    void updateMaterialBuffer(); // Upload the materials with the current handles or layers of their textures
+    void captureFrame(); // Read back the frame, written to a PNG file once delivered by m_readbackRing
+    // Coarsest level of detail of a shape whose error, projected on screen, is below m_lodPixelError
+    size_t selectLod(size_t shape, const glm::mat4 & viewMatrix, float viewportHeight) const;
+
     const size_t m_nWindowWidth = 1280;
     const size_t m_nWindowHeight = 720;
     glmlv::GLFWHandle m_GLFWHandle{ m_nWindowWidth, m_nWindowHeight, "Template" }; // Note: the handle must be declared before the creation of any object managing OpenGL resource (e.g. GLProgram, GLShader)
@@ -29,35 +64,82 @@ private:
     
     glmlv::ObjData m_objData;
     
-    GLuint m_vaoModel,
-           m_vboModel,
-           m_iboModel;
+    GLuint m_vaoModel = 0,
+           m_vboModel = 0,
+           m_iboModel = 0;
+    GLuint m_materialIndexBuffer = 0; // Index of the material of each shape, read as an instanced attribute: shapes are drawn with their index as base instance
+
+    // levels of detail
+    glmlv::MeshLods m_lods; // Empty until generated, shapes are then drawn with the indices of m_lods
+    bool m_useLods = true;
+    float m_lodPixelError = 1.f;
+    size_t m_drawnTriangleCount = 0;
+
+    // frustum culling
+    bool m_frustumCulling = true;
+    std::vector<uint8_t> m_visibleShapes; // 1 for each shape intersecting the view frustum in the current frame
+    size_t m_visibleShapeCount = 0;
+    
+    // asynchronous loading
+    std::thread m_loadingThread;
+    std::atomic<bool> m_stopLoading{ false };
+    glmlv::MPSCQueue<LoadingEvent> m_loadingEvents;
+    glmlv::GLUploadRing m_uploadRing{ 64 * 1024 * 1024 }; // Filled by the loading thread, the GL thread only issues the copies to textures
+    size_t m_residentTextureCount = 0;
+    double m_startTime; // glfwGetTime() at the beginning of the constructor
+    double m_firstFrameTime = -1; // Time from m_startTime to the first frame
+    double m_geometryLoadedTime = -1;
+    double m_sceneLoadedTime = -1; // Time from m_startTime to the residency of all textures
+    
+    // frame capture, in PNG files next to the executable; frames are read back without waiting for the GPU and written in the background
+    glmlv::GLReadbackRing m_readbackRing{ 4, size_t(m_GLFWHandle.framebufferSize().x * m_GLFWHandle.framebufferSize().y) * glmlv::Image2DRGBA::NumComponents };
+    // Declared after m_readbackRing, so that images still borrowing its buffers are written before its destruction. As many images as read back
+    // buffers: when writing is slower than rendering, frames are dropped by the readback ring instead of waiting for the writer.
+    glmlv::ImageWriter m_imageWriter{ 4 };
+    bool m_captureFrames = false;
+    size_t m_capturedFrameCount = 0;
            
     // shaders
     glmlv::GLProgram m_program;
     
-    GLint m_uModelViewProjMatrix;
-    GLint m_uModelViewMatrix;
-    GLint m_uNormalMatrix;
+    struct FrameUniforms // std140 layout of the Frame block of frame.glsl, uploaded once per frame
+    {
+        glm::mat4 uModelViewProjMatrix;
+        glm::mat4 uModelViewMatrix;
+        glm::mat4 uNormalMatrix;
+        glm::vec3 uDirectionalLightDir;
+        float padding0;
+        glm::vec3 uDirectionalLightIntensity;
+        float padding1;
+    };
+    glmlv::GLBlockBuffer<FrameUniforms> m_frameBuffer; // Bound to the uniform buffer binding 0
     glm::mat4 m_projectionMatrix;
     
-    // textures & materials
-    std::vector<GLuint> m_texIds;
+    // textures & materials, in a buffer bound to the shader storage binding 0: the materials of the scene followed by the default material
+    glmlv::GLTextureArrays m_textureArrays; // Bound once per frame, materials select their arrays and layers
+    std::vector<glmlv::GLTextureArrays::Layer> m_textureLayers; // Indexed by texture id; the white layer is used until a texture is resident
     GLuint m_sampler;
-    GLint m_uSamplerKa,
-          m_uSamplerKd,
-          m_uSamplerKs,
-          m_uSamplerShininess;
-    GLint m_uKa,
-          m_uKd,
-          m_uKs,
-          m_uShininess;
     glmlv::ObjData::PhongMaterial m_defaultMaterial;
-    GLuint m_whiteTexture;
+    glmlv::GLTextureArrays::Layer m_whiteLayer;
+    struct ArrayMaterial // std430 layout of Material in forward.fs.glsl
+    {
+        glm::vec4 Ka;
+        glm::vec4 Kd;
+        glm::vec4 KsShininess; // Ks in xyz, shininess in w
+        glm::ivec4 textureArrays; // Arrays of Ka, Kd, Ks and shininess textures
+        glm::ivec4 textureLayers;
+    };
+    glmlv::GLBlockBuffer<ArrayMaterial> m_arrayMaterialBuffer;
+    bool m_materialBufferOutdated = false;
+
+    // bindless path, used instead of texture arrays when GL_ARB_bindless_texture is supported (unless --no-bindless is given)
+    bool m_bindless = false;
+    glmlv::GLBindlessTextures m_bindlessTextures;
+    std::vector<GLuint64> m_textureHandles; // Indexed by texture id; the white handle is used until a texture is resident
+    GLuint64 m_whiteHandle = 0;
+    glmlv::GLBlockBuffer<glmlv::BindlessMaterial> m_bindlessMaterialBuffer;
           
     // light
-    GLint m_uDirectionalLightDir;
-    GLint m_uDirectionalLightIntensity;
     glm::vec3 m_directionalLightDir;
     glm::vec3 m_directionalLightIntensity;
     
@@ -1,27 +1,35 @@
-#version 330 core
+#version 430 core
+
+#include "../glmlv/phong.glsl"
+#include "frame.glsl"
 
 in vec3 vViewSpacePosition;
 in vec3 vViewSpaceNormal;
 in vec2 vTexCoords;
+flat in uint vMaterialIndex;
 
 out vec3 fColor;
 
-uniform vec3 uDirectionalLightDir;
-uniform vec3 uDirectionalLightIntensity;;
+struct Material // std430 layout of ArrayMaterial in Application.hpp
+{
+    vec4 Ka;
+    vec4 Kd;
+    vec4 KsShininess; // Ks in xyz, shininess in w
+    ivec4 textureArrays; // Arrays of Ka, Kd, Ks and shininess textures, indices in uTextureArrays
+    ivec4 textureLayers; // Layers of the textures in their arrays
+};
 
-uniform sampler2D uSamplerKa;
-uniform sampler2D uSamplerKd;
-uniform sampler2D uSamplerKs;
-uniform sampler2D uSamplerShininess;
+layout(std430, binding = 0) readonly buffer Materials
+{
+    Material uMaterials[];
+};
 
-uniform vec3 uKa;
-uniform vec3 uKd;
-uniform vec3 uKs;
-uniform float uShininess;
+// Every texture array, bound once to consecutive units; TEXTURE_ARRAY_COUNT is defined by the application
+uniform sampler2DArray uTextureArrays[TEXTURE_ARRAY_COUNT];
 
 void main() {
-    vec3 halfVector = 0.5 * (uDirectionalLightDir + vViewSpacePosition);
-    fColor = uDirectionalLightIntensity * (
-             uKd * vec3(texture(uSamplerKd, vTexCoords)) * max(0.0, dot(vViewSpaceNormal, uDirectionalLightDir))
-             + uKs * pow(max(0, dot(halfVector, vViewSpaceNormal)), uShininess));
+    Material material = uMaterials[vMaterialIndex];
+    // The material index is the same for the whole draw, so it can select the sampler
+    vec3 diffuse = material.Kd.xyz * vec3(texture(uTextureArrays[material.textureArrays[1]], vec3(vTexCoords, material.textureLayers[1])));
+    fColor = directionalLightPhong(uDirectionalLightDir, uDirectionalLightIntensity, vViewSpacePosition, vViewSpaceNormal, diffuse, material.KsShininess.xyz, material.KsShininess.w);
 }
@@ -1,16 +1,16 @@
-#version 330 core
+#version 430 core
+
+#include "frame.glsl"
 
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoords;
-
-uniform mat4 uModelViewProjMatrix;
-uniform mat4 uModelViewMatrix;
-uniform mat4 uNormalMatrix;
+layout(location = 3) in uint aMaterialIndex; // Per instance, the base instance of each draw selecting the material of its shape
 
 out vec3 vViewSpacePosition;
 out vec3 vViewSpaceNormal;
 out vec2 vTexCoords;
+flat out uint vMaterialIndex;
 
 void main() {
     vec4 position = vec4(aPosition, 1);
@@ -19,5 +19,6 @@ void main() {
     vViewSpacePosition = vec3(uModelViewMatrix * position);
     vViewSpaceNormal = vec3(uNormalMatrix * normal);
     vTexCoords = aTexCoords;
+    vMaterialIndex = aMaterialIndex;
     gl_Position = uModelViewProjMatrix * position;
 }
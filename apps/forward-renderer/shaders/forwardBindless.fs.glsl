@@ -0,0 +1,19 @@
+#version 430 core
+#extension GL_ARB_bindless_texture : require
+
+#include "../glmlv/phong.glsl"
+#include "../glmlv/bindless_material.glsl"
+#include "frame.glsl"
+
+in vec3 vViewSpacePosition;
+in vec3 vViewSpaceNormal;
+in vec2 vTexCoords;
+flat in uint vMaterialIndex;
+
+out vec3 fColor;
+
+void main() {
+    Material material = uMaterials[vMaterialIndex];
+    vec3 diffuse = material.Kd.xyz * vec3(texture(sampler2D(material.textures[1]), vTexCoords));
+    fColor = directionalLightPhong(uDirectionalLightDir, uDirectionalLightIntensity, vViewSpacePosition, vViewSpaceNormal, diffuse, material.KsShininess.xyz, material.KsShininess.w);
+}
@@ -0,0 +1,10 @@
+// Per frame uniforms of the forward renderer (std140 layout of its FrameUniforms structure), included by its shaders with #include "frame.glsl"
+
+layout(std140, binding = 0) uniform Frame
+{
+    mat4 uModelViewProjMatrix;
+    mat4 uModelViewMatrix;
+    mat4 uNormalMatrix;
+    vec3 uDirectionalLightDir; // In view space
+    vec3 uDirectionalLightIntensity;
+};
@@ -0,0 +1,143 @@
+#include <glmlv/FlatHashMap.hpp>
+#include <glmlv/filesystem.hpp>
+
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// CPU benchmark of glmlv::FlatHashMap against std::unordered_map on the vertex welding of loadObj: every (position, normal, texcoord) index
+// triplet of a model is inserted in order, each new triplet getting the next vertex id, then every triplet is looked up again.
+// Usage: hash-map-benchmark [path/to/model.obj] [iterations]
+// The default model is the crytek-sponza scene of the forward-renderer assets.
+namespace
+{
+
+// Same hash and key comparison as the welding of loadObj
+struct IndexHash
+{
+    size_t operator()(const tinyobj::index_t & idx) const
+    {
+        const size_t h1 = std::hash<int>()(idx.vertex_index);
+        const size_t h2 = std::hash<int>()(idx.normal_index);
+        const size_t h3 = std::hash<int>()(idx.texcoord_index);
+
+        size_t seed = h1;
+        seed ^= h2 + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= h3 + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+
+        return seed;
+    }
+};
+
+struct IndexEqualTo
+{
+    bool operator ()(const tinyobj::index_t & lhs, const tinyobj::index_t & rhs) const
+    {
+        return lhs.vertex_index == rhs.vertex_index && lhs.normal_index == rhs.normal_index && lhs.texcoord_index == rhs.texcoord_index;
+    }
+};
+
+const tinyobj::index_t EmptyIndex = { std::numeric_limits<int>::min(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min() };
+
+// Shortest time of f() in milliseconds over iterations runs
+template<typename Function>
+double measure(size_t iterations, Function && f)
+{
+    auto bestTime = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        f();
+        bestTime = std::min(bestTime, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+    }
+    return bestTime;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto appPath = glmlv::fs::path{ argv[0] };
+    const auto objPath = argc > 1 ? glmlv::fs::path{ argv[1] } : appPath.parent_path() / "assets" / "forward-renderer" / "models/crytek-sponza/sponza.obj";
+    const size_t iterations = argc > 2 ? std::stoul(argv[2]) : 5;
+
+    tinyobj::attrib_t attribs;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+    if (!tinyobj::LoadObj(&attribs, &shapes, &materials, &err, objPath.string().c_str(), (objPath.parent_path().string() + "/").c_str()))
+    {
+        std::cerr << "Unable to load obj " << objPath << ": " << err << std::endl;
+        return 1;
+    }
+
+    std::vector<tinyobj::index_t> indices;
+    for (const auto & shape : shapes) {
+        indices.insert(end(indices), begin(shape.mesh.indices), end(shape.mesh.indices));
+    }
+
+    // Vertex id of each index, as the welding computes them
+    std::vector<uint32_t> flatIds(indices.size()), stdIds(indices.size());
+    size_t flatVertexCount = 0, stdVertexCount = 0;
+    uint64_t flatChecksum = 0, stdChecksum = 0;
+
+    // Reserved for a quarter of the indices, as loadObj does for each shape
+    glmlv::FlatHashMap<tinyobj::index_t, uint32_t, IndexHash, IndexEqualTo> flatMap(EmptyIndex);
+    const auto flatWeldTime = measure(iterations, [&]()
+    {
+        flatMap = glmlv::FlatHashMap<tinyobj::index_t, uint32_t, IndexHash, IndexEqualTo>(EmptyIndex, indices.size() / 4);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            flatIds[i] = *flatMap.insert(indices[i], uint32_t(flatMap.size())).first;
+        }
+        flatVertexCount = flatMap.size();
+    });
+    const auto flatLookupTime = measure(iterations, [&]()
+    {
+        flatChecksum = 0;
+        for (const auto & idx : indices) {
+            flatChecksum += *flatMap.find(idx);
+        }
+    });
+
+    std::unordered_map<tinyobj::index_t, uint32_t, IndexHash, IndexEqualTo> stdMap;
+    const auto stdWeldTime = measure(iterations, [&]()
+    {
+        stdMap = std::unordered_map<tinyobj::index_t, uint32_t, IndexHash, IndexEqualTo>();
+        stdMap.reserve(indices.size() / 4);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            stdIds[i] = (*stdMap.emplace(indices[i], uint32_t(stdMap.size())).first).second;
+        }
+        stdVertexCount = stdMap.size();
+    });
+    const auto stdLookupTime = measure(iterations, [&]()
+    {
+        stdChecksum = 0;
+        for (const auto & idx : indices) {
+            stdChecksum += (*stdMap.find(idx)).second;
+        }
+    });
+
+    if (flatVertexCount != stdVertexCount || flatIds != stdIds || flatChecksum != stdChecksum)
+    {
+        std::cerr << "FlatHashMap and std::unordered_map give different vertex ids" << std::endl;
+        return 1;
+    }
+
+    const auto megaOperations = [&](double milliseconds)
+    {
+        return indices.size() / milliseconds * 1e-3;
+    };
+    std::cout << objPath << ": " << indices.size() << " indices, " << flatVertexCount << " unique vertices" << std::endl;
+    std::cout << "Weld: FlatHashMap " << flatWeldTime << " ms (" << megaOperations(flatWeldTime) << " M/s), std::unordered_map " << stdWeldTime
+        << " ms (" << megaOperations(stdWeldTime) << " M/s), speedup " << stdWeldTime / flatWeldTime << std::endl;
+    std::cout << "Lookup: FlatHashMap " << flatLookupTime << " ms (" << megaOperations(flatLookupTime) << " M/s), std::unordered_map " << stdLookupTime
+        << " ms (" << megaOperations(stdLookupTime) << " M/s), speedup " << stdLookupTime / flatLookupTime << std::endl;
+
+    return 0;
+}
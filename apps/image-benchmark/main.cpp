@@ -0,0 +1,173 @@
+#include <glmlv/Image2DRGBA.hpp>
+#include <glmlv/png_encoder.hpp>
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Micro-benchmark of the Image2DRGBA pixel kernels on 4K images, against the byte per byte loops they replace, of mipmap generation and of the float to half conversion.
+// Then compare the decoding of an image file with the mapping of the same image stored as a raw image, and the PNG encoders.
+// Usage: image-benchmark [width] [height] [iterations] [image]
+// The default image is a texture of the crytek-sponza model of the forward-renderer assets.
+namespace
+{
+
+void referenceFlipY(glmlv::Image2DRGBA & image)
+{
+    const auto rowSize = image.width() * glmlv::Image2DRGBA::NumComponents;
+    unsigned char * pFirstLine = image.data();
+    unsigned char * pLastLine = image.data() + (image.height() - 1) * rowSize;
+
+    while (pFirstLine < pLastLine)
+    {
+        for (size_t x = 0; x < rowSize; ++x)
+            std::swap(pFirstLine[x], pLastLine[x]);
+        pFirstLine += rowSize;
+        pLastLine -= rowSize;
+    }
+}
+
+void referenceFill(glmlv::Image2DRGBA & image, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+{
+    unsigned char * pPixel = image.data();
+    for (size_t i = 0; i < image.size(); ++i)
+    {
+        pPixel[0] = r;
+        pPixel[1] = g;
+        pPixel[2] = b;
+        pPixel[3] = a;
+        pPixel += 4;
+    }
+}
+
+// Average time of f() in milliseconds
+template<typename F>
+double measure(size_t iterations, F && f)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        f();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() / iterations;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto appPath = glmlv::fs::path{ argv[0] };
+    const size_t width = argc > 1 ? std::stoul(argv[1]) : 3840;
+    const size_t height = argc > 2 ? std::stoul(argv[2]) : 2160;
+    const size_t iterations = argc > 3 ? std::stoul(argv[3]) : 20;
+    const auto imagePath = argc > 4 ? glmlv::fs::path{ argv[4] } : appPath.parent_path() / "assets" / "forward-renderer" / "models/crytek-sponza/textures/sponza_fabric_purple.png";
+
+    glmlv::Image2DRGBA image(width, height);
+    for (size_t i = 0; i < image.size() * glmlv::Image2DRGBA::NumComponents; ++i) {
+        image.data()[i] = (unsigned char) (i * 7 + i / 4093);
+    }
+    glmlv::Image2DRGBA reference(width, height);
+    std::memcpy(reference.data(), image.data(), image.size() * glmlv::Image2DRGBA::NumComponents);
+
+    const auto referenceFlipTime = measure(iterations, [&]() { referenceFlipY(reference); });
+    const auto flipTime = measure(iterations, [&]() { image.flipY(); });
+    referenceFlipY(reference);
+    image.flipY();
+    if (std::memcmp(reference.data(), image.data(), image.size() * glmlv::Image2DRGBA::NumComponents)) {
+        std::cerr << "flipY differs from the reference" << std::endl;
+        return 1;
+    }
+
+    const auto referenceFillTime = measure(iterations, [&]() { reference = glmlv::Image2DRGBA(width, height); referenceFill(reference, 1, 2, 3, 4); });
+    const auto fillTime = measure(iterations, [&]() { image = glmlv::Image2DRGBA(width, height, 1, 2, 3, 4); });
+    if (std::memcmp(reference.data(), image.data(), image.size() * glmlv::Image2DRGBA::NumComponents)) {
+        std::cerr << "Fill constructor differs from the reference" << std::endl;
+        return 1;
+    }
+
+    size_t mipLevelCount = 0;
+    const auto mipmapsTime = measure(iterations, [&]() { mipLevelCount = glmlv::generateMipmaps(image).size(); });
+    const auto linearMipmapsTime = measure(iterations, [&]() { glmlv::generateMipmaps(image, false); });
+
+    const auto megaBytes = image.size() * glmlv::Image2DRGBA::NumComponents * 1e-6;
+    std::cout << width << "x" << height << " RGBA8 image, " << iterations << " iterations" << std::endl;
+    std::cout << "flipY: " << flipTime << " ms (" << megaBytes / flipTime << " GB/s), byte loop: " << referenceFlipTime << " ms, speedup " << referenceFlipTime / flipTime << std::endl;
+    std::cout << "mipmaps (" << mipLevelCount << " levels): " << mipmapsTime << " ms with sRGB filtering, " << linearMipmapsTime << " ms with linear filtering on "
+        << glmlv::defaultThreadCount() << " threads" << std::endl;
+    std::cout << "fill: " << fillTime << " ms (" << megaBytes / fillTime << " GB/s), byte loop: " << referenceFillTime << " ms, speedup " << referenceFillTime / fillTime << std::endl;
+
+    // Same pixels as floating point values, with a range that covers half subnormals and overflows
+    glmlv::Image2DRGBA32F floatImage(width, height);
+    for (size_t i = 0; i < floatImage.size() * glmlv::Image2DRGBA32F::NumComponents; ++i) {
+        floatImage.data()[i] = (image.data()[i] - 128.f) * std::ldexp(1.f, int(i % 40) - 24);
+    }
+    glmlv::Image2DRGBA16F referenceHalfImage(width, height);
+    const auto referenceHalfTime = measure(iterations, [&]()
+    {
+        for (size_t i = 0; i < floatImage.size() * glmlv::Image2DRGBA32F::NumComponents; ++i) {
+            referenceHalfImage.data()[i] = glmlv::floatToHalf(floatImage.data()[i]);
+        }
+    });
+    glmlv::Image2DRGBA16F halfImage(width, height);
+    const auto halfTime = measure(iterations, [&]() { glmlv::floatToHalf(floatImage.data(), halfImage.data(), floatImage.size() * glmlv::Image2DRGBA32F::NumComponents); });
+    if (std::memcmp(referenceHalfImage.data(), halfImage.data(), halfImage.height() * halfImage.rowSize())) {
+        std::cerr << "floatToHalf differs from the scalar conversion" << std::endl;
+        return 1;
+    }
+    std::cout << "float to half: " << halfTime << " ms, scalar loop: " << referenceHalfTime << " ms, speedup " << referenceHalfTime / halfTime << std::endl;
+
+    if (!glmlv::fs::exists(imagePath)) {
+        return 0;
+    }
+
+    // Touch every pixel, as an upload would
+    const auto checksum = [](const glmlv::Image2DRGBA & image)
+    {
+        size_t sum = 0;
+        for (size_t i = 0; i < image.size() * glmlv::Image2DRGBA::NumComponents; i += 64) {
+            sum += image.data()[i];
+        }
+        return sum;
+    };
+
+    glmlv::Image2DRGBA decoded;
+    const auto decodeTime = measure(iterations, [&]() { decoded = glmlv::readImage(imagePath, true); });
+
+    const auto rawPath = glmlv::fs::temp_directory_path() / "image-benchmark.glmlvcache.raw";
+    const auto mipmaps = glmlv::generateMipmaps(decoded);
+    glmlv::writeRawImage(decoded, mipmaps, rawPath);
+
+    size_t levelCount = 0;
+    const auto mapTime = measure(iterations, [&]() { levelCount = glmlv::mapRawImage(rawPath).size(); });
+    size_t rawChecksum = 0;
+    const auto readRawTime = measure(iterations, [&]() { rawChecksum = checksum(glmlv::readImage(rawPath)); });
+    const auto mappedLevels = glmlv::mapRawImage(rawPath);
+    glmlv::fs::remove(rawPath);
+    if (rawChecksum != checksum(decoded) || levelCount != mipmaps.size() + 1 || std::memcmp(mappedLevels.back().data(), mipmaps.back().data(), glmlv::Image2DRGBA::NumComponents)) {
+        std::cerr << "Raw image differs from the decoded image" << std::endl;
+        return 1;
+    }
+
+    std::cout << imagePath.filename().string() << " (" << decoded.width() << "x" << decoded.height() << "): decoded and flipped in " << decodeTime << " ms, raw image with "
+        << levelCount << " levels mapped in " << mapTime << " ms, " << readRawTime << " ms including a read of every page" << std::endl;
+
+    // PNG encoding, against stb_image_write which compresses on a single thread
+    const auto pngPath = glmlv::fs::temp_directory_path() / "image-benchmark.png";
+    const auto pngIterations = std::max(size_t(1), iterations / 4);
+    const auto pngTime = measure(pngIterations, [&]() { glmlv::writePNG(decoded, pngPath); });
+    const auto pngSize = glmlv::fs::file_size(pngPath);
+    const auto singleThreadPNGTime = measure(pngIterations, [&]() { glmlv::writePNG(decoded, pngPath, 1); });
+    const auto stbPNGTime = measure(pngIterations, [&]()
+    {
+        stbi_write_png(pngPath.string().c_str(), decoded.width(), decoded.height(), glmlv::Image2DRGBA::NumComponents, decoded.data(), 0);
+    });
+    const auto stbPNGSize = glmlv::fs::file_size(pngPath);
+    glmlv::fs::remove(pngPath);
+    std::cout << "png: " << pngTime << " ms on " << glmlv::defaultThreadCount() << " threads, " << singleThreadPNGTime << " ms on 1 thread, " << pngSize << " bytes; stb_image_write: "
+        << stbPNGTime << " ms, " << stbPNGSize << " bytes" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <glmlv/mesh_optimizer.hpp>
+#include <glmlv/load_obj.hpp>
+#include <glmlv/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// Check of the vertex cache optimizer on small meshes, then CPU benchmark of the mesh optimization pass on a scene: time and vertex cache
+// efficiency of optimizeVertexCache alone and of optimizeMesh.
+// Usage: mesh-optimizer-benchmark [path/to/model.obj]
+// The default model is the crytek-sponza scene of the forward-renderer assets.
+namespace
+{
+
+// Scores of the Forsyth algorithm, as tabulated by optimizeVertexCache
+const size_t CacheSize = 32;
+
+float vertexScore(int cachePosition, size_t remainingTriangles)
+{
+    if (!remainingTriangles) {
+        return -1.f;
+    }
+    const auto cacheScore = cachePosition < 0 ? 0.f : cachePosition < 3 ? 0.75f : std::pow(1.f - float(cachePosition - 3) / (CacheSize - 3), 1.5f);
+    return cacheScore + 2.f * std::pow(float(std::min<size_t>(remainingTriangles, 32)), -0.5f);
+}
+
+// Replay the output of optimizeVertexCache with every score computed from scratch: each triangle must be one of the best scored among those
+// sharing a vertex with the cache, or the first triangle left if there is none. evictionsAfterTailHits counts the evictions following a triangle
+// that reused a vertex of the last positions of a full cache, which the incremental score updates must handle.
+bool checkVertexCacheOrder(const std::vector<uint32_t> & indices, const std::vector<uint32_t> & optimized, size_t vertexCount, size_t & evictionsAfterTailHits)
+{
+    const auto triangleCount = indices.size() / 3;
+    std::multimap<std::tuple<uint32_t, uint32_t, uint32_t>, size_t> trianglesByVertices;
+    std::vector<size_t> remainingTriangles(vertexCount, 0);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        trianglesByVertices.emplace(std::make_tuple(indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]), t);
+        for (size_t k = 0; k < 3; ++k) {
+            ++remainingTriangles[indices[3 * t + k]];
+        }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> cache;
+    evictionsAfterTailHits = 0;
+    for (size_t output = 0; output < triangleCount; ++output)
+    {
+        const auto cachePosition = [&](uint32_t v)
+        {
+            const auto it = std::find(begin(cache), end(cache), v);
+            return it == end(cache) ? -1 : int(it - begin(cache));
+        };
+        const auto triangleScore = [&](size_t t)
+        {
+            return vertexScore(cachePosition(indices[3 * t]), remainingTriangles[indices[3 * t]])
+                + vertexScore(cachePosition(indices[3 * t + 1]), remainingTriangles[indices[3 * t + 1]])
+                + vertexScore(cachePosition(indices[3 * t + 2]), remainingTriangles[indices[3 * t + 2]]);
+        };
+
+        const auto range = trianglesByVertices.equal_range(std::make_tuple(optimized[3 * output], optimized[3 * output + 1], optimized[3 * output + 2]));
+        if (range.first == range.second)
+        {
+            std::cerr << "Triangle " << output << " of the optimized indices is not in the input" << std::endl;
+            return false;
+        }
+        const auto chosen = range.first->second;
+        trianglesByVertices.erase(range.first);
+
+        // The first triangle is the best of all, the next ones the best of those adjacent to the cache
+        auto bestScore = -1e9f;
+        auto firstLeft = triangleCount;
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            if (emitted[t]) {
+                continue;
+            }
+            firstLeft = std::min(firstLeft, t);
+            if (output == 0 || cachePosition(indices[3 * t]) >= 0 || cachePosition(indices[3 * t + 1]) >= 0 || cachePosition(indices[3 * t + 2]) >= 0) {
+                bestScore = std::max(bestScore, triangleScore(t));
+            }
+        }
+        const auto hasCandidate = bestScore > -1e9f;
+        if (hasCandidate ? triangleScore(chosen) < bestScore - 1e-3f : chosen != firstLeft)
+        {
+            std::cerr << "Triangle " << output << " of the optimized indices scores " << triangleScore(chosen) << ", the best candidate " << bestScore << std::endl;
+            return false;
+        }
+
+        emitted[chosen] = true;
+        std::vector<uint32_t> newCache(begin(indices) + 3 * chosen, begin(indices) + 3 * chosen + 3);
+        auto tailHit = false;
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            if (std::find(begin(newCache), begin(newCache) + 3, cache[i]) == begin(newCache) + 3) {
+                newCache.push_back(cache[i]);
+            }
+            else {
+                tailHit = tailHit || (cache.size() == CacheSize && i >= CacheSize - 3);
+            }
+        }
+        if (tailHit && newCache.size() > CacheSize) {
+            ++evictionsAfterTailHits;
+        }
+        newCache.resize(std::min(newCache.size(), CacheSize));
+        cache = std::move(newCache);
+        for (size_t k = 0; k < 3; ++k) {
+            --remainingTriangles[indices[3 * chosen + k]];
+        }
+    }
+    return true;
+}
+
+// Triangles sharing a few vertices of high valence, found by a random search: the cache is full when triangles reuse its last vertices, and
+// stale scores of the vertices they evict change the order
+const uint32_t TailReuseIndices[] = {
+    26, 4, 42, 38, 18, 37, 2, 33, 28, 0, 32, 15, 39, 0, 1, 39, 44, 24, 13, 9, 38, 11, 26, 42, 1, 13, 35, 11, 1, 32,
+    46, 33, 45, 0, 21, 25, 2, 41, 32, 2, 31, 39, 23, 10, 29, 43, 2, 46, 0, 14, 41, 27, 13, 1, 17, 47, 14, 17, 2, 33,
+    35, 15, 23, 38, 43, 1, 2, 22, 23, 37, 30, 49, 37, 26, 24, 12, 22, 15, 19, 42, 21, 25, 32, 28, 19, 22, 39, 21, 31, 29,
+    0, 32, 44, 21, 49, 2, 23, 24, 0, 0, 2, 24, 16, 23, 2, 41, 44, 50, 43, 23, 42, 18, 34, 37, 51, 50, 30, 45, 25, 0,
+    32, 1, 25, 2, 1, 35, 36, 39, 1, 21, 1, 19, 29, 42, 46, 49, 39, 41, 45, 2, 53, 39, 50, 27, 27, 38, 0, 1, 23, 36,
+    39, 34, 23
+};
+const size_t TailReuseVertexCount = 54;
+
+template<typename Function>
+double measure(Function && f)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto appPath = glmlv::fs::path{ argv[0] };
+    const auto objPath = argc > 1 ? glmlv::fs::path{ argv[1] } : appPath.parent_path() / "assets" / "forward-renderer" / "models/crytek-sponza/sponza.obj";
+
+    // Rows of quads drawn in order, then a mesh whose triangles reuse the vertices at the end of the cache
+    const size_t gridSize = 16;
+    std::vector<uint32_t> gridIndices;
+    for (uint32_t y = 0; y < gridSize; ++y)
+    {
+        for (uint32_t x = 0; x < gridSize; ++x)
+        {
+            const auto v = uint32_t(y * (gridSize + 1) + x);
+            const uint32_t quad[6] = { v, v + 1, uint32_t(v + gridSize + 1), v + 1, uint32_t(v + gridSize + 2), uint32_t(v + gridSize + 1) };
+            gridIndices.insert(end(gridIndices), quad, quad + 6);
+        }
+    }
+    const std::vector<uint32_t> tailReuseIndices(std::begin(TailReuseIndices), std::end(TailReuseIndices));
+    const auto check = [](const char * name, const std::vector<uint32_t> & indices, size_t vertexCount)
+    {
+        std::vector<uint32_t> optimized(indices.size());
+        glmlv::optimizeVertexCache(optimized.data(), indices.data(), indices.size());
+        size_t evictionsAfterTailHits = 0;
+        if (!checkVertexCacheOrder(indices, optimized, vertexCount, evictionsAfterTailHits))
+        {
+            std::cerr << "optimizeVertexCache check failed on " << name << std::endl;
+            return false;
+        }
+        std::cout << "optimizeVertexCache check passed on " << name << " (" << evictionsAfterTailHits << " evictions after triangles reusing the end of the cache)" << std::endl;
+        return true;
+    };
+    if (!check("a 16x16 grid", gridIndices, (gridSize + 1) * (gridSize + 1)) || !check("the tail reuse mesh", tailReuseIndices, TailReuseVertexCount)) {
+        return 1;
+    }
+
+    try {
+        glmlv::ObjData data;
+        glmlv::loadObjCached(objPath, data, false);
+        std::cout << objPath << ": " << data.indexBuffer.size() / 3 << " triangles, " << data.indexCountPerShape.size() << " shapes" << std::endl;
+
+        auto cacheOptimized = data.indexBuffer;
+        const auto vertexCacheTime = measure([&]()
+        {
+            size_t indexOffset = 0;
+            for (const auto indexCount : data.indexCountPerShape)
+            {
+                glmlv::optimizeVertexCache(cacheOptimized.data() + indexOffset, data.indexBuffer.data() + indexOffset, indexCount);
+                indexOffset += indexCount;
+            }
+        });
+        const auto before = glmlv::analyzeVertexCache(data.indexBuffer.data(), data.indexBuffer.size());
+        const auto after = glmlv::analyzeVertexCache(cacheOptimized.data(), cacheOptimized.size());
+        std::cout << "optimizeVertexCache: " << vertexCacheTime << " ms on 1 thread, ACMR " << before.acmr << " -> " << after.acmr << std::endl;
+
+        glmlv::MeshOptimizationStatistics stats;
+        const auto meshTime = measure([&]() { stats = glmlv::optimizeMesh(data); });
+        std::cout << "optimizeMesh: " << meshTime << " ms, ACMR " << stats.before.acmr << " -> " << stats.after.acmr << ", ATVR "
+            << stats.before.atvr << " -> " << stats.after.atvr << std::endl;
+    }
+    catch (const std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
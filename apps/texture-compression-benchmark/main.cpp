@@ -0,0 +1,130 @@
+#include <glmlv/texture_compression.hpp>
+#include <glmlv/Image2DRGBA.hpp>
+#include <glmlv/filesystem.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// CPU benchmark of the block compression encoder: PSNR and encoding throughput of BC1, BC3 and BC5 over a set of images.
+// Usage: texture-compression-benchmark [directory or images...]
+// The default is the textures directory of the crytek-sponza model of the forward-renderer assets.
+
+// stb_image asserts on PNG files with less than 8 bits per channel (e.g. the 1-bit masks of crytek-sponza, which are not used by the renderers)
+static bool isSupportedImage(const glmlv::fs::path & path)
+{
+    static const unsigned char PNGSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    unsigned char header[25]; // Signature, then the IHDR chunk whose bit depth is at offset 24
+    std::ifstream input(path.string(), std::ios::binary);
+    if (!input.read((char *) header, sizeof(header)) || !std::equal(std::begin(PNGSignature), std::end(PNGSignature), header)) {
+        return true;
+    }
+    return header[24] >= 8;
+}
+
+int main(int argc, char** argv)
+{
+    const auto appPath = glmlv::fs::path{ argv[0] };
+
+    std::vector<glmlv::fs::path> paths;
+    const auto addPaths = [&](const glmlv::fs::path & path)
+    {
+        if (!glmlv::fs::is_directory(path))
+        {
+            paths.emplace_back(path);
+            return;
+        }
+        for (const auto & entry : glmlv::fs::directory_iterator(path))
+        {
+            auto extension = entry.path().extension().string();
+            std::transform(begin(extension), end(extension), begin(extension), ::tolower);
+            if (extension == ".png" || extension == ".jpg" || extension == ".tga" || extension == ".bmp") {
+                paths.emplace_back(entry.path());
+            }
+        }
+    };
+    if (argc > 1)
+    {
+        for (auto i = 1; i < argc; ++i) {
+            addPaths(argv[i]);
+        }
+    }
+    else {
+        addPaths(appPath.parent_path() / "assets" / "forward-renderer" / "models/crytek-sponza/textures");
+    }
+    std::sort(begin(paths), end(paths));
+
+    struct FormatStatistics
+    {
+        const char * name;
+        glmlv::BlockFormat format;
+        size_t channelCount; // Channels used to compute the PSNR
+        double encodingTime = 0.; // Seconds
+        double psnrSum = 0.;
+        size_t losslessCount = 0; // Images with an infinite PSNR, not accounted in psnrSum
+    };
+    FormatStatistics statistics[] = {
+        { "BC1", glmlv::BlockFormat::BC1, 3 },
+        { "BC3", glmlv::BlockFormat::BC3, 4 },
+        { "BC5", glmlv::BlockFormat::BC5, 2 }
+    };
+
+    size_t pixelCount = 0, imageCount = 0;
+    size_t uncompressedSize = 0, compressedSize = 0; // With the format chosen for each image
+    try {
+        for (const auto & path : paths)
+        {
+            if (!isSupportedImage(path))
+            {
+                std::cout << path.filename().string() << ": skipped, less than 8 bits per channel" << std::endl;
+                continue;
+            }
+            const auto image = glmlv::readImage(path);
+            pixelCount += image.size();
+            ++imageCount;
+            uncompressedSize += image.size() * glmlv::Image2DRGBA::NumComponents;
+
+            const auto chosenFormat = glmlv::chooseBlockFormat(image);
+            std::cout << path.filename().string() << " (" << image.width() << "x" << image.height() << "):";
+            for (auto & formatStatistics : statistics)
+            {
+                const auto startTime = std::chrono::steady_clock::now();
+                const auto compressed = glmlv::compressImage(image, formatStatistics.format);
+                formatStatistics.encodingTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+                const auto psnr = glmlv::computePSNR(image, glmlv::decompressImage(compressed), formatStatistics.channelCount);
+                if (std::isinf(psnr)) {
+                    ++formatStatistics.losslessCount;
+                }
+                else {
+                    formatStatistics.psnrSum += psnr;
+                }
+                if (formatStatistics.format == chosenFormat) {
+                    compressedSize += compressed.data.size();
+                }
+                std::cout << " " << formatStatistics.name << " " << psnr << " dB" << (formatStatistics.format == chosenFormat ? " (chosen)" : "");
+            }
+            std::cout << std::endl;
+        }
+    }
+    catch (const std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << imageCount << " images, " << pixelCount * 1e-6 << " Mpixels, using " << glmlv::defaultThreadCount() << " threads" << std::endl;
+    for (const auto & formatStatistics : statistics)
+    {
+        const auto lossyCount = imageCount - formatStatistics.losslessCount;
+        std::cout << formatStatistics.name << ": " << pixelCount * 1e-6 / formatStatistics.encodingTime << " Mpixels/s, average PSNR "
+            << (lossyCount ? formatStatistics.psnrSum / lossyCount : 0.) << " dB (" << formatStatistics.losslessCount << " lossless images)" << std::endl;
+    }
+    std::cout << "Size with the chosen formats: " << compressedSize * 1e-6 << " MB instead of " << uncompressedSize * 1e-6 << " MB" << std::endl;
+
+    return 0;
+}
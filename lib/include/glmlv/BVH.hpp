@@ -0,0 +1,311 @@
+#pragma once
+
+#include <glmlv/load_obj.hpp>
+#include <glmlv/frustum_culling.hpp>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLMLV_BVH_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace glmlv
+{
+
+struct Ray
+{
+    glm::vec3 origin;
+    glm::vec3 direction; // Distances along the ray are expressed in lengths of direction
+};
+
+// Bounding volume hierarchy over primitives given by their bounding boxes.
+// It is built top-down with a binned surface area heuristic; the top levels are split sequentially, then subtrees are built in parallel.
+class BVH
+{
+public:
+    // Nodes are stored in depth-first order: the first child of an inner node directly follows it, and two nodes fill a cache line
+    struct Node
+    {
+        glm::vec3 bboxMin;
+        uint32_t offset; // Leaf: index of its first primitive in primitiveIndices(); inner node: index of its second child
+        glm::vec3 bboxMax;
+        uint16_t primitiveCount; // 0 for inner nodes
+        uint16_t splitAxis;
+
+        bool isLeaf() const
+        {
+            return primitiveCount > 0;
+        }
+    };
+
+    BVH() = default;
+
+    BVH(const std::vector<glm::vec3> & bboxMin, const std::vector<glm::vec3> & bboxMax, size_t maxLeafSize = 4);
+
+    const std::vector<Node> & nodes() const
+    {
+        return m_Nodes;
+    }
+
+    // Indices of the primitives, in the order of the leaves
+    const std::vector<uint32_t> & primitiveIndices() const
+    {
+        return m_PrimitiveIndices;
+    }
+
+    // Visit the leaves hit by the ray in [0, tMax], nearest children first.
+    // intersectLeaf(firstPrimitive, primitiveCount, tMax) is called with positions in primitiveIndices(); it can shorten tMax,
+    // and returns true to stop the traversal.
+    template<typename IntersectLeaf>
+    void traverse(const Ray & ray, float tMax, IntersectLeaf && intersectLeaf) const;
+
+    // Call onLeaf(firstPrimitive, primitiveCount) for each leaf whose box intersects the frustum (conservative test)
+    template<typename OnLeaf>
+    void traverse(const Frustum & frustum, OnLeaf && onLeaf) const;
+
+private:
+    std::vector<Node> m_Nodes;
+    std::vector<uint32_t> m_PrimitiveIndices;
+};
+
+struct RayHit
+{
+    float t = std::numeric_limits<float>::max();
+    uint32_t shape = ~uint32_t(0);
+    uint32_t triangle = ~uint32_t(0); // Index of the triangle in ObjData::indexBuffer (its first index is 3 * triangle)
+    glm::vec2 barycentrics; // Weights of the second and third vertices of the triangle
+};
+
+// Spatial queries over the triangles and the shapes of an ObjData
+class SceneBVH
+{
+public:
+    SceneBVH() = default;
+
+    explicit SceneBVH(const ObjData & data);
+
+    // Nearest hit in [0, tMax]
+    bool intersect(const Ray & ray, RayHit & hit, float tMax = std::numeric_limits<float>::max()) const;
+
+    // Any hit in [0, tMax], for shadow and occlusion rays
+    bool occluded(const Ray & ray, float tMax) const;
+
+    // Set visible[shape] to 1 if the bounding box of the shape intersects the frustum; returns the number of visible shapes
+    size_t cullShapes(const Frustum & frustum, std::vector<uint8_t> & visible) const;
+
+    const BVH & triangleBVH() const
+    {
+        return m_TriangleBVH;
+    }
+
+    const BVH & shapeBVH() const
+    {
+        return m_ShapeBVH;
+    }
+
+private:
+    // Precomputed for the Moller-Trumbore test, in the leaf order of m_TriangleBVH
+    struct Triangle
+    {
+        glm::vec3 v0;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+        uint32_t shape;
+        uint32_t index;
+    };
+
+    template<bool AnyHit>
+    bool intersectTriangles(const Ray & ray, uint32_t first, uint32_t count, float & tMax, RayHit * pHit) const;
+
+    BVH m_TriangleBVH;
+    BVH m_ShapeBVH;
+    std::vector<Triangle> m_Triangles;
+};
+
+namespace detail
+{
+
+// Ray with its precomputed inverse direction for the slab test
+struct BVHRay
+{
+#ifdef GLMLV_BVH_USE_SSE
+    __m128 origin;
+    __m128 invDirection;
+    __m128 xyzMask;
+#else
+    glm::vec3 origin;
+    glm::vec3 invDirection;
+#endif
+
+    explicit BVHRay(const Ray & ray)
+    {
+        const auto invDirection3 = 1.f / ray.direction;
+#ifdef GLMLV_BVH_USE_SSE
+        origin = _mm_setr_ps(ray.origin.x, ray.origin.y, ray.origin.z, 0.f);
+        this->invDirection = _mm_setr_ps(invDirection3.x, invDirection3.y, invDirection3.z, 0.f);
+        xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+#else
+        origin = ray.origin;
+        this->invDirection = invDirection3;
+#endif
+    }
+
+    // Slab test: returns true and the entry distance if the ray hits the box of node in [0, tMax]
+    bool intersect(const BVH::Node & node, float tMax, float & tEntry) const
+    {
+#ifdef GLMLV_BVH_USE_SSE
+        // The fourth lane of each loaded vector holds an integer of the node: it is masked out before any float arithmetic
+        const auto bboxMin = _mm_and_ps(_mm_loadu_ps(&node.bboxMin.x), xyzMask);
+        const auto bboxMax = _mm_and_ps(_mm_loadu_ps(&node.bboxMax.x), xyzMask);
+        const auto t0 = _mm_mul_ps(_mm_sub_ps(bboxMin, origin), invDirection);
+        const auto t1 = _mm_mul_ps(_mm_sub_ps(bboxMax, origin), invDirection);
+        // Fourth lane: 0 for the entry (the ray starts at t = 0) and tMax for the exit
+        auto tNear = _mm_min_ps(t0, t1);
+        auto tFar = _mm_or_ps(_mm_and_ps(xyzMask, _mm_max_ps(t0, t1)), _mm_andnot_ps(xyzMask, _mm_set1_ps(tMax)));
+        tNear = _mm_max_ps(tNear, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(2, 3, 0, 1)));
+        tNear = _mm_max_ps(tNear, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(1, 0, 3, 2)));
+        tFar = _mm_min_ps(tFar, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(2, 3, 0, 1)));
+        tFar = _mm_min_ps(tFar, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(1, 0, 3, 2)));
+        tEntry = _mm_cvtss_f32(tNear);
+        return tEntry <= _mm_cvtss_f32(tFar);
+#else
+        const auto t0 = (node.bboxMin - origin) * invDirection;
+        const auto t1 = (node.bboxMax - origin) * invDirection;
+        const auto tNear = glm::min(t0, t1);
+        const auto tFar = glm::max(t0, t1);
+        tEntry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.f));
+        return tEntry <= glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+#endif
+    }
+};
+
+}
+
+template<typename IntersectLeaf>
+void BVH::traverse(const Ray & ray, float tMax, IntersectLeaf && intersectLeaf) const
+{
+    if (m_Nodes.empty()) {
+        return;
+    }
+
+    const detail::BVHRay bvhRay(ray);
+    float tEntry;
+    if (!bvhRay.intersect(m_Nodes[0], tMax, tEntry)) {
+        return;
+    }
+
+    struct StackEntry
+    {
+        uint32_t node;
+        float tEntry;
+    };
+    StackEntry stack[64];
+    size_t stackSize = 0;
+    uint32_t current = 0;
+
+    for (;;)
+    {
+        const auto & node = m_Nodes[current];
+        if (node.isLeaf())
+        {
+            if (intersectLeaf(node.offset, uint32_t(node.primitiveCount), tMax)) {
+                return;
+            }
+        }
+        else
+        {
+            const uint32_t children[2] = { current + 1, node.offset };
+            float tChildren[2];
+            const bool hits[2] = { bvhRay.intersect(m_Nodes[children[0]], tMax, tChildren[0]), bvhRay.intersect(m_Nodes[children[1]], tMax, tChildren[1]) };
+            if (hits[0] && hits[1])
+            {
+                const auto nearest = tChildren[0] <= tChildren[1] ? 0 : 1;
+                stack[stackSize++] = StackEntry{ children[1 - nearest], tChildren[1 - nearest] };
+                current = children[nearest];
+                continue;
+            }
+            if (hits[0] || hits[1])
+            {
+                current = children[hits[0] ? 0 : 1];
+                continue;
+            }
+        }
+
+        // Pop the next node, skipping those entered beyond the current hit
+        for (;;)
+        {
+            if (!stackSize) {
+                return;
+            }
+            const auto & entry = stack[--stackSize];
+            if (entry.tEntry <= tMax)
+            {
+                current = entry.node;
+                break;
+            }
+        }
+    }
+}
+
+template<typename OnLeaf>
+void BVH::traverse(const Frustum & frustum, OnLeaf && onLeaf) const
+{
+    if (m_Nodes.empty()) {
+        return;
+    }
+
+    // Nodes are pushed with the mask of the planes they may still cross, so that children of nodes inside a plane skip its test
+    struct StackEntry
+    {
+        uint32_t node;
+        uint32_t planeMask;
+    };
+    StackEntry stack[64];
+    size_t stackSize = 0;
+    stack[stackSize++] = StackEntry{ 0, (1u << 6) - 1 };
+
+    while (stackSize)
+    {
+        const auto entry = stack[--stackSize];
+        const auto & node = m_Nodes[entry.node];
+
+        const auto center = 0.5f * (node.bboxMin + node.bboxMax);
+        const auto extent = 0.5f * (node.bboxMax - node.bboxMin);
+        auto planeMask = entry.planeMask;
+        auto outside = false;
+        for (size_t p = 0; p < 6 && !outside; ++p)
+        {
+            if (!(planeMask & (1u << p))) {
+                continue;
+            }
+            const auto & plane = frustum.planes[p];
+            const auto distance = glm::dot(glm::vec3(plane), center) + plane.w;
+            const auto radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+            if (distance + radius < 0.f) {
+                outside = true;
+            }
+            else if (distance - radius >= 0.f) {
+                planeMask &= ~(1u << p);
+            }
+        }
+        if (outside) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            onLeaf(node.offset, uint32_t(node.primitiveCount));
+        }
+        else
+        {
+            stack[stackSize++] = StackEntry{ node.offset, planeMask };
+            stack[stackSize++] = StackEntry{ entry.node + 1, planeMask };
+        }
+    }
+}
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace glmlv
+{
+
+// Hash map with open addressing and linear probing, storing keys and values inline in a single array.
+// It does no allocation per element and a lookup usually reads a single cache line; elements cannot be erased.
+// A key value reserved as "empty" marker must be given at construction and never inserted.
+// Slots are laid out as { key, value } so that, for instance, a 96-bit key with a 32-bit value fills exactly 16 bytes.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap
+{
+public:
+    struct Slot
+    {
+        Key key;
+        Value value;
+    };
+
+    explicit FlatHashMap(const Key & emptyKey, size_t expectedSize = 0, const Hash & hash = Hash(), const KeyEqual & keyEqual = KeyEqual()):
+        m_EmptyKey(emptyKey), m_Hash(hash), m_KeyEqual(keyEqual)
+    {
+        reserve(expectedSize);
+    }
+
+    size_t size() const
+    {
+        return m_nSize;
+    }
+
+    bool empty() const
+    {
+        return m_nSize == 0;
+    }
+
+    // Grow the table so that count elements can be inserted without rehashing
+    void reserve(size_t count)
+    {
+        size_t capacity = 16;
+        while (capacity * MaxLoadNumerator < count * MaxLoadDenominator) {
+            capacity *= 2;
+        }
+        if (capacity > m_Slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // Insert (key, value) if key is not in the map.
+    // Returns a pointer to the value associated to key and true if the insertion took place, with a single hash and probe.
+    std::pair<Value *, bool> insert(const Key & key, const Value & value)
+    {
+        if ((m_nSize + 1) * MaxLoadDenominator > m_Slots.size() * MaxLoadNumerator) {
+            rehash(2 * m_Slots.size());
+        }
+
+        auto & slot = probe(key);
+        if (!isEmpty(slot)) {
+            return { &slot.value, false };
+        }
+        slot.key = key;
+        slot.value = value;
+        ++m_nSize;
+        return { &slot.value, true };
+    }
+
+    // Returns nullptr if key is not in the map
+    const Value * find(const Key & key) const
+    {
+        const auto & slot = const_cast<FlatHashMap *>(this)->probe(key);
+        return isEmpty(slot) ? nullptr : &slot.value;
+    }
+
+    Value * find(const Key & key)
+    {
+        auto & slot = probe(key);
+        return isEmpty(slot) ? nullptr : &slot.value;
+    }
+
+    void clear()
+    {
+        for (auto & slot : m_Slots) {
+            slot.key = m_EmptyKey;
+        }
+        m_nSize = 0;
+    }
+
+    // Call f(key, value) for each element, in unspecified order
+    template<typename Function>
+    void forEach(Function && f) const
+    {
+        for (const auto & slot : m_Slots) {
+            if (!isEmpty(slot)) {
+                f(slot.key, slot.value);
+            }
+        }
+    }
+
+private:
+    static const size_t MaxLoadNumerator = 3;
+    static const size_t MaxLoadDenominator = 4;
+
+    bool isEmpty(const Slot & slot) const
+    {
+        return m_KeyEqual(slot.key, m_EmptyKey);
+    }
+
+    // Fibonacci hashing spreads the bits of weak hash functions over the whole table
+    size_t slotIndex(const Key & key) const
+    {
+        return size_t((uint64_t(m_Hash(key)) * 0x9E3779B97F4A7C15ull) >> m_nShift);
+    }
+
+    // Returns the slot containing key, or the empty slot where it should be inserted
+    Slot & probe(const Key & key)
+    {
+        const auto mask = m_Slots.size() - 1;
+        for (auto i = slotIndex(key);; i = (i + 1) & mask)
+        {
+            auto & slot = m_Slots[i];
+            if (isEmpty(slot) || m_KeyEqual(slot.key, key)) {
+                return slot;
+            }
+        }
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> oldSlots(capacity, Slot{ m_EmptyKey, Value() });
+        std::swap(oldSlots, m_Slots);
+
+        m_nShift = 64;
+        for (auto c = capacity; c > 1; c /= 2) {
+            --m_nShift;
+        }
+
+        for (const auto & slot : oldSlots) {
+            if (!isEmpty(slot)) {
+                probe(slot.key) = slot;
+            }
+        }
+    }
+
+    std::vector<Slot> m_Slots;
+    size_t m_nSize = 0;
+    size_t m_nShift = 64;
+    Key m_EmptyKey;
+    Hash m_Hash;
+    KeyEqual m_KeyEqual;
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glmlv/texture_compression.hpp>
+
+#include <glad/glad.h>
+
+#include <vector>
+
+namespace glmlv
+{
+
+// Block compressed textures accessed by shaders through ARB_bindless_texture handles (e.g. stored in a buffer, as uvec2 converted to sampler2D)
+// instead of texture units, so that drawing with another texture needs no bind call. Every handle is resident until the object is destroyed.
+class GLBindlessTextures
+{
+public:
+    // True if the current context exposes GL_ARB_bindless_texture. The extension is not loaded by glad: its entry points are loaded here with glfwGetProcAddress,
+    // so this must be called, and return true, before adding any texture.
+    static bool isSupported();
+
+    GLBindlessTextures() = default;
+
+    ~GLBindlessTextures();
+
+    GLBindlessTextures(const GLBindlessTextures&) = delete;
+    GLBindlessTextures& operator =(const GLBindlessTextures&) = delete;
+
+    GLBindlessTextures(GLBindlessTextures&& rvalue);
+    GLBindlessTextures& operator =(GLBindlessTextures&& rvalue);
+
+    // Upload the texture and return the resident handle of its combination with sampler. Neither can be modified afterwards.
+    GLuint64 add(const CompressedImage2D & texture, GLuint sampler)
+    {
+        return add(texture, texture.data.data(), sampler);
+    }
+
+    // Same, with the levels read from levels instead of texture.data (which can be empty): an offset in the bound GL_PIXEL_UNPACK_BUFFER, if any
+    GLuint64 add(const CompressedImage2D & texture, const GLvoid * levels, GLuint sampler);
+
+    size_t size() const
+    {
+        return m_glIds.size();
+    }
+
+private:
+    void release();
+
+    std::vector<GLuint> m_glIds;
+    std::vector<GLuint64> m_handles;
+};
+
+}
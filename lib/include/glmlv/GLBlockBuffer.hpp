@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <utility>
+#include <vector>
+
+namespace glmlv
+{
+
+// Buffer of elements of T, the C++ structure of a std140 uniform block or of the elements of a std430 shader storage array, bound to the
+// binding of the block with bindBase(GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER, binding).
+// The shader layouts do not follow C++ alignment rules, so T is padded by hand: vec3 members are followed by a scalar, mat3 are declared as mat4,
+// and std140 arrays of scalars or vec2 as vec4 arrays (their stride is 16 bytes). GLProgram::checkBlockLayout compares T with the layout of
+// the block in a program, to be done once after linking.
+template<typename T>
+class GLBlockBuffer
+{
+public:
+    GLBlockBuffer() = default;
+
+    ~GLBlockBuffer()
+    {
+        glDeleteBuffers(1, &m_GLId);
+    }
+
+    GLBlockBuffer(const GLBlockBuffer&) = delete;
+    GLBlockBuffer& operator =(const GLBlockBuffer&) = delete;
+
+    GLBlockBuffer(GLBlockBuffer&& rvalue)
+    {
+        *this = std::move(rvalue);
+    }
+
+    GLBlockBuffer& operator =(GLBlockBuffer&& rvalue)
+    {
+        std::swap(m_GLId, rvalue.m_GLId);
+        std::swap(m_nSize, rvalue.m_nSize);
+        std::swap(m_nCapacity, rvalue.m_nCapacity);
+        return *this;
+    }
+
+    // Replace the content of the buffer by count elements. A buffer too small is replaced by a larger one, whose name (glId()) differs, so it
+    // must be bound after the update. An update with no element only empties the buffer (OpenGL cannot create a buffer of size 0).
+    void update(const T * elements, size_t count)
+    {
+        if (!count)
+        {
+            m_nSize = 0;
+            return;
+        }
+        if (count > m_nCapacity)
+        {
+            glDeleteBuffers(1, &m_GLId);
+            glGenBuffers(1, &m_GLId);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_GLId);
+            glBufferStorage(GL_COPY_WRITE_BUFFER, count * sizeof(T), nullptr, GL_DYNAMIC_STORAGE_BIT);
+            m_nCapacity = count;
+        }
+        else {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_GLId);
+        }
+        glBufferSubData(GL_COPY_WRITE_BUFFER, 0, count * sizeof(T), elements);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_nSize = count;
+    }
+
+    void update(const T & element)
+    {
+        update(&element, 1);
+    }
+
+    void update(const std::vector<T> & elements)
+    {
+        update(elements.data(), elements.size());
+    }
+
+    // Bind the whole buffer to binding of target, GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER (nothing is bound before the first update)
+    void bindBase(GLenum target, GLuint binding) const
+    {
+        glBindBufferBase(target, binding, m_GLId);
+    }
+
+    GLuint glId() const
+    {
+        return m_GLId;
+    }
+
+    // Number of elements of the last update
+    size_t size() const
+    {
+        return m_nSize;
+    }
+
+private:
+    GLuint m_GLId = 0;
+    size_t m_nSize = 0;
+    size_t m_nCapacity = 0;
+};
+
+}
@@ -2,11 +2,36 @@
 
 #include "GLShader.hpp"
 #include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <cstdint>
 #include <iostream>
+#include <vector>
 
 namespace glmlv
 {
 
+// C++ mirror of a std140 uniform block or of a std430 shader storage block (see GLBlockBuffer), to be checked against the layout reflected
+// from a program by GLProgram::checkBlockLayout
+struct BlockLayout
+{
+    struct Member
+    {
+        std::string name; // As reflected by OpenGL: "a[0]" for arrays, "s.m" for members of structures, "a[0].m" for arrays of structures
+        size_t offset; // offsetof the member in the structure
+        size_t size; // sizeof the member, arrays included
+    };
+
+    size_t size; // sizeof the structure
+    std::vector<Member> members;
+};
+
+// Programs reflect their active uniforms once linked: names are found in a perfect hash table built for them, and the typed setters only call
+// glProgramUniform* when the value differs from the last one set through them (values set directly with glUniform* are not tracked).
+// Uniforms missing from the program are reported when they are looked up, and active uniforms never looked up by checkUniformsLookedUp.
 class GLProgram {
     GLuint m_GLId;
     typedef std::unique_ptr<char[]> CharBuffer;
@@ -22,14 +47,21 @@ public:
 
     GLProgram& operator =(const GLProgram&) = delete;
 
-    GLProgram(GLProgram&& rvalue) : m_GLId(rvalue.m_GLId) {
+    GLProgram(GLProgram&& rvalue) :
+        m_GLId(rvalue.m_GLId),
+        m_uniforms(std::move(rvalue.m_uniforms)),
+        m_reportedUniformNames(std::move(rvalue.m_reportedUniformNames)),
+        m_lookedUpUniforms(std::move(rvalue.m_lookedUpUniforms)) {
         rvalue.m_GLId = 0;
     }
 
     GLProgram& operator =(GLProgram&& rvalue) {
-        this->~GLProgram();
+        glDeleteProgram(m_GLId);
         m_GLId = rvalue.m_GLId;
         rvalue.m_GLId = 0;
+        m_uniforms = std::move(rvalue.m_uniforms);
+        m_reportedUniformNames = std::move(rvalue.m_reportedUniformNames);
+        m_lookedUpUniforms = std::move(rvalue.m_lookedUpUniforms);
         return *this;
     }
 
@@ -41,9 +73,14 @@ public:
         glAttachShader(m_GLId, shader.glId());
     }
 
+    // Link, then reflect the uniforms if the link succeeds
     bool link() {
         glLinkProgram(m_GLId);
-        return getLinkStatus();
+        if (!getLinkStatus()) {
+            return false;
+        }
+        reflectUniforms();
+        return true;
     }
 
     bool getLinkStatus() const {
@@ -66,11 +103,28 @@ public:
         glUseProgram(m_GLId);
     }
 
+    // Build the table of the active uniforms (outside of uniform blocks) with glGetProgramResourceiv. Done by link(); to be called after linking
+    // otherwise (e.g. glProgramBinary, or glLinkProgram without querying the status, as compilePrograms).
+    void reflectUniforms();
+
+    // Location of an active uniform, without calling OpenGL. Returns -1 if the program has no such uniform, because it is not declared (e.g. a
+    // misspelled name) or because the compiler removed it as unused; this is reported once per name on std::cerr.
     GLint getUniformLocation(const GLchar* name) const {
-        GLint location = glGetUniformLocation(m_GLId, name);
+        const auto location = findUniformLocation(name);
+        if (location < 0) {
+            reportMissingUniform(name);
+        }
         return location;
     }
 
+    // Same without report, for uniforms that are not used by every permutation of a shader
+    GLint findUniformLocation(const GLchar* name) const;
+
+    // Report on std::cerr the active uniforms whose location has never been looked up by name (getUniformLocation, findUniformLocation or
+    // setUniform by name), i.e. that the application never sets, e.g. because it looks up a misspelled name. An array counts as looked up once
+    // one of its elements is. To be called once the locations are looked up, after linking; returns false if there is any.
+    bool checkUniformsLookedUp() const;
+
     GLint getAttribLocation(const GLchar* name) const {
         GLint location = glGetAttribLocation(m_GLId, name);
         return location;
@@ -79,6 +133,103 @@ public:
     void bindAttribLocation(GLuint index, const GLchar* name) const {
         glBindAttribLocation(m_GLId, index, name);
     }
+
+    // Typed setters of the uniform at location, ignored if location is -1. Integers also set samplers and images. A value of the wrong type is
+    // reported on std::cerr, and not set.
+    void setUniform(GLint location, GLint value) {
+        if (updateUniformValue(location, GL_INT, &value, sizeof(value))) {
+            glProgramUniform1i(m_GLId, location, value);
+        }
+    }
+
+    void setUniform(GLint location, GLuint value) {
+        if (updateUniformValue(location, GL_UNSIGNED_INT, &value, sizeof(value))) {
+            glProgramUniform1ui(m_GLId, location, value);
+        }
+    }
+
+    void setUniform(GLint location, GLfloat value) {
+        if (updateUniformValue(location, GL_FLOAT, &value, sizeof(value))) {
+            glProgramUniform1f(m_GLId, location, value);
+        }
+    }
+
+    void setUniform(GLint location, const glm::vec2& value) {
+        if (updateUniformValue(location, GL_FLOAT_VEC2, &value[0], sizeof(value))) {
+            glProgramUniform2fv(m_GLId, location, 1, &value[0]);
+        }
+    }
+
+    void setUniform(GLint location, const glm::vec3& value) {
+        if (updateUniformValue(location, GL_FLOAT_VEC3, &value[0], sizeof(value))) {
+            glProgramUniform3fv(m_GLId, location, 1, &value[0]);
+        }
+    }
+
+    void setUniform(GLint location, const glm::vec4& value) {
+        if (updateUniformValue(location, GL_FLOAT_VEC4, &value[0], sizeof(value))) {
+            glProgramUniform4fv(m_GLId, location, 1, &value[0]);
+        }
+    }
+
+    void setUniform(GLint location, const glm::ivec4& value) {
+        if (updateUniformValue(location, GL_INT_VEC4, &value[0], sizeof(value))) {
+            glProgramUniform4iv(m_GLId, location, 1, &value[0]);
+        }
+    }
+
+    void setUniform(GLint location, const glm::mat3& value) {
+        if (updateUniformValue(location, GL_FLOAT_MAT3, &value[0][0], sizeof(value))) {
+            glProgramUniformMatrix3fv(m_GLId, location, 1, GL_FALSE, &value[0][0]);
+        }
+    }
+
+    void setUniform(GLint location, const glm::mat4& value) {
+        if (updateUniformValue(location, GL_FLOAT_MAT4, &value[0][0], sizeof(value))) {
+            glProgramUniformMatrix4fv(m_GLId, location, 1, GL_FALSE, &value[0][0]);
+        }
+    }
+
+    // Same by name (see getUniformLocation)
+    template<typename T>
+    void setUniform(const GLchar* name, const T& value) {
+        setUniform(getUniformLocation(name), value);
+    }
+
+    // Compare layout with the block blockName of blockInterface (GL_UNIFORM_BLOCK or GL_SHADER_STORAGE_BLOCK): every variable of the block must be
+    // a member of the same offset and size, and the block no larger than the structure. For a storage block ending with an array without size, the
+    // structure mirrors an element of the array, whose stride must be its size. Differences are reported on std::cerr; returns false if
+    // there is any, or if the program has no such block.
+    bool checkBlockLayout(GLenum blockInterface, const GLchar* blockName, const BlockLayout& layout) const;
+
+private:
+    struct Uniform { // Element of an active uniform, with the last value set through the setters
+        GLint location;
+        GLenum type;
+        size_t activeUniform; // In activeUniformNames
+        size_t valueOffset; // In values
+        bool valueSet;
+        bool typeErrorReported;
+    };
+
+    struct Uniforms {
+        std::vector<Uniform> uniforms; // One per location, so per element for arrays
+        std::vector<std::pair<std::string, size_t>> names; // Names of the elements, as "a[i]" for arrays (and "a" for their first element), with their index in uniforms
+        std::vector<GLint> table; // Perfect hash table of the indices in names, -1 for empty slots
+        uint32_t hashSeed = 0; // Seed of the hash function giving a different slot to each name
+        std::vector<GLint> uniformByLocation; // Index in uniforms, -1 if no active uniform has the location
+        std::vector<std::string> activeUniformNames; // One per active uniform, "a" for arrays
+        std::vector<unsigned char> values;
+    };
+
+    // True if value, of type, differs from the last value set at location, which is then updated
+    bool updateUniformValue(GLint location, GLenum type, const void* value, size_t size);
+
+    void reportMissingUniform(const GLchar* name) const;
+
+    Uniforms m_uniforms;
+    mutable std::vector<std::string> m_reportedUniformNames; // Missing uniforms already reported
+    mutable std::vector<bool> m_lookedUpUniforms; // For each of activeUniformNames, true once its location has been looked up by name
 };
 
 inline GLProgram buildProgram(std::initializer_list<GLShader> shaders) {
@@ -118,19 +269,25 @@ GLProgram buildComputeProgram(CSrc&& src) {
     return buildProgram({ std::move(cs) });;
 }
 
-inline GLProgram compileProgram(std::vector<fs::path> shaderPaths)
+// Load, preprocess with defines (see preprocessShaderSource), compile and link the shaders of shaderPaths (see createShader for their naming convention).
+// Linked programs are cached next to their first shader, in files named after the shaders and the hash of their preprocessed sources (so of their
+// includes and defines too) and of the GL_VENDOR, GL_RENDERER and GL_VERSION strings of the driver (see glGetProgramBinary). While neither the
+// sources nor the driver change, later calls load the program binary instead of compiling the shaders; they are compiled again if the driver
+// rejects the binary. Writing the cache of a program removes its caches of other hashes, while the programs of other shaders or defines keep theirs.
+GLProgram compileProgram(std::vector<fs::path> shaderPaths, const ShaderDefines & defines = {});
+
+struct ProgramCompileStatistics
 {
-    GLProgram program;
-    for (const auto& path : shaderPaths) {
-        auto shader = loadShader(path);
-        program.attachShader(shader);
-    }
-    program.link();
-    if (!program.getLinkStatus()) {
-        std::cerr << "Program link error:" << program.getInfoLog() << std::endl;
-        throw std::runtime_error("Program link error:" + program.getInfoLog());
-    }
-    return program;
-}
+    bool cached = false; // Loaded from the program cache, without compiling
+    double seconds = 0; // From the first GL call for the program to its link status being known
+};
+
+// Same as compileProgram for several programs, one list of shaders each, with the defines of the same index in programDefines (none if
+// programDefines is shorter): every compile and link is issued before the status of any of them is queried, so that the driver can build them
+// concurrently, on its own threads when the context exposes KHR_parallel_shader_compile (or ARB_parallel_shader_compile).
+// The time spent on each program is logged, and stored in *pStatistics if it is not null. Throws std::runtime_error, once every program is done,
+// if any of them does not compile or link.
+std::vector<GLProgram> compilePrograms(const std::vector<std::vector<fs::path>> & programShaderPaths, const std::vector<ShaderDefines> & programDefines = {},
+    std::vector<ProgramCompileStatistics> * pStatistics = nullptr);
 
 }
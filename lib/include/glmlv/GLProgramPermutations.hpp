@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glmlv/GLProgram.hpp>
+#include <glmlv/shader_preprocessor.hpp>
+
+#include <map>
+#include <vector>
+
+namespace glmlv
+{
+
+// Programs built from the same shaders with different sets of defines (e.g. one per combination of material features), each compiled on
+// its first use with compileProgram, so from the program cache after the first run. Permutations are identified by their defines regardless of
+// their order.
+class GLProgramPermutations
+{
+public:
+    explicit GLProgramPermutations(std::vector<fs::path> shaderPaths = {}):
+        m_shaderPaths(std::move(shaderPaths))
+    {
+    }
+
+    // Program of the permutation, compiled if it is not yet. The reference stays valid as long as the object.
+    GLProgram & get(ShaderDefines defines);
+
+    // Compile the permutations not compiled yet in one batch (see compilePrograms), e.g. the permutations of every material of a scene once
+    // it is loaded, so that the driver can compile them concurrently rather than one by one on their first use
+    void prepare(std::vector<ShaderDefines> permutations);
+
+    // Number of compiled permutations
+    size_t size() const
+    {
+        return m_programs.size();
+    }
+
+private:
+    std::vector<fs::path> m_shaderPaths;
+    std::map<ShaderDefines, GLProgram> m_programs; // By sorted defines
+};
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glmlv/Image2DRGBA.hpp>
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace glmlv
+{
+
+// Asynchronous read back of pixels through a ring of GL_PIXEL_PACK_BUFFER objects persistently mapped with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT.
+// A read only issues the copy into a free buffer followed by a fence; update() delivers the reads whose fence is signaled, usually a few frames
+// later, so that the GL thread never waits for the GPU. Delivered images are views of the mapped buffers, without any copy: a buffer is reused
+// once the last image using it is released, which can happen on any thread (e.g. after an ImageWriter wrote it). Every image must be released
+// before the ring is destroyed.
+//
+// Images are RGBA8 with OpenGL row order, the first row being the bottom one (see ImageWriter::write to write them upside down).
+// Every method must be called from the GL thread.
+class GLReadbackRing
+{
+public:
+    using Callback = std::function<void (Image2DRGBA &&)>;
+
+    struct Statistics
+    {
+        size_t readCount = 0; // Delivered images
+        size_t droppedCount = 0; // Reads refused because no buffer was free, or large enough
+        double glThreadSeconds = 0; // Total time spent in reads and in update(), callbacks included: the cost of the read backs for the GL thread
+        double latencySeconds = 0; // Total time from the reads to the delivery of their images
+    };
+
+    // bufferCount buffers of bufferSize bytes each. Throws std::runtime_error if a buffer cannot be mapped.
+    GLReadbackRing(size_t bufferCount, size_t bufferSize);
+
+    ~GLReadbackRing();
+
+    GLReadbackRing(const GLReadbackRing&) = delete;
+    GLReadbackRing& operator =(const GLReadbackRing&) = delete;
+
+    // Read a rectangle of the read buffer of the bound GL_READ_FRAMEBUFFER, as glReadPixels. The image is passed to callback by a later update().
+    // Returns false, without reading, if no buffer is free or if the image does not fit in a buffer.
+    bool readPixels(GLint x, GLint y, GLsizei width, GLsizei height, Callback callback);
+
+    // Same for the first level of a 2D texture, as glGetTexImage (components are converted to 8 bits by OpenGL, clamped to [0, 1])
+    bool readTexture(GLuint texture, Callback callback);
+
+    // Deliver the reads that are complete, in order, without waiting; to be called regularly (e.g. every frame)
+    void update();
+
+    // Wait for every pending read and deliver them
+    void finish();
+
+    size_t pendingCount() const
+    {
+        return m_PendingBuffers.size();
+    }
+
+    const Statistics & statistics() const
+    {
+        return m_Statistics;
+    }
+
+private:
+    struct Buffer
+    {
+        GLuint glId = 0;
+        unsigned char * pData = nullptr;
+        GLsync fence = 0; // Not 0 while a read is pending
+        size_t width = 0;
+        size_t height = 0;
+        Callback callback;
+        std::chrono::steady_clock::time_point readTime;
+        std::atomic<bool> borrowed{ false }; // True while delivered images use the buffer, cleared on any thread by the release of the last one
+    };
+
+    // Free buffer large enough for width x height pixels, nullptr if none
+    Buffer * acquire(size_t width, size_t height);
+
+    void issue(Buffer & buffer, size_t width, size_t height, Callback callback, std::chrono::steady_clock::time_point startTime);
+
+    // Deliver the first pending read, if its fence is signaled within timeout nanoseconds
+    bool deliver(GLuint64 timeout);
+
+    std::unique_ptr<Buffer[]> m_Buffers;
+    size_t m_nBufferCount = 0;
+    size_t m_nBufferSize = 0;
+    std::deque<Buffer *> m_PendingBuffers; // In read order
+
+    Statistics m_Statistics;
+};
+
+}
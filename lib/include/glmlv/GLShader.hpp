@@ -2,6 +2,7 @@
 
 #include <glad/glad.h>
 #include <glmlv/filesystem.hpp>
+#include <glmlv/shader_preprocessor.hpp>
 #include <memory>
 #include <string>
 #include <stdexcept>
@@ -78,17 +79,24 @@ public:
 };
 
 inline std::string loadShaderSource(const fs::path& filepath) {
-    std::ifstream input(filepath.string());
+    std::ifstream input(filepath.string(), std::ios::binary);
     if(!input) {
         std::stringstream ss;
         ss << "Unable to open file " << filepath;
         throw std::runtime_error(ss.str());
     }
 
-    std::stringstream buffer;
-    buffer << input.rdbuf();
+    // Read directly in the string, a stringstream would copy the file twice
+    input.seekg(0, std::ios::end);
+    std::string source(size_t(input.tellg()), '\0');
+    input.seekg(0, std::ios::beg);
+    if (!input.read(&source[0], source.size())) {
+        std::stringstream ss;
+        ss << "Unable to read file " << filepath;
+        throw std::runtime_error(ss.str());
+    }
 
-    return buffer.str();
+    return source;
 }
 
 template<typename StringType>
@@ -102,18 +110,18 @@ GLShader compileShader(GLenum type, StringType&& src) {
     return shader;
 }
 
-// Load and compile a shader according to the following naming convention:
+// Create a shader object, not compiled yet, with the type given by the following naming convention of shaderPath:
 // *.vs.glsl -> vertex shader
 // *.fs.glsl -> fragment shader
 // *.gs.glsl -> geometry shader
 // *.cs.glsl -> compute shader
-inline GLShader loadShader(const fs::path& shaderPath)
+inline GLShader createShader(const fs::path& shaderPath)
 {
-    static auto extToShaderType = std::unordered_map<std::string, std::pair<GLenum, std::string>>({
-        { ".vs",{ GL_VERTEX_SHADER, "vertex" } },
-        { ".fs",{ GL_FRAGMENT_SHADER, "fragment" } },
-        { ".gs",{ GL_GEOMETRY_SHADER, "geometry" } },
-        { ".cs",{ GL_COMPUTE_SHADER, "compute" } }
+    static auto extToShaderType = std::unordered_map<std::string, GLenum>({
+        { ".vs", GL_VERTEX_SHADER },
+        { ".fs", GL_FRAGMENT_SHADER },
+        { ".gs", GL_GEOMETRY_SHADER },
+        { ".cs", GL_COMPUTE_SHADER }
     });
 
     const auto ext = shaderPath.stem().extension();
@@ -122,11 +130,16 @@ inline GLShader loadShader(const fs::path& shaderPath)
         std::cerr << "Unrecognized shader extension " << ext << std::endl;
         throw std::runtime_error("Unrecognized shader extension " + ext.string());
     }
+    return GLShader{ (*it).second };
+}
 
-    std::clog << "Compiling " << (*it).second.second << " shader " << shaderPath << "\n";
+// Compile a shader from its source, with the type given by the naming convention of shaderPath (see createShader)
+inline GLShader loadShader(const fs::path& shaderPath, const std::string& source)
+{
+    std::clog << "Compiling shader " << shaderPath << "\n";
 
-    GLShader shader{ (*it).second.first };
-    shader.setSource(loadShaderSource(shaderPath));
+    auto shader = createShader(shaderPath);
+    shader.setSource(source);
     shader.compile();
     if (!shader.getCompileStatus()) {
         std::cerr << "Shader compilation error:" << shader.getInfoLog() << std::endl;
@@ -135,4 +148,10 @@ inline GLShader loadShader(const fs::path& shaderPath)
     return shader;
 }
 
+// Load, preprocess (see preprocessShaderSource) and compile a shader, with the same naming convention
+inline GLShader loadShader(const fs::path& shaderPath, const ShaderDefines& defines = {})
+{
+    return loadShader(shaderPath, preprocessShaderSource(shaderPath, defines));
+}
+
 }
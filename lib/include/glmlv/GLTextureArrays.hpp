@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glmlv/texture_compression.hpp>
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstdint>
+
+namespace glmlv
+{
+
+// Block compressed textures packed as layers of GL_TEXTURE_2D_ARRAY objects, one array per format, size and mip level count.
+// All arrays are bound at once to consecutive texture units, so that drawing with another texture only changes uniforms:
+// the unit of the array (the value of a sampler2DArray uniform) and the layer in the array.
+class GLTextureArrays
+{
+public:
+    struct Layer
+    {
+        GLint array = -1; // Index of the array, bound to unit firstUnit + array by bind(firstUnit)
+        GLint layer = -1;
+    };
+
+    GLTextureArrays() = default;
+
+    ~GLTextureArrays();
+
+    GLTextureArrays(const GLTextureArrays&) = delete;
+    GLTextureArrays& operator =(const GLTextureArrays&) = delete;
+
+    GLTextureArrays(GLTextureArrays&& rvalue);
+    GLTextureArrays& operator =(GLTextureArrays&& rvalue);
+
+    // Upload the texture in a new layer of the array of its format and size.
+    // Arrays grow by doubling their layer count, existing layers are copied by the GPU, so that textures can be added at any time (e.g. while they are loaded).
+    // Throws std::runtime_error if the arrays would not fit in the texture units, or exceed the maximum array count.
+    Layer add(const CompressedImage2D & texture)
+    {
+        return add(texture, texture.data.data());
+    }
+
+    // Same, with the levels read from levels instead of texture.data (which can be empty): an offset in the bound GL_PIXEL_UNPACK_BUFFER, if any
+    Layer add(const CompressedImage2D & texture, const GLvoid * levels);
+
+    size_t arrayCount() const
+    {
+        return m_glIds.size();
+    }
+
+    // Limit the arrays to maxArrayCount, e.g. the size of an array of samplers selecting them in a shader, which can be smaller than the
+    // GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS limit applied otherwise. Throws std::runtime_error if more arrays have already been added.
+    void setMaxArrayCount(size_t maxArrayCount);
+
+    GLuint glId(size_t array) const
+    {
+        return m_glIds[array];
+    }
+
+    // Bind every array, and the sampler if it is not 0, to units firstUnit to firstUnit + arrayCount() - 1
+    void bind(GLuint firstUnit, GLuint sampler = 0) const;
+
+    // Unbind textures and samplers from the units used by bind(firstUnit)
+    void unbind(GLuint firstUnit) const;
+
+private:
+    struct Array
+    {
+        BlockFormat format;
+        size_t width;
+        size_t height;
+        size_t levelCount;
+        size_t layerCount;
+        size_t capacity;
+    };
+
+    void grow(size_t array);
+
+    void release();
+
+    std::vector<Array> m_arrays;
+    size_t m_maxArrayCount = 0; // 0 if only limited by the texture units
+    std::vector<GLuint> m_glIds; // Names of the arrays, contiguous for glBindTextures
+    mutable std::vector<GLuint> m_samplers; // Bound sampler repeated for each array, for glBindSamplers
+};
+
+}
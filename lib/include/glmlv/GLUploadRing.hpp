@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace glmlv
+{
+
+// Staging ring for uploads: a buffer persistently mapped with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT, so that any thread can write data
+// (e.g. decode an image) directly in memory the GPU copies from, while the GL thread only issues the copies, bound as GL_PIXEL_UNPACK_BUFFER
+// or GL_COPY_READ_BUFFER. Allocations are recycled in order, once the fence placed after their copies is signaled.
+//
+// allocate() can be called from any thread; every other method must be called from the GL thread.
+class GLUploadRing
+{
+public:
+    class Allocation
+    {
+    public:
+        unsigned char * data = nullptr; // Mapped memory to fill before passing the allocation to the GL thread
+        size_t offset = 0; // Offset of data in the buffer, to use as pointer argument of GL commands reading from it
+        size_t size = 0;
+
+        explicit operator bool() const
+        {
+            return data != nullptr;
+        }
+
+    private:
+        friend class GLUploadRing;
+
+        uint64_t m_nEnd = 0; // Position of the end of the allocation in the stream of allocated bytes
+    };
+
+    struct Statistics
+    {
+        uint64_t uploadedByteCount = 0; // Bytes of released allocations, i.e. copied, or being copied, by the GPU
+        size_t uploadCount = 0;
+        double uploadSeconds = 0; // From the first allocation to the last release, so that uploadedByteCount / uploadSeconds is the upload bandwidth
+        double stallSeconds = 0; // Total time threads spent in allocate() waiting for allocations to be recycled
+    };
+
+    // Throws std::runtime_error if the buffer cannot be mapped
+    explicit GLUploadRing(size_t capacity);
+
+    ~GLUploadRing();
+
+    GLUploadRing(const GLUploadRing&) = delete;
+    GLUploadRing& operator =(const GLUploadRing&) = delete;
+
+    GLuint glId() const
+    {
+        return m_GLId;
+    }
+
+    size_t capacity() const
+    {
+        return m_nCapacity;
+    }
+
+    // Reserve size bytes, aligned on 16 bytes, waiting for previous allocations to be recycled if the ring is full.
+    // Returns an empty allocation if size exceeds the capacity or if close() is called while waiting: the data must then be uploaded from client memory.
+    Allocation allocate(size_t size);
+
+    // To be called once the GL commands reading the allocation are issued: a fence is placed after them
+    void release(const Allocation & allocation);
+
+    // Recycle the allocations whose copies are complete, to be called regularly (e.g. every frame) so that allocate() does not wait
+    void update();
+
+    // Wake up and fail the threads waiting in allocate(), and any later allocation (e.g. before joining loading threads that could wait forever)
+    void close();
+
+    Statistics statistics() const;
+
+private:
+    struct Region
+    {
+        uint64_t end;
+        GLsync fence;
+    };
+
+    GLuint m_GLId = 0;
+    unsigned char * m_pData = nullptr;
+    size_t m_nCapacity = 0;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_RecycleCondition;
+    std::deque<Region> m_Regions; // Allocations not recycled yet, in order; fence is 0 until they are released
+    uint64_t m_nHead = 0; // Allocated bytes since the creation of the ring, including padding at the end of the buffer
+    uint64_t m_nTail = 0; // Recycled bytes
+    bool m_bClosed = false;
+
+    Statistics m_Statistics;
+    std::chrono::steady_clock::time_point m_FirstAllocationTime;
+};
+
+}
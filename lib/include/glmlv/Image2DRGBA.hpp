@@ -1,27 +1,58 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <glmlv/filesystem.hpp>
+#include <glmlv/parallel.hpp>
+#include <glmlv/half.hpp>
 
 namespace glmlv
 {
 
-class Image2DRGBA
+class MappedFile;
+
+template<typename T>
+class Image2D;
+
+using Image2DRGBA = Image2D<unsigned char>; // 8 bits per component, e.g. sRGB colors
+using Image2DRGBA16F = Image2D<Half>;
+using Image2DRGBA32F = Image2D<float>;
+
+// See below; declared before Image2D, which befriends it, since a default template argument cannot follow a friend declaration
+template<typename T = unsigned char>
+std::vector<Image2D<T>> mapRawImage(const fs::path& path);
+
+// Pixels are allocated by stb_image, unless they are borrowed from pOwner (e.g. a mapped file), which is then released with the last image using it
+struct Image2DDeleter
+{
+    std::shared_ptr<const void> pOwner;
+
+    void operator ()(void * ptr) const;
+};
+
+// RGBA image with components of type T (unsigned char, Half or float), stored row by row without padding
+template<typename T>
+class Image2D
 {
 public:
+    using ComponentType = T;
+
     static const size_t NumComponents = 4;
 
-    Image2DRGBA() = default;
+    Image2D() = default;
+
+    Image2D(size_t width, size_t height);
 
-    Image2DRGBA(size_t width, size_t height);
+    Image2D(size_t width, size_t height, T r, T g, T b, T a);
 
-    Image2DRGBA(size_t width, size_t height, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+    // View of pixels owned by pOwner (e.g. a mapped buffer), which is released with the last image using it
+    Image2D(size_t width, size_t height, T * pData, std::shared_ptr<const void> pOwner);
 
-    Image2DRGBA(const Image2DRGBA&) = delete;
-    Image2DRGBA& operator =(const Image2DRGBA&) = delete;
+    Image2D(const Image2D&) = delete;
+    Image2D& operator =(const Image2D&) = delete;
 
-    Image2DRGBA(Image2DRGBA&&) = default;
-    Image2DRGBA& operator =(Image2DRGBA&&) = default;
+    Image2D(Image2D&&) = default;
+    Image2D& operator =(Image2D&&) = default;
 
     size_t width() const
     {
@@ -38,56 +69,118 @@ public:
         return width() * height();
     }
 
-    const unsigned char * data() const
+    // Size of a row of pixels in bytes
+    size_t rowSize() const
+    {
+        return m_nWidth * NumComponents * sizeof(T);
+    }
+
+    const T * data() const
     {
         return m_pData.get();
     }
 
-    unsigned char * data()
+    T * data()
     {
         return m_pData.get();
     }
 
-    const unsigned char * operator ()(size_t x, size_t y) const
+    const T * operator ()(size_t x, size_t y) const
     {
         return m_pData.get() + (x + y * m_nWidth) * NumComponents;
     }
 
-    unsigned char * operator ()(size_t x, size_t y)
+    T * operator ()(size_t x, size_t y)
     {
-        return const_cast<unsigned char*>((*this)(x, y));
+        return const_cast<T*>(static_cast<const Image2D &>(*this)(x, y));
     }
 
-    void flipY(); // Flip the image along its y axis
+    void flipY(); // Flip the image along its y axis, swapping whole rows
 
 private:
-    friend Image2DRGBA readImage(const fs::path& path);
+    friend Image2DRGBA readImage(const fs::path& path, bool flipY);
+    friend Image2DRGBA readImage(const unsigned char * data, size_t size, bool flipY);
+    friend Image2DRGBA32F readImageHDR(const fs::path& path, bool flipY);
+    friend Image2DRGBA32F readImageHDR(const unsigned char * data, size_t size, bool flipY);
+    template<typename U>
+    friend std::vector<Image2D<U>> mapRawImage(const fs::path& path);
 
-    struct Deleter
-    {
-        void operator ()(unsigned char *) const;
-    };
+    // Levels of a raw image file mapped in memory, borrowing its pages
+    static std::vector<Image2D> viewRawImage(const std::shared_ptr<const MappedFile> & pFile, const fs::path& path);
 
-    std::unique_ptr<unsigned char[], Deleter> m_pData;
+    std::unique_ptr<T[], Image2DDeleter> m_pData;
     size_t m_nWidth = 0;
     size_t m_nHeight = 0;
 };
 
+template<typename T>
+const size_t Image2D<T>::NumComponents;
+
+extern template class Image2D<unsigned char>;
+extern template class Image2D<Half>;
+extern template class Image2D<float>;
+
 // Supported formats for reading are:
 ////    JPEG baseline & progressive(12 bpc / arithmetic not supported, same as stock IJG lib)
 ////    PNG 1 / 2 / 4 / 8 - bit - per - channel(16 bpc not supported)
-////    
+////
 ////    TGA(not sure what subset, if a subset)
 ////    BMP non - 1bpp, non - RLE
 ////    PSD(composited view only, no extra channels, 8 / 16 bit - per - channel)
-////    
+////
 ////    GIF(*comp always reports as 4 - channel)
 ////    HDR(radiance rgbE format)
 ////    PIC(Softimage PIC)
 ////    PNM(PPM and PGM binary only)
-Image2DRGBA readImage(const fs::path& path);
+//
+// Raw image files (see writeRawImage) are mapped in memory instead of decoded, the result is their first level.
+// If flipY is true, the image is flipped right after decoding, e.g. to match OpenGL texture coordinates
+Image2DRGBA readImage(const fs::path& path, bool flipY = false);
+
+// Decode an image file already loaded in memory, with the same supported formats
+Image2DRGBA readImage(const unsigned char * data, size_t size, bool flipY = false);
+
+// Decode an image with floating point components, without clamping: HDR files keep their values, other formats are converted to linear values
+// by stb_image (assuming a gamma of 2.2). Raw image files must have float components.
+Image2DRGBA32F readImageHDR(const fs::path& path, bool flipY = false);
+
+Image2DRGBA32F readImageHDR(const unsigned char * data, size_t size, bool flipY = false);
+
+// Component conversions, on threadCount threads; see floatToHalf for rounding
+Image2DRGBA16F convertToHalf(const Image2DRGBA32F & image, size_t threadCount = defaultThreadCount());
+
+Image2DRGBA32F convertToFloat(const Image2DRGBA16F & image, size_t threadCount = defaultThreadCount());
+
+// Number of levels of a full mipmap chain, down to 1x1
+size_t computeMipLevelCount(size_t width, size_t height);
 
-// Supported formats for writing are png, bmp and tga
+// Levels 1 to computeMipLevelCount(width, height) - 1 of the mipmap chain of image; each level is half the size of the previous one, rounded down.
+// Each pixel is the average of its footprint in the previous level. If sRGB is true, colors are averaged in linear space (alpha is always linear).
+// Each level is filtered from the floating point values of the previous one so that rounding errors do not accumulate; rows are filtered on threadCount threads.
+std::vector<Image2DRGBA> generateMipmaps(const Image2DRGBA & image, bool sRGB = true, size_t threadCount = defaultThreadCount());
+
+// Same filtering for floating point images, whose components are linear and never clamped
+std::vector<Image2DRGBA16F> generateMipmaps(const Image2DRGBA16F & image, size_t threadCount = defaultThreadCount());
+
+std::vector<Image2DRGBA32F> generateMipmaps(const Image2DRGBA32F & image, size_t threadCount = defaultThreadCount());
+
+// Supported formats for writing are png (encoded on all threads, see png_encoder.hpp), bmp and tga. Throws std::runtime_error on failure or for other formats.
 void writeImage(const Image2DRGBA& image, const fs::path& path);
 
-}
\ No newline at end of file
+// Supported format for writing floating point images is hdr (Radiance RGBE, alpha is dropped)
+void writeImage(const Image2DRGBA16F& image, const fs::path& path);
+
+void writeImage(const Image2DRGBA32F& image, const fs::path& path);
+
+// Write a raw image file: a header followed by the tightly packed pixels of the image and of its mipmaps, as returned by generateMipmaps (possibly none).
+// The type of the components is stored in the header, so that floating point images (e.g. G-buffers) are stored without loss.
+template<typename T>
+void writeRawImage(const Image2D<T>& image, const std::vector<Image2D<T>>& mipmaps, const fs::path& path);
+
+// Levels of a raw image file, without any copy: the file is mapped in memory (copy-on-write, so that pixels can still be modified)
+// and every level is a view of the mapping, which is released with the last of them. Throws std::runtime_error if the file is not a valid raw image
+// with components of type T.
+template<typename T>
+std::vector<Image2D<T>> mapRawImage(const fs::path& path);
+
+}
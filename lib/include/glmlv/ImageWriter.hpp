@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glmlv/filesystem.hpp>
+#include <glmlv/parallel.hpp>
+#include <glmlv/Image2DRGBA.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace glmlv
+{
+
+// Writes images on a pool of background threads, e.g. to dump frames or G-buffers without stalling the rendering loop.
+// PNG images are split in blocks of rows (see png_encoder.hpp) spread over the whole pool, so that a single image is also written faster;
+// bmp and tga images are written by one thread each. Images are taken by move, so that queuing them copies no pixel.
+//
+// Every method must be called from the same thread.
+class ImageWriter
+{
+public:
+    struct Statistics
+    {
+        size_t writtenImageCount = 0;
+        size_t failedImageCount = 0;
+        double writeSeconds = 0; // Total time from queuing to the end of writing, so that writeSeconds / writtenImageCount is the average latency
+        double stallSeconds = 0; // Total time spent in write() waiting for the queue to have room
+    };
+
+    // At most maxQueuedImageCount images are waiting or being written at the same time, so that memory stays bounded when images are produced
+    // faster than they are written
+    explicit ImageWriter(size_t maxQueuedImageCount = 4, size_t threadCount = defaultThreadCount());
+
+    // Wait for every queued image to be written (failures are only logged)
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator =(const ImageWriter&) = delete;
+
+    // Queue image to be written to path, with the formats supported by writeImage. Waits while maxQueuedImageCount images are queued.
+    // If flipY is true, the image is written upside down (e.g. when read back from OpenGL), without any work on the calling thread.
+    void write(Image2DRGBA image, fs::path path, bool flipY = false);
+
+    // Wait for every queued image to be written. Throws std::runtime_error if any image queued since the last flush could not be written;
+    // each failure is also logged on std::cerr when it happens.
+    void flush();
+
+    size_t queuedImageCount() const;
+
+    Statistics statistics() const;
+
+private:
+    struct Job;
+
+    struct Task
+    {
+        std::shared_ptr<Job> pJob;
+        size_t blockIndex; // PNG block to encode, ignored for other formats
+    };
+
+    void run();
+
+    void finish(Job & job, bool written);
+
+    const size_t m_nMaxQueuedImageCount;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_TaskCondition; // Signaled when tasks are queued or when the threads must stop
+    std::condition_variable m_FinishCondition; // Signaled when an image is written or fails
+    std::deque<Task> m_Tasks;
+    size_t m_nQueuedImageCount = 0;
+    size_t m_nFailureCount = 0; // Since the last flush
+    bool m_bStopped = false;
+    Statistics m_Statistics;
+
+    std::vector<std::thread> m_Threads;
+};
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace glmlv
+{
+
+// Unbounded lock-free queue with multiple producers and a single consumer (D. Vyukov's intrusive MPSC node-based queue).
+// push() can be called from any thread, tryPop() must always be called from the same thread.
+template<typename T>
+class MPSCQueue
+{
+public:
+    MPSCQueue():
+        m_pHead(new Node), m_pTail(m_pHead.load())
+    {
+    }
+
+    ~MPSCQueue()
+    {
+        while (m_pTail)
+        {
+            const auto pNext = m_pTail->pNext.load();
+            delete m_pTail;
+            m_pTail = pNext;
+        }
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator =(const MPSCQueue&) = delete;
+
+    void push(T value)
+    {
+        const auto pNode = new Node;
+        pNode->value = std::move(value);
+        const auto pPrevious = m_pHead.exchange(pNode, std::memory_order_acq_rel);
+        pPrevious->pNext.store(pNode, std::memory_order_release);
+    }
+
+    // Returns false if the queue is empty (or if a push has not been fully published yet)
+    bool tryPop(T & value)
+    {
+        const auto pNext = m_pTail->pNext.load(std::memory_order_acquire);
+        if (!pNext) {
+            return false;
+        }
+        value = std::move(pNext->value);
+        delete m_pTail;
+        m_pTail = pNext; // pNext becomes the new stub node
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> pNext{ nullptr };
+        T value;
+    };
+
+    std::atomic<Node*> m_pHead; // Last pushed node
+    Node* m_pTail; // Stub node, whose successor is the next value to pop
+};
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <glmlv/filesystem.hpp>
+
+namespace glmlv
+{
+
+// Read-only view of a whole file mapped in memory. The mapping is released when the object is destroyed.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    // Throws std::runtime_error if the file cannot be mapped.
+    // If copyOnWrite is true, the pages can be written through a const_cast of data(): changes are private to the mapping and never reach the file.
+    explicit MappedFile(const fs::path & path, bool copyOnWrite = false);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator =(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& rvalue);
+    MappedFile& operator =(MappedFile&& rvalue);
+
+    const unsigned char * data() const
+    {
+        return m_pData;
+    }
+
+    size_t size() const
+    {
+        return m_nSize;
+    }
+
+private:
+    void close();
+
+    const unsigned char * m_pData = nullptr;
+    size_t m_nSize = 0;
+#ifdef _WIN32
+    void * m_FileHandle = nullptr;
+    void * m_MappingHandle = nullptr;
+#endif
+};
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glmlv/load_obj.hpp>
+
+#include <glad/glad.h>
+#include <glm/vec4.hpp>
+
+#include <vector>
+
+namespace glmlv
+{
+
+// std430 layout of Material in shaders/glmlv/bindless_material.glsl, for the shader storage buffer of the bindless paths of the applications
+struct BindlessMaterial
+{
+    glm::vec4 Ka;
+    glm::vec4 Kd;
+    glm::vec4 KsShininess; // Ks in xyz, shininess in w
+    GLuint64 textures[4]; // Handles of Ka, Kd, Ks and shininess textures
+};
+
+// Materials followed by defaultMaterial, the texture ids of each material being indices in textureHandles (see GLBindlessTextures):
+// shaders index the result with the material id of a shape, or with materials.size() for shapes without material
+std::vector<BindlessMaterial> makeBindlessMaterials(const std::vector<ObjData::PhongMaterial> & materials, const ObjData::PhongMaterial & defaultMaterial,
+    const std::vector<GLuint64> & textureHandles);
+
+}
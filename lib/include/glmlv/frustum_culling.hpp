@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace glmlv
+{
+
+// Planes of a view frustum, with normals pointing inside: a point p is inside if dot(plane, vec4(p, 1)) >= 0 for all planes
+struct Frustum
+{
+    glm::vec4 planes[6]; // Left, right, bottom, top, near, far
+};
+
+// Planes of the frustum of viewProjMatrix, in the space transformed by viewProjMatrix (e.g. world space for projection * view)
+// (G. Gribb, K. Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix")
+Frustum extractFrustum(const glm::mat4 & viewProjMatrix);
+
+// Set visible[i] to 1 if the box [bboxMin[i], bboxMax[i]] intersects the frustum, 0 otherwise. The test is conservative:
+// boxes near the frustum corners can be reported visible. Inverted boxes are treated as their center point.
+// Four boxes are tested at once with SSE when available. Returns the number of visible boxes.
+size_t cullBoxes(const Frustum & frustum, const glm::vec3 * bboxMin, const glm::vec3 * bboxMax, size_t count, uint8_t * visible);
+
+inline size_t cullBoxes(const Frustum & frustum, const std::vector<glm::vec3> & bboxMin, const std::vector<glm::vec3> & bboxMax, std::vector<uint8_t> & visible)
+{
+    visible.resize(bboxMin.size());
+    return cullBoxes(frustum, bboxMin.data(), bboxMax.data(), bboxMin.size(), visible.data());
+}
+
+}
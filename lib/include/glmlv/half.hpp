@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace glmlv
+{
+
+// IEEE 754 half precision floating point number, as read by OpenGL from GL_HALF_FLOAT data
+struct Half
+{
+    uint16_t bits;
+};
+
+// Rounded to nearest even; values too large for half precision become infinities, NaNs stay NaNs
+Half floatToHalf(float value);
+
+float halfToFloat(Half value);
+
+// Convert count values, 4 at a time with SSE2 (or F16C when enabled at compile time), with the same results as the scalar conversions
+void floatToHalf(const float * src, Half * dst, size_t count);
+
+void halfToFloat(const Half * src, float * dst, size_t count);
+
+}
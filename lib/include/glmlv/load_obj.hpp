@@ -4,9 +4,13 @@
 #include <glmlv/Image2DRGBA.hpp>
 #include <glmlv/filesystem.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <functional>
 
 namespace glmlv
 {
+    struct CompressedImage2D;
+
     struct ObjData
     {
         struct PhongMaterial
@@ -16,7 +20,7 @@ namespace glmlv
             glm::vec3 Ks = glm::vec3(0); // Glossy multiplier
             float shininess = 0.f; // Glossy exponent
 
-            // Indices in the textures vector:
+            // Indices in texturePaths, and in textures when the images are loaded (-1 for no texture):
             int32_t KaTextureId = -1;
             int32_t KdTextureId = -1;
             int32_t KsTextureId = -1;
@@ -33,14 +37,48 @@ namespace glmlv
 
         std::vector<int32_t> materialIDPerShape;
 
+        // Bounding volumes of the vertices referenced by each shape (the box is inverted and the sphere null for shapes without indices)
+        std::vector<glm::vec3> bboxMinPerShape;
+        std::vector<glm::vec3> bboxMaxPerShape;
+        std::vector<glm::vec4> boundingSpherePerShape; // Center and radius
+
         std::vector<PhongMaterial> materials;
-        std::vector<Image2DRGBA> textures;
+        std::vector<Image2DRGBA> textures; // Decoded images, either empty (textures not loaded) or parallel to texturePaths
+        std::vector<fs::path> texturePaths; // Path of each texture, indexed by texture ids whether or not the images are loaded
     };
 
+    // If loadTextures is false, texture ids and texturePaths are still filled, but images are not decoded and textures is left empty: the ids then
+    // refer to texturePaths only, whose images can be read later (e.g. with readTextures or readCompressedTextures).
     void loadObj(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & data, bool loadTextures = true);
 
     inline void loadObj(const fs::path & objPath, ObjData & data, bool loadTextures = true)
     {
         return loadObj(objPath, objPath.parent_path(), data, loadTextures);
     }
+
+    // Same as loadObj, but the result is stored in a binary cache file next to the obj file (objPath + ".glmlvcache").
+    // The cache is keyed by the path, size and modification time of the obj file and of the material files it references; a full parse is done
+    // when it is missing or stale.
+    // Textures are not stored in the cache, they are read again from their original files.
+    // If optimizeMeshes is true, optimizeMesh (see mesh_optimizer.hpp) is applied before the cache is written, so that the optimized buffers are
+    // read back by the next runs; they are stored in their own cache file (objPath + ".optimized.glmlvcache").
+    void loadObjCached(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & data, bool loadTextures = true, bool optimizeMeshes = false);
+
+    inline void loadObjCached(const fs::path & objPath, ObjData & data, bool loadTextures = true, bool optimizeMeshes = false)
+    {
+        return loadObjCached(objPath, objPath.parent_path(), data, loadTextures, optimizeMeshes);
+    }
+
+    // Read images on all cores and flip them for OpenGL, as loadObj does for textures.
+    // onImage(index, image) is called from worker threads as soon as the image at paths[index] is ready; an exception thrown by onImage stops the reading.
+    // Flipped images are cached with their full mipmap chain (generateMipmaps, filtered as sRGB) in raw image files next to them
+    // (path + ".glmlvcache.raw", see writeRawImage), which are mapped in memory instead of decoded when they are more recent than their image.
+    void readTextures(const std::vector<fs::path> & paths, const std::function<void (size_t, Image2DRGBA &&)> & onImage);
+
+    // Same, with the whole mipmap chain of each image: onLevels(index, levels) gets the image followed by its mipmaps
+    void readTextureMipmaps(const std::vector<fs::path> & paths, const std::function<void (size_t, std::vector<Image2DRGBA> &&)> & onLevels);
+
+    // Same as readTextures, but images are block compressed (BC1, or BC3 for images with transparent pixels) with their full mipmap chain, filtered as sRGB,
+    // and cached in DDS files next to them (path + ".glmlvcache.dds"). A cache file is used when it is more recent than its image, it is rebuilt otherwise.
+    void readCompressedTextures(const std::vector<fs::path> & paths, const std::function<void (size_t, CompressedImage2D &&)> & onTexture);
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glmlv/simple_geometry.hpp>
+#include <glmlv/load_obj.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+namespace glmlv
+{
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStatistics
+{
+    size_t triangleCount = 0;
+    size_t vertexCount = 0; // Number of distinct vertices referenced
+    size_t transformedVertexCount = 0; // Number of cache misses
+    float acmr = 0.f; // Average cache miss ratio: transformed vertices per triangle (0.5 is ideal for big regular meshes, 3 is the worst)
+    float atvr = 0.f; // Average transformed vertex ratio: transformed vertices per referenced vertex (1 is ideal)
+};
+
+VertexCacheStatistics analyzeVertexCache(const uint32_t * indices, size_t indexCount, size_t cacheSize = 16);
+
+// Reorder triangles for post-transform vertex cache locality (T. Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void optimizeVertexCache(uint32_t * destination, const uint32_t * indices, size_t indexCount);
+
+// Reorder triangles of an index buffer already optimized for the vertex cache, to draw outer surfaces first.
+// The buffer is split into clusters at vertex cache breaks; clusters facing away from the mesh center are drawn first
+// (P. Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+// threshold is the tolerated ACMR degradation (1.05 allows 5% more cache misses in exchange for smaller clusters).
+void optimizeOverdraw(uint32_t * destination, const uint32_t * indices, size_t indexCount, const std::vector<Vertex3f3f2f> & vertices, float threshold = 1.05f);
+
+// Reorder the vertex buffer by first use in the index buffer, for vertex fetch locality; indices are remapped accordingly.
+// Vertices that are not referenced are moved to the end.
+void optimizeVertexFetch(std::vector<Vertex3f3f2f> & vertexBuffer, std::vector<uint32_t> & indexBuffer);
+
+struct MeshOptimizationStatistics
+{
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+};
+
+// Apply optimizeVertexCache and optimizeOverdraw to each shape range of indexCountPerShape (shapes are processed in parallel),
+// then optimizeVertexFetch to the whole vertex buffer. Statistics are accumulated over all shapes and logged.
+MeshOptimizationStatistics optimizeMesh(ObjData & data, float overdrawThreshold = 1.05f);
+
+// Simplify a triangle list down to targetIndexCount indices, or until the error would exceed targetError (an object space distance).
+// Edges are collapsed by increasing quadric error (M. Garland, P. Heckbert, "Surface Simplification Using Quadric Error Metrics").
+// A collapse moves a vertex onto one of its neighbours, so the result indexes the same vertex buffer.
+// Vertices on borders of the index topology are locked: this preserves open boundaries, as well as normal and texture seams
+// since welded vertices differ along them.
+// Returns the number of indices written to destination (at most indexCount); resultError receives the error of the simplified mesh.
+size_t simplifyMesh(uint32_t * destination, const uint32_t * indices, size_t indexCount, const std::vector<Vertex3f3f2f> & vertices,
+    size_t targetIndexCount, float targetError = std::numeric_limits<float>::max(), float * resultError = nullptr);
+
+// Levels of detail of the shapes of an ObjData, sharing its vertex buffer
+struct MeshLods
+{
+    size_t levelCount = 0;
+    size_t shapeCount = 0;
+    std::vector<uint32_t> indexBuffer; // Indices of all levels, level 0 being ObjData::indexBuffer itself
+    // Indexed by level * shapeCount + shape:
+    std::vector<uint32_t> indexOffsets; // Offset of the first index in indexBuffer
+    std::vector<uint32_t> indexCounts;
+    std::vector<float> errors; // Object space error compared to level 0
+};
+
+// Each level has about reductionPerLevel times the triangles of the previous one; shapes are processed in parallel.
+MeshLods generateLods(const ObjData & data, size_t levelCount = 5, float reductionPerLevel = 0.5f);
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace glmlv
+{
+
+inline size_t defaultThreadCount()
+{
+    const auto count = std::thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+// Call f(i) for each i in [0, count), spreading the calls over threadCount threads (the calling thread included).
+// Indices are dispatched one by one so that tasks of uneven cost are balanced. The first exception thrown by f is rethrown.
+template<typename Function>
+void parallelFor(size_t count, Function && f, size_t threadCount = defaultThreadCount())
+{
+    threadCount = std::min(threadCount, count);
+    if (threadCount <= 1)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            f(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> nextIndex{ 0 };
+    std::exception_ptr exception;
+    std::mutex exceptionMutex;
+
+    const auto worker = [&]()
+    {
+        try {
+            for (auto i = nextIndex++; i < count; i = nextIndex++) {
+                f(i);
+            }
+        }
+        catch (...) {
+            nextIndex = count; // Stop other workers as soon as possible
+            std::lock_guard<std::mutex> lock(exceptionMutex);
+            if (!exception) {
+                exception = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto & thread : threads) {
+        thread.join();
+    }
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+}
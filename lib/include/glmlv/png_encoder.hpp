@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glmlv/filesystem.hpp>
+#include <glmlv/parallel.hpp>
+#include <glmlv/Image2DRGBA.hpp>
+
+namespace glmlv
+{
+
+// PNG encoding in independent blocks of rows, so that blocks can be encoded in parallel: each block filters its rows (choosing the filter of each row
+// like stb_image_write) and deflates them on its own, without references to the previous blocks. Every block but the last ends with an empty
+// stored block to align the deflate stream on a byte, so that the blocks are simply concatenated, each one in its own IDAT chunk.
+struct PNGBlock
+{
+    std::vector<unsigned char> data; // Deflated rows, preceded by the zlib header for the first block
+    uint32_t crc = 0; // CRC of the IDAT chunk type and of data
+    uint32_t adler32 = 1; // Adler-32 checksum of the filtered rows
+    size_t filteredSize = 0; // Size of the filtered rows, i.e. before compression
+};
+
+// Number of blocks of an image, of about 128 kB of pixels each. Throws std::runtime_error if the image is empty, as encodePNGBlock and writePNG do.
+size_t computePNGBlockCount(const Image2DRGBA & image);
+
+// If flipY is true, rows are encoded from the last one, e.g. for images read back from OpenGL
+PNGBlock encodePNGBlock(const Image2DRGBA & image, size_t blockIndex, bool flipY = false);
+
+// Write the PNG file of image from all its encoded blocks. Throws std::runtime_error if the file cannot be written.
+void writePNG(const Image2DRGBA & image, const std::vector<PNGBlock> & blocks, const fs::path & path);
+
+// Encode the blocks of image on threadCount threads, then write the PNG file
+void writePNG(const Image2DRGBA & image, const fs::path & path, size_t threadCount = defaultThreadCount());
+
+}
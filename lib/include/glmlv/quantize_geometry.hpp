@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glmlv/simple_geometry.hpp>
+#include <glmlv/load_obj.hpp>
+
+#include <vector>
+
+namespace glmlv
+{
+
+// Octahedral mapping of a unit vector to [-1, 1]^2 (Z. Cigolle et al., "A Survey of Efficient Representations for Independent Unit Vectors")
+glm::vec2 octahedralEncode(const glm::vec3 & n);
+glm::vec3 octahedralDecode(const glm::vec2 & e);
+
+struct QuantizedGeometry
+{
+    std::vector<Vertex4us2s2h> vertexBuffer;
+    // Transform from normalized positions to object space, to fold into the model matrix.
+    // It only translates and scales each axis, so normals are unaffected and must be transformed with the normal matrix of the model matrix alone.
+    glm::mat4 dequantizationMatrix;
+};
+
+// Positions are quantized relative to [bboxMin, bboxMax], which must contain all vertices
+QuantizedGeometry quantizeGeometry(const std::vector<Vertex3f3f2f> & vertexBuffer, const glm::vec3 & bboxMin, const glm::vec3 & bboxMax);
+
+inline QuantizedGeometry quantizeGeometry(const ObjData & data)
+{
+    return quantizeGeometry(data.vertexBuffer, data.bboxMin, data.bboxMax);
+}
+
+}
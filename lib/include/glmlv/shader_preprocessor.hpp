@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glmlv/filesystem.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace glmlv
+{
+
+// Names and values of the macros defined for a permutation of a shader (an empty value defines the macro without value)
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Load the source of a shader, replacing every #include "file" directive (the path being relative to the including file) by the preprocessed
+// content of the file, and inserting a #define directive for each of defines after the #version directive. A file is included at most once per
+// shader, so that include guards are not needed; #version directives of included files are ignored. Directives are recognized at the beginning
+// of lines only (block comments and conditionals are not interpreted, so files are also included in groups the compiler skips).
+// #line directives keep the line numbers of compiler errors right, including after conditional groups that contain an included file; their source
+// string numbers are indices in *pFiles, filled if it is not null.
+// Throws std::runtime_error if a file cannot be read.
+std::string preprocessShaderSource(const fs::path & path, const ShaderDefines & defines = {}, std::vector<fs::path> * pFiles = nullptr);
+
+// The defines as they would be written on a command line, e.g. "ALPHA_TEST KD_TEXTURE=1", to identify a permutation in logs
+std::string toString(const ShaderDefines & defines);
+
+}
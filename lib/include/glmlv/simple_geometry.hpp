@@ -5,6 +5,7 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 namespace glmlv
 {
@@ -23,6 +24,17 @@ struct Vertex3f3f2f
     }
 };
 
+// Compact 16 bytes vertex, see quantize_geometry.hpp:
+// - position: unorm16 coordinates relative to a bounding box (w is always 1), to transform with the dequantization matrix
+// - normal: octahedral encoding, snorm16
+// - texCoords: half floats
+struct Vertex4us2s2h
+{
+    glm::u16vec4 position;
+    glm::i16vec2 normal;
+    glm::u16vec2 texCoords;
+};
+
 struct SimpleGeometry
 {
     std::vector<Vertex3f3f2f> vertexBuffer;
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <glmlv/Image2DRGBA.hpp>
+#include <glmlv/filesystem.hpp>
+#include <glmlv/parallel.hpp>
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// S3TC formats are not part of the core profile loaded by glad, but are supported by every desktop GPU
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace glmlv
+{
+
+// Block compressed formats: pixels are encoded by blocks of 4x4
+enum class BlockFormat : uint32_t
+{
+    BC1, // RGB, 8 bytes per block (DXT1)
+    BC3, // RGBA, 16 bytes per block: BC1 colors followed by BC4 alpha (DXT5)
+    BC5 // RG, 16 bytes per block: two BC4 channels, e.g. for tangent space normal maps (ATI2)
+};
+
+inline size_t blockSize(BlockFormat format)
+{
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+// Internal format to allocate a texture receiving blocks of this format with glCompressedTexSubImage2D
+inline GLenum getGLInternalFormat(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default:
+        return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+struct CompressedImage2D
+{
+    BlockFormat format = BlockFormat::BC1;
+    size_t width = 0;
+    size_t height = 0;
+    size_t levelCount = 1; // Mip levels, stored one after the other in data from the largest
+    std::vector<unsigned char> data; // Rows of blocks of each level, in the order of the rows of the source image; partial blocks at the borders repeat the last pixels
+
+    size_t levelWidth(size_t level) const
+    {
+        return std::max(size_t(1), width >> level);
+    }
+
+    size_t levelHeight(size_t level) const
+    {
+        return std::max(size_t(1), height >> level);
+    }
+
+    size_t blockCountX(size_t level = 0) const
+    {
+        return (levelWidth(level) + 3) / 4;
+    }
+
+    size_t blockCountY(size_t level = 0) const
+    {
+        return (levelHeight(level) + 3) / 4;
+    }
+
+    size_t levelSize(size_t level) const
+    {
+        return blockCountX(level) * blockCountY(level) * blockSize(format);
+    }
+
+    // Offset of the level in data; levelOffset(levelCount) is the size of all levels
+    size_t levelOffset(size_t level) const
+    {
+        size_t offset = 0;
+        for (size_t i = 0; i < level; ++i) {
+            offset += levelSize(i);
+        }
+        return offset;
+    }
+
+    const unsigned char * levelData(size_t level) const
+    {
+        return data.data() + levelOffset(level);
+    }
+};
+
+// BC1 for opaque images, BC3 for images with transparent pixels
+BlockFormat chooseBlockFormat(const Image2DRGBA & image);
+
+// Rows of blocks are encoded on threadCount threads.
+// BC1 fits the endpoints of each block along the principal axis of its colors, then refines them by least squares; BC4 channels use their range.
+CompressedImage2D compressImage(const Image2DRGBA & image, BlockFormat format, size_t threadCount = defaultThreadCount());
+
+// Compress the image and its full mipmap chain, generated by generateMipmaps(image, sRGB, threadCount)
+CompressedImage2D compressImageWithMipmaps(const Image2DRGBA & image, BlockFormat format, bool sRGB = true, size_t threadCount = defaultThreadCount());
+
+// Decode a level of the image; BC1 blocks decode with alpha = 255, BC5 blocks with blue = 0 and alpha = 255
+Image2DRGBA decompressImage(const CompressedImage2D & image, size_t level = 0);
+
+// Peak signal to noise ratio, in dB, over the first channelCount channels of the pixels (infinite for identical images)
+double computePSNR(const Image2DRGBA & reference, const Image2DRGBA & image, size_t channelCount = Image2DRGBA::NumComponents);
+
+// DDS files with DXT1, DXT5 or ATI2 four character codes, and their mip levels. Blocks are written in the order of CompressedImage2D::data, so an image
+// flipped for OpenGL before compression stays upside down in the file.
+void writeDDS(const CompressedImage2D & image, const fs::path & path);
+
+// Throws std::runtime_error if the file is not a DDS file of a supported format
+CompressedImage2D readDDS(const fs::path & path);
+
+}
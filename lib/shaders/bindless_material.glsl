@@ -0,0 +1,15 @@
+// Materials of the bindless paths of the applications (std430 layout of glmlv::BindlessMaterial, see bindless_material.hpp), included by their shaders with
+// #include "../glmlv/bindless_material.glsl" once GL_ARB_bindless_texture is enabled; each shader selects its material
+
+struct Material
+{
+    vec4 Ka;
+    vec4 Kd;
+    vec4 KsShininess; // Ks in xyz, shininess in w
+    uvec2 textures[4]; // Bindless handles of Ka, Kd, Ks and shininess textures
+};
+
+layout(std430, binding = 0) readonly buffer Materials
+{
+    Material uMaterials[];
+};
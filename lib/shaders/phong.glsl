@@ -0,0 +1,9 @@
+// Blinn-Phong lighting of the applications for a directional light, included by their shaders with #include "../glmlv/phong.glsl".
+// Positions and directions are in view space, lightDir pointing toward the light.
+vec3 directionalLightPhong(vec3 lightDir, vec3 lightIntensity, vec3 position, vec3 normal, vec3 diffuse, vec3 glossy, float shininess)
+{
+    vec3 halfVector = 0.5 * (lightDir + position);
+    return lightIntensity * (
+           diffuse * max(0.0, dot(normal, lightDir))
+           + glossy * pow(max(0, dot(halfVector, normal)), shininess));
+}
@@ -0,0 +1,438 @@
+#include <glmlv/BVH.hpp>
+#include <glmlv/parallel.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace glmlv
+{
+
+namespace
+{
+
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    void grow(const glm::vec3 & p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void grow(const Bounds & b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    float halfArea() const
+    {
+        const auto d = glm::max(max - min, glm::vec3(0));
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+class BVHBuilder
+{
+public:
+    // Beyond this depth, nodes are split at the median so that the depth stays under the traversal stack size
+    static const size_t MaxSAHDepth = 24;
+    static const size_t BinCount = 16;
+
+    BVHBuilder(const std::vector<glm::vec3> & bboxMin, const std::vector<glm::vec3> & bboxMax, std::vector<uint32_t> & indices, size_t maxLeafSize):
+        m_BBoxMin(bboxMin), m_BBoxMax(bboxMax), m_Centroids(bboxMin.size()), m_Indices(indices),
+        m_nMaxLeafSize(std::max(size_t(1), std::min(maxLeafSize, size_t(std::numeric_limits<uint16_t>::max()))))
+    {
+        parallelFor((bboxMin.size() + BlockSize - 1) / BlockSize, [&](size_t block)
+        {
+            const auto end = std::min(bboxMin.size(), (block + 1) * BlockSize);
+            for (auto i = block * BlockSize; i < end; ++i) {
+                m_Centroids[i] = 0.5f * (bboxMin[i] + bboxMax[i]);
+            }
+        });
+    }
+
+    Bounds bounds(size_t first, size_t count) const
+    {
+        Bounds b;
+        for (auto i = first; i < first + count; ++i)
+        {
+            b.min = glm::min(b.min, m_BBoxMin[m_Indices[i]]);
+            b.max = glm::max(b.max, m_BBoxMax[m_Indices[i]]);
+        }
+        return b;
+    }
+
+    // Partition m_Indices[first, first + count) and return the size of the first part, or 0 to make a leaf
+    size_t split(size_t first, size_t count, const Bounds & nodeBounds, size_t depth, uint16_t & splitAxis)
+    {
+        if (count <= 1) {
+            return 0;
+        }
+
+        Bounds centroidBounds;
+        for (auto i = first; i < first + count; ++i) {
+            centroidBounds.grow(m_Centroids[m_Indices[i]]);
+        }
+
+        // Binned SAH, with unit costs for traversal and intersection
+        auto bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        size_t bestBin = 0;
+        if (depth < MaxSAHDepth)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const auto extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+                if (extent <= 0.f) {
+                    continue;
+                }
+                const auto scale = BinCount / extent;
+
+                Bounds binBounds[BinCount];
+                size_t binCounts[BinCount] = {};
+                for (auto i = first; i < first + count; ++i)
+                {
+                    const auto primitive = m_Indices[i];
+                    const auto bin = std::min(BinCount - 1, size_t((m_Centroids[primitive][axis] - centroidBounds.min[axis]) * scale));
+                    binBounds[bin].grow(Bounds{ m_BBoxMin[primitive], m_BBoxMax[primitive] });
+                    ++binCounts[bin];
+                }
+
+                // Cost of the right part of each split, then sweep from the left
+                float rightCosts[BinCount];
+                Bounds rightBounds;
+                size_t rightCount = 0;
+                for (auto bin = BinCount - 1; bin > 0; --bin)
+                {
+                    rightBounds.grow(binBounds[bin]);
+                    rightCount += binCounts[bin];
+                    rightCosts[bin] = rightCount ? rightBounds.halfArea() * rightCount : 0.f;
+                }
+                Bounds leftBounds;
+                size_t leftCount = 0;
+                for (size_t bin = 0; bin + 1 < BinCount; ++bin)
+                {
+                    leftBounds.grow(binBounds[bin]);
+                    leftCount += binCounts[bin];
+                    if (!leftCount || leftCount == count) {
+                        continue;
+                    }
+                    const auto cost = leftBounds.halfArea() * leftCount + rightCosts[bin + 1];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = bin;
+                    }
+                }
+            }
+        }
+
+        const auto nodeArea = nodeBounds.halfArea();
+        if (bestAxis >= 0)
+        {
+            if (count <= m_nMaxLeafSize && nodeArea * count <= nodeArea + bestCost) {
+                return 0;
+            }
+
+            const auto axis = bestAxis;
+            const auto scale = BinCount / (centroidBounds.max[axis] - centroidBounds.min[axis]);
+            const auto middle = std::partition(m_Indices.begin() + first, m_Indices.begin() + first + count, [&](uint32_t primitive)
+            {
+                return std::min(BinCount - 1, size_t((m_Centroids[primitive][axis] - centroidBounds.min[axis]) * scale)) <= bestBin;
+            });
+            splitAxis = uint16_t(axis);
+            return size_t(middle - (m_Indices.begin() + first));
+        }
+
+        // Identical centroids, or too deep: split at the median of the largest axis if the leaf would be too big
+        if (count <= m_nMaxLeafSize) {
+            return 0;
+        }
+        const auto extent = centroidBounds.max - centroidBounds.min;
+        const auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        const auto middle = m_Indices.begin() + first + count / 2;
+        std::nth_element(m_Indices.begin() + first, middle, m_Indices.begin() + first + count, [&](uint32_t lhs, uint32_t rhs)
+        {
+            return m_Centroids[lhs][axis] < m_Centroids[rhs][axis];
+        });
+        splitAxis = uint16_t(axis);
+        return count / 2;
+    }
+
+    // Build the subtree of m_Indices[first, first + count) in depth-first order, with offsets relative to the beginning of nodes
+    void buildSubtree(size_t first, size_t count, size_t depth, std::vector<BVH::Node> & nodes)
+    {
+        const auto nodeIndex = nodes.size();
+        nodes.emplace_back();
+
+        const auto nodeBounds = bounds(first, count);
+        uint16_t splitAxis = 0;
+        const auto leftCount = split(first, count, nodeBounds, depth, splitAxis);
+
+        auto & node = nodes[nodeIndex];
+        node.bboxMin = nodeBounds.min;
+        node.bboxMax = nodeBounds.max;
+        node.splitAxis = splitAxis;
+        if (!leftCount)
+        {
+            node.offset = uint32_t(first);
+            node.primitiveCount = uint16_t(count);
+            return;
+        }
+        node.primitiveCount = 0;
+
+        buildSubtree(first, leftCount, depth + 1, nodes);
+        nodes[nodeIndex].offset = uint32_t(nodes.size());
+        buildSubtree(first + leftCount, count - leftCount, depth + 1, nodes);
+    }
+
+private:
+    static const size_t BlockSize = 16384;
+
+    const std::vector<glm::vec3> & m_BBoxMin;
+    const std::vector<glm::vec3> & m_BBoxMax;
+    std::vector<glm::vec3> m_Centroids;
+    std::vector<uint32_t> & m_Indices;
+    size_t m_nMaxLeafSize;
+};
+
+}
+
+BVH::BVH(const std::vector<glm::vec3> & bboxMin, const std::vector<glm::vec3> & bboxMax, size_t maxLeafSize):
+    m_PrimitiveIndices(bboxMin.size())
+{
+    if (bboxMin.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < m_PrimitiveIndices.size(); ++i) {
+        m_PrimitiveIndices[i] = uint32_t(i);
+    }
+
+    BVHBuilder builder(bboxMin, bboxMax, m_PrimitiveIndices, maxLeafSize);
+
+    // Top levels are split on the calling thread until ranges are small enough to balance subtrees over threads
+    struct TopNode
+    {
+        Node node;
+        size_t first, count, depth;
+        int32_t left = -1, right = -1;
+        int32_t subtree = -1; // Index in subtrees, for nodes whose subtree is built in parallel
+    };
+    std::vector<TopNode> topNodes;
+    std::vector<size_t> subtreeTopNodes;
+    const auto subtreeSize = std::max(size_t(4096), bboxMin.size() / (8 * defaultThreadCount()));
+
+    std::vector<size_t> pending = { 0 };
+    topNodes.emplace_back();
+    topNodes[0].first = 0;
+    topNodes[0].count = bboxMin.size();
+    topNodes[0].depth = 0;
+    while (!pending.empty())
+    {
+        const auto topIndex = pending.back();
+        pending.pop_back();
+        const auto first = topNodes[topIndex].first, count = topNodes[topIndex].count, depth = topNodes[topIndex].depth;
+
+        size_t leftCount = 0;
+        uint16_t splitAxis = 0;
+        Bounds nodeBounds;
+        if (count > subtreeSize)
+        {
+            nodeBounds = builder.bounds(first, count);
+            leftCount = builder.split(first, count, nodeBounds, depth, splitAxis);
+        }
+        if (!leftCount)
+        {
+            topNodes[topIndex].subtree = int32_t(subtreeTopNodes.size());
+            subtreeTopNodes.emplace_back(topIndex);
+            continue;
+        }
+
+        auto & node = topNodes[topIndex].node;
+        node.bboxMin = nodeBounds.min;
+        node.bboxMax = nodeBounds.max;
+        node.primitiveCount = 0;
+        node.splitAxis = splitAxis;
+
+        const size_t childFirsts[2] = { first, first + leftCount };
+        const size_t childCounts[2] = { leftCount, count - leftCount };
+        for (size_t child = 0; child < 2; ++child)
+        {
+            TopNode childNode;
+            childNode.first = childFirsts[child];
+            childNode.count = childCounts[child];
+            childNode.depth = depth + 1;
+            (child ? topNodes[topIndex].right : topNodes[topIndex].left) = int32_t(topNodes.size());
+            pending.emplace_back(topNodes.size());
+            topNodes.emplace_back(childNode);
+        }
+    }
+
+    std::vector<std::vector<Node>> subtrees(subtreeTopNodes.size());
+    parallelFor(subtrees.size(), [&](size_t subtree)
+    {
+        const auto & topNode = topNodes[subtreeTopNodes[subtree]];
+        builder.buildSubtree(topNode.first, topNode.count, topNode.depth, subtrees[subtree]);
+    });
+
+    // Flatten the top levels and the subtrees in depth-first order
+    const auto emit = [&](int32_t topIndex, const auto & emitRef) -> void
+    {
+        const auto & topNode = topNodes[topIndex];
+        if (topNode.subtree >= 0)
+        {
+            const auto base = uint32_t(m_Nodes.size());
+            for (auto node : subtrees[topNode.subtree])
+            {
+                if (!node.isLeaf()) {
+                    node.offset += base;
+                }
+                m_Nodes.emplace_back(node);
+            }
+            return;
+        }
+        const auto nodeIndex = m_Nodes.size();
+        m_Nodes.emplace_back(topNode.node);
+        emitRef(topNode.left, emitRef);
+        m_Nodes[nodeIndex].offset = uint32_t(m_Nodes.size());
+        emitRef(topNode.right, emitRef);
+    };
+    emit(0, emit);
+}
+
+SceneBVH::SceneBVH(const ObjData & data)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    const auto triangleCount = data.indexBuffer.size() / 3;
+    std::vector<uint32_t> shapePerTriangle(triangleCount);
+    {
+        size_t triangle = 0;
+        for (size_t shape = 0; shape < data.indexCountPerShape.size(); ++shape) {
+            for (size_t i = 0; i < data.indexCountPerShape[shape] / 3; ++i) {
+                shapePerTriangle[triangle++] = uint32_t(shape);
+            }
+        }
+    }
+
+    static const size_t BlockSize = 16384;
+    const auto blockCount = (triangleCount + BlockSize - 1) / BlockSize;
+    std::vector<glm::vec3> bboxMin(triangleCount), bboxMax(triangleCount);
+    parallelFor(blockCount, [&](size_t block)
+    {
+        const auto end = std::min(triangleCount, (block + 1) * BlockSize);
+        for (auto t = block * BlockSize; t < end; ++t)
+        {
+            const auto & p0 = data.vertexBuffer[data.indexBuffer[3 * t]].position;
+            const auto & p1 = data.vertexBuffer[data.indexBuffer[3 * t + 1]].position;
+            const auto & p2 = data.vertexBuffer[data.indexBuffer[3 * t + 2]].position;
+            bboxMin[t] = glm::min(p0, glm::min(p1, p2));
+            bboxMax[t] = glm::max(p0, glm::max(p1, p2));
+        }
+    });
+
+    m_TriangleBVH = BVH(bboxMin, bboxMax);
+    m_ShapeBVH = BVH(data.bboxMinPerShape, data.bboxMaxPerShape, 1);
+
+    m_Triangles.resize(triangleCount);
+    const auto & triangleOrder = m_TriangleBVH.primitiveIndices();
+    parallelFor(blockCount, [&](size_t block)
+    {
+        const auto end = std::min(triangleCount, (block + 1) * BlockSize);
+        for (auto i = block * BlockSize; i < end; ++i)
+        {
+            const auto t = triangleOrder[i];
+            const auto & p0 = data.vertexBuffer[data.indexBuffer[3 * t]].position;
+            const auto & p1 = data.vertexBuffer[data.indexBuffer[3 * t + 1]].position;
+            const auto & p2 = data.vertexBuffer[data.indexBuffer[3 * t + 2]].position;
+            m_Triangles[i] = Triangle{ p0, p1 - p0, p2 - p0, shapePerTriangle[t], t };
+        }
+    });
+
+    std::clog << "Built BVH over " << triangleCount << " triangles (" << m_TriangleBVH.nodes().size() << " nodes) and " << data.bboxMinPerShape.size()
+        << " shapes in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << " ms" << std::endl;
+}
+
+template<bool AnyHit>
+bool SceneBVH::intersectTriangles(const Ray & ray, uint32_t first, uint32_t count, float & tMax, RayHit * pHit) const
+{
+    auto hit = false;
+    for (auto i = first; i < first + count; ++i)
+    {
+        const auto & triangle = m_Triangles[i];
+        const auto p = glm::cross(ray.direction, triangle.edge2);
+        const auto determinant = glm::dot(triangle.edge1, p);
+        if (determinant == 0.f) {
+            continue;
+        }
+        const auto invDeterminant = 1.f / determinant;
+        const auto s = ray.origin - triangle.v0;
+        const auto u = glm::dot(s, p) * invDeterminant;
+        if (u < 0.f || u > 1.f) {
+            continue;
+        }
+        const auto q = glm::cross(s, triangle.edge1);
+        const auto v = glm::dot(ray.direction, q) * invDeterminant;
+        if (v < 0.f || u + v > 1.f) {
+            continue;
+        }
+        const auto t = glm::dot(triangle.edge2, q) * invDeterminant;
+        if (t < 0.f || t > tMax) {
+            continue;
+        }
+
+        tMax = t;
+        hit = true;
+        if (AnyHit) {
+            return true;
+        }
+        pHit->t = t;
+        pHit->shape = triangle.shape;
+        pHit->triangle = triangle.index;
+        pHit->barycentrics = glm::vec2(u, v);
+    }
+    return hit;
+}
+
+bool SceneBVH::intersect(const Ray & ray, RayHit & hit, float tMax) const
+{
+    auto found = false;
+    m_TriangleBVH.traverse(ray, tMax, [&](uint32_t first, uint32_t count, float & leafTMax)
+    {
+        found |= intersectTriangles<false>(ray, first, count, leafTMax, &hit);
+        return false;
+    });
+    return found;
+}
+
+bool SceneBVH::occluded(const Ray & ray, float tMax) const
+{
+    auto found = false;
+    m_TriangleBVH.traverse(ray, tMax, [&](uint32_t first, uint32_t count, float & leafTMax)
+    {
+        found = intersectTriangles<true>(ray, first, count, leafTMax, nullptr);
+        return found;
+    });
+    return found;
+}
+
+size_t SceneBVH::cullShapes(const Frustum & frustum, std::vector<uint8_t> & visible) const
+{
+    visible.assign(m_ShapeBVH.primitiveIndices().size(), 0);
+    size_t visibleCount = 0;
+    m_ShapeBVH.traverse(frustum, [&](uint32_t first, uint32_t count)
+    {
+        for (auto i = first; i < first + count; ++i) {
+            visible[m_ShapeBVH.primitiveIndices()[i]] = 1;
+        }
+        visibleCount += count;
+    });
+    return visibleCount;
+}
+
+}
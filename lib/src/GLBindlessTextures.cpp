@@ -0,0 +1,86 @@
+#include <glmlv/GLBindlessTextures.hpp>
+#include <glmlv/glfw.hpp>
+
+#include <utility>
+
+namespace glmlv
+{
+
+namespace
+{
+
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTURESAMPLERHANDLEARBPROC)(GLuint texture, GLuint sampler);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+PFNGLGETTEXTURESAMPLERHANDLEARBPROC glGetTextureSamplerHandleARB = nullptr;
+PFNGLMAKETEXTUREHANDLERESIDENTARBPROC glMakeTextureHandleResidentARB = nullptr;
+PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC glMakeTextureHandleNonResidentARB = nullptr;
+
+}
+
+bool GLBindlessTextures::isSupported()
+{
+    if (!glfwExtensionSupported("GL_ARB_bindless_texture")) {
+        return false;
+    }
+    glGetTextureSamplerHandleARB = (PFNGLGETTEXTURESAMPLERHANDLEARBPROC) glfwGetProcAddress("glGetTextureSamplerHandleARB");
+    glMakeTextureHandleResidentARB = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC) glfwGetProcAddress("glMakeTextureHandleResidentARB");
+    glMakeTextureHandleNonResidentARB = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC) glfwGetProcAddress("glMakeTextureHandleNonResidentARB");
+    return glGetTextureSamplerHandleARB && glMakeTextureHandleResidentARB && glMakeTextureHandleNonResidentARB;
+}
+
+GLBindlessTextures::~GLBindlessTextures()
+{
+    release();
+}
+
+GLBindlessTextures::GLBindlessTextures(GLBindlessTextures&& rvalue)
+{
+    *this = std::move(rvalue);
+}
+
+GLBindlessTextures& GLBindlessTextures::operator =(GLBindlessTextures&& rvalue)
+{
+    if (this != &rvalue)
+    {
+        release();
+        std::swap(m_glIds, rvalue.m_glIds);
+        std::swap(m_handles, rvalue.m_handles);
+    }
+    return *this;
+}
+
+GLuint64 GLBindlessTextures::add(const CompressedImage2D & texture, const GLvoid * levels, GLuint sampler)
+{
+    const auto internalFormat = getGLInternalFormat(texture.format);
+    GLuint glId;
+    glGenTextures(1, &glId);
+    glBindTexture(GL_TEXTURE_2D, glId);
+    glTexStorage2D(GL_TEXTURE_2D, texture.levelCount, internalFormat, texture.width, texture.height);
+    for (size_t level = 0; level < texture.levelCount; ++level) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, texture.levelWidth(level), texture.levelHeight(level), internalFormat, texture.levelSize(level), (const unsigned char *) levels + texture.levelOffset(level));
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    const auto handle = glGetTextureSamplerHandleARB(glId, sampler);
+    glMakeTextureHandleResidentARB(handle);
+    m_glIds.push_back(glId);
+    m_handles.push_back(handle);
+    return handle;
+}
+
+void GLBindlessTextures::release()
+{
+    if (m_glIds.empty()) {
+        return;
+    }
+    for (const auto handle : m_handles) {
+        glMakeTextureHandleNonResidentARB(handle);
+    }
+    glDeleteTextures(m_glIds.size(), m_glIds.data());
+    m_glIds.clear();
+    m_handles.clear();
+}
+
+}
@@ -0,0 +1,703 @@
+#include <glmlv/GLProgram.hpp>
+#include <glmlv/MappedFile.hpp>
+#include <glmlv/glfw.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+// Same value for KHR_parallel_shader_compile and ARB_parallel_shader_compile, which are not loaded by glad
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace glmlv
+{
+
+namespace
+{
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR = nullptr;
+
+// A program whose shaders are compiled and linked by compilePrograms
+struct ProgramBuild
+{
+    std::vector<GLShader> shaders; // Kept until the status of the program is known, to report compilation errors
+    std::vector<std::vector<fs::path>> shaderFiles; // Files of each shader, indexed by the source string numbers of compilation errors
+    uint64_t key = 0;
+    fs::path cachePath;
+    std::chrono::steady_clock::time_point startTime;
+    bool pending = false; // Compiled and linked, with a status not known yet
+};
+
+}
+
+static const char ProgramCacheMagic[8] = { 'G', 'L', 'M', 'L', 'V', 'P', 'R', 'G' };
+static const uint32_t ProgramCacheVersion = 1;
+
+struct ProgramCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint64_t key;
+    uint64_t binarySize;
+};
+
+// 64 bits FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void * data, size_t size)
+{
+    const auto bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const std::string & string)
+{
+    // The size is hashed too, so that the concatenation of two strings cannot match another one
+    const auto size = uint64_t(string.size());
+    return hashBytes(hashBytes(hash, &size, sizeof(size)), string.data(), string.size());
+}
+
+static std::string getGLString(GLenum name)
+{
+    const auto string = glGetString(name);
+    return string ? reinterpret_cast<const char *>(string) : "";
+}
+
+static uint64_t makeProgramCacheKey(const std::vector<fs::path> & shaderPaths, const std::vector<std::string> & sources)
+{
+    auto key = 0xcbf29ce484222325ull;
+    for (const auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        key = hashString(key, getGLString(name));
+    }
+    for (size_t i = 0; i < shaderPaths.size(); ++i)
+    {
+        // The type of the shader, from its extension (see createShader)
+        key = hashString(key, shaderPaths[i].stem().extension().string());
+        key = hashString(key, sources[i]);
+    }
+    return key;
+}
+
+// Identify a program by its shaders and defines, whatever their sources
+static uint64_t makeProgramId(const std::vector<fs::path> & shaderPaths, const ShaderDefines & defines)
+{
+    auto id = 0xcbf29ce484222325ull;
+    for (const auto & shaderPath : shaderPaths) {
+        id = hashString(id, shaderPath.string());
+    }
+    for (const auto & define : defines) {
+        id = hashString(hashString(id, define.first), define.second);
+    }
+    return id;
+}
+
+// "<first shader>.<program id>.<key>.glmlvcache": one file per program, so that programs sharing their first shader, or permutations of the same
+// shaders, do not evict each other, and each program only keeps the file of its last key (see removeStaleProgramCaches)
+static fs::path getProgramCachePath(const std::vector<fs::path> & shaderPaths, const ShaderDefines & defines, uint64_t key)
+{
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.%016llx.glmlvcache", (unsigned long long) makeProgramId(shaderPaths, defines), (unsigned long long) key);
+    auto cachePath = shaderPaths.front();
+    cachePath += suffix;
+    return cachePath;
+}
+
+// Remove the caches of the same program with other keys, built from previous sources or for another driver, as well as the caches named
+// "<first shader>.<key>.glmlvcache", without program id, by previous versions
+static void removeStaleProgramCaches(const fs::path & cachePath)
+{
+    const auto fileName = cachePath.filename().string();
+    const std::string extension = ".glmlvcache";
+    const size_t hexLength = 16;
+    // Remove the key and its dot, then the program id and its dot
+    const auto programPrefix = fileName.substr(0, fileName.size() - extension.size() - hexLength);
+    const auto shaderPrefix = programPrefix.substr(0, programPrefix.size() - hexLength - 1);
+    const auto isHex = [](const std::string & string, size_t offset, size_t count)
+    {
+        return string.size() >= offset + count &&
+            std::all_of(begin(string) + offset, begin(string) + offset + count, [](char c) { return std::isxdigit((unsigned char) c) != 0; });
+    };
+
+    std::vector<fs::path> stalePaths;
+    for (const auto & entry : fs::directory_iterator(cachePath.parent_path()))
+    {
+        const auto name = entry.path().filename().string();
+        if (name == fileName || name.size() < extension.size() || name.compare(name.size() - extension.size(), extension.size(), extension)) {
+            continue;
+        }
+        const auto sameProgram = name.size() == fileName.size() && !name.compare(0, programPrefix.size(), programPrefix) && isHex(name, programPrefix.size(), hexLength);
+        const auto previousNaming = name.size() == shaderPrefix.size() + hexLength + extension.size() && !name.compare(0, shaderPrefix.size(), shaderPrefix) &&
+            isHex(name, shaderPrefix.size(), hexLength);
+        if (sameProgram || previousNaming) {
+            stalePaths.emplace_back(entry.path());
+        }
+    }
+    for (const auto & stalePath : stalePaths)
+    {
+        std::clog << "Removing stale program cache " << stalePath << std::endl;
+        fs::remove(stalePath);
+    }
+}
+
+static bool isProgramBinaryFormatSupported(GLenum binaryFormat)
+{
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0) {
+        return false;
+    }
+    std::vector<GLint> formats(formatCount);
+    glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+    return std::find(begin(formats), end(formats), GLint(binaryFormat)) != end(formats);
+}
+
+// Returns false if the cache is missing or corrupted, or if the driver rejects the binary
+static bool readProgramCache(const fs::path & cachePath, uint64_t key, const GLProgram & program)
+{
+    if (!fs::exists(cachePath)) {
+        return false;
+    }
+
+    MappedFile file(cachePath);
+    ProgramCacheHeader header;
+    if (file.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, ProgramCacheMagic, sizeof(header.magic)) || header.version != ProgramCacheVersion || header.key != key ||
+        header.binarySize != file.size() - sizeof(header) || !isProgramBinaryFormatSupported(header.binaryFormat)) {
+        return false;
+    }
+
+    // Drivers reject binaries of other driver versions or hardware with a link failure
+    glProgramBinary(program.glId(), header.binaryFormat, file.data() + sizeof(header), GLsizei(header.binarySize));
+    return program.getLinkStatus();
+}
+
+static void writeProgramCache(const fs::path & cachePath, uint64_t key, const GLProgram & program)
+{
+    GLint binarySize = 0;
+    glGetProgramiv(program.glId(), GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if (binarySize <= 0) {
+        throw std::runtime_error("The driver does not provide program binaries");
+    }
+
+    std::vector<char> buffer(sizeof(ProgramCacheHeader) + binarySize);
+    GLenum binaryFormat;
+    GLsizei writtenSize = 0;
+    glGetProgramBinary(program.glId(), binarySize, &writtenSize, &binaryFormat, buffer.data() + sizeof(ProgramCacheHeader));
+    if (writtenSize != binarySize) {
+        throw std::runtime_error("Unable to get program binary");
+    }
+
+    ProgramCacheHeader header;
+    std::memcpy(header.magic, ProgramCacheMagic, sizeof(header.magic));
+    header.version = ProgramCacheVersion;
+    header.binaryFormat = binaryFormat;
+    header.key = key;
+    header.binarySize = uint64_t(binarySize);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    // Write to a temporary file first so that a concurrent reader never sees a partial cache
+    auto tmpPath = cachePath;
+    tmpPath += ".tmp";
+    {
+        std::ofstream output(tmpPath.string(), std::ios::binary | std::ios::trunc);
+        if (!output || !output.write(buffer.data(), buffer.size())) {
+            throw std::runtime_error("Unable to write program cache " + tmpPath.string());
+        }
+    }
+    fs::rename(tmpPath, cachePath);
+}
+
+// Size of a value of a uniform type, 0 for opaque types (samplers, images, atomic counters), which are set as integers
+static size_t getUniformTypeSize(GLenum type)
+{
+    switch (type)
+    {
+    case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL:
+        return 4;
+    case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: case GL_BOOL_VEC2: case GL_DOUBLE:
+        return 8;
+    case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: case GL_BOOL_VEC3:
+        return 12;
+    case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2: case GL_DOUBLE_VEC2:
+        return 16;
+    case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2: case GL_DOUBLE_VEC3:
+        return 24;
+    case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2: case GL_DOUBLE_VEC4:
+        return 32;
+    case GL_FLOAT_MAT3:
+        return 36;
+    case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3:
+        return 48;
+    case GL_FLOAT_MAT4:
+        return 64;
+    default:
+        return 0;
+    }
+}
+
+static uint32_t hashUniformName(const char * name, uint32_t seed)
+{
+    // FNV-1a with the seed mixed in the offset basis, then a final mix so that the low bits used as slot depend on every character
+    auto hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (; *name; ++name) {
+        hash = (hash ^ uint8_t(*name)) * 16777619u;
+    }
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+void GLProgram::reflectUniforms()
+{
+    m_uniforms = Uniforms();
+    m_reportedUniformNames.clear();
+    m_lookedUpUniforms.clear();
+
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramInterfaceiv(m_GLId, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+    glGetProgramInterfaceiv(m_GLId, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+    std::vector<GLchar> nameBuffer(maxNameLength + 1);
+    GLint maxLocation = -1;
+    for (GLint i = 0; i < uniformCount; ++i)
+    {
+        const GLenum properties[] = { GL_BLOCK_INDEX, GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION };
+        GLint values[4];
+        glGetProgramResourceiv(m_GLId, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+        const auto type = GLenum(values[1]);
+        const auto arraySize = std::max(values[2], 1);
+        const auto location = values[3];
+        // Members of uniform blocks have no location
+        if (values[0] != -1 || location < 0) {
+            continue;
+        }
+        glGetProgramResourceName(m_GLId, GL_UNIFORM, i, GLsizei(nameBuffer.size()), nullptr, nameBuffer.data());
+        const std::string name(nameBuffer.data());
+
+        // Arrays are named after their first element, "a[0]"
+        const auto isArray = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+        const auto baseName = isArray ? name.substr(0, name.size() - 3) : name;
+        if (isArray) {
+            m_uniforms.names.emplace_back(baseName, m_uniforms.uniforms.size());
+        }
+        const auto valueSize = std::max(getUniformTypeSize(type), sizeof(GLint));
+        for (GLint element = 0; element < arraySize; ++element)
+        {
+            m_uniforms.names.emplace_back(isArray ? baseName + "[" + std::to_string(element) + "]" : name, m_uniforms.uniforms.size());
+            m_uniforms.uniforms.push_back(Uniform{ location + element, type, m_uniforms.activeUniformNames.size(), m_uniforms.values.size(), false, false });
+            m_uniforms.values.resize(m_uniforms.values.size() + valueSize);
+        }
+        maxLocation = std::max(maxLocation, location + arraySize - 1);
+        m_uniforms.activeUniformNames.emplace_back(baseName);
+    }
+    m_lookedUpUniforms.assign(m_uniforms.activeUniformNames.size(), false);
+
+    m_uniforms.uniformByLocation.assign(maxLocation + 1, -1);
+    for (size_t i = 0; i < m_uniforms.uniforms.size(); ++i) {
+        m_uniforms.uniformByLocation[m_uniforms.uniforms[i].location] = GLint(i);
+    }
+
+    // Look for a seed giving a different slot to each name, in a table at least twice larger than the number of names, made larger when
+    // seeds keep failing
+    size_t tableSize = 1;
+    while (tableSize < 2 * m_uniforms.names.size()) {
+        tableSize *= 2;
+    }
+    for (uint32_t seed = 0; ; ++seed)
+    {
+        if (seed && seed % 16 == 0) {
+            tableSize *= 2;
+        }
+        m_uniforms.table.assign(tableSize, -1);
+        auto perfect = true;
+        for (size_t i = 0; i < m_uniforms.names.size() && perfect; ++i)
+        {
+            auto & slot = m_uniforms.table[hashUniformName(m_uniforms.names[i].first.c_str(), seed) & (tableSize - 1)];
+            perfect = slot < 0;
+            slot = GLint(i);
+        }
+        if (perfect)
+        {
+            m_uniforms.hashSeed = seed;
+            break;
+        }
+    }
+}
+
+GLint GLProgram::findUniformLocation(const GLchar * name) const
+{
+    if (m_uniforms.table.empty()) {
+        return -1; // Not reflected
+    }
+    const auto index = m_uniforms.table[hashUniformName(name, m_uniforms.hashSeed) & (m_uniforms.table.size() - 1)];
+    if (index < 0 || m_uniforms.names[index].first != name) {
+        return -1;
+    }
+    const auto & uniform = m_uniforms.uniforms[m_uniforms.names[index].second];
+    m_lookedUpUniforms[uniform.activeUniform] = true;
+    return uniform.location;
+}
+
+bool GLProgram::checkUniformsLookedUp() const
+{
+    auto allLookedUp = true;
+    for (size_t i = 0; i < m_uniforms.activeUniformNames.size(); ++i)
+    {
+        if (!m_lookedUpUniforms[i])
+        {
+            std::cerr << "Uniform \"" << m_uniforms.activeUniformNames[i] << "\" of program " << m_GLId << " is active, but never looked up" << std::endl;
+            allLookedUp = false;
+        }
+    }
+    return allLookedUp;
+}
+
+void GLProgram::reportMissingUniform(const GLchar * name) const
+{
+    if (std::find(begin(m_reportedUniformNames), end(m_reportedUniformNames), name) != end(m_reportedUniformNames)) {
+        return;
+    }
+    m_reportedUniformNames.emplace_back(name);
+    std::cerr << "Uniform \"" << name << "\" is not active in program " << m_GLId << ": not declared, or unused by its shaders" << std::endl;
+}
+
+bool GLProgram::updateUniformValue(GLint location, GLenum type, const void * value, size_t size)
+{
+    if (location < 0) {
+        return false;
+    }
+    if (size_t(location) >= m_uniforms.uniformByLocation.size() || m_uniforms.uniformByLocation[location] < 0) {
+        return true; // Not a location of this program: OpenGL reports the error
+    }
+
+    auto & uniform = m_uniforms.uniforms[m_uniforms.uniformByLocation[location]];
+    const auto typeMatches = uniform.type == type || (type == GL_INT && (uniform.type == GL_BOOL || !getUniformTypeSize(uniform.type)));
+    if (!typeMatches)
+    {
+        if (!uniform.typeErrorReported) {
+            std::cerr << "Uniform at location " << location << " of program " << m_GLId << " has type 0x" << std::hex << uniform.type
+                << ", not 0x" << type << std::dec << std::endl;
+            uniform.typeErrorReported = true;
+        }
+        return false;
+    }
+
+    const auto pValue = m_uniforms.values.data() + uniform.valueOffset;
+    if (uniform.valueSet && !std::memcmp(pValue, value, size)) {
+        return false;
+    }
+    std::memcpy(pValue, value, size);
+    uniform.valueSet = true;
+    return true;
+}
+
+// Number of columns of a matrix type (of rows if it is row major), 0 for other types
+static size_t getMatrixVectorCount(GLenum type, bool rowMajor)
+{
+    size_t columnCount = 0;
+    switch (type)
+    {
+    case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4:
+        columnCount = 2;
+        break;
+    case GL_FLOAT_MAT3: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4:
+        columnCount = 3;
+        break;
+    case GL_FLOAT_MAT4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3:
+        columnCount = 4;
+        break;
+    default:
+        return 0;
+    }
+    return rowMajor ? getUniformTypeSize(type) / (sizeof(GLfloat) * columnCount) : columnCount;
+}
+
+bool GLProgram::checkBlockLayout(GLenum blockInterface, const GLchar * blockName, const BlockLayout & layout) const
+{
+    const GLenum variableInterface = blockInterface == GL_SHADER_STORAGE_BLOCK ? GL_BUFFER_VARIABLE : GL_UNIFORM;
+    const auto blockIndex = glGetProgramResourceIndex(m_GLId, blockInterface, blockName);
+    if (blockIndex == GL_INVALID_INDEX)
+    {
+        std::cerr << "Block \"" << blockName << "\" is not active in program " << m_GLId << std::endl;
+        return false;
+    }
+
+    auto matches = true;
+    const auto report = [&](const std::string & difference)
+    {
+        std::cerr << "Block \"" << blockName << "\" of program " << m_GLId << " differs from its C++ structure: " << difference << std::endl;
+        matches = false;
+    };
+
+    const GLenum blockProperties[] = { GL_BUFFER_DATA_SIZE, GL_NUM_ACTIVE_VARIABLES };
+    GLint blockValues[2];
+    glGetProgramResourceiv(m_GLId, blockInterface, blockIndex, 2, blockProperties, 2, nullptr, blockValues);
+    auto blockSize = size_t(blockValues[0]);
+    auto arrayElements = false; // The structure mirrors elements of a top level array without size
+    std::vector<GLint> variables(blockValues[1]);
+    const GLenum activeVariables = GL_ACTIVE_VARIABLES;
+    glGetProgramResourceiv(m_GLId, blockInterface, blockIndex, 1, &activeVariables, GLsizei(variables.size()), nullptr, variables.data());
+
+    GLint maxNameLength = 0;
+    glGetProgramInterfaceiv(m_GLId, variableInterface, GL_MAX_NAME_LENGTH, &maxNameLength);
+    std::vector<GLchar> nameBuffer(maxNameLength + 1);
+    std::vector<bool> memberFound(layout.members.size(), false);
+    for (const auto variable : variables)
+    {
+        glGetProgramResourceName(m_GLId, variableInterface, GLuint(variable), GLsizei(nameBuffer.size()), nullptr, nameBuffer.data());
+        const std::string name(nameBuffer.data());
+        const auto member = std::find_if(begin(layout.members), end(layout.members), [&](const BlockLayout::Member & candidate) { return candidate.name == name; });
+        if (member == end(layout.members))
+        {
+            report("\"" + name + "\" has no member");
+            continue;
+        }
+        memberFound[member - begin(layout.members)] = true;
+
+        // Top level arrays properties only exist for buffer variables
+        const GLenum properties[] = { GL_TYPE, GL_OFFSET, GL_ARRAY_SIZE, GL_ARRAY_STRIDE, GL_MATRIX_STRIDE, GL_IS_ROW_MAJOR, GL_TOP_LEVEL_ARRAY_SIZE, GL_TOP_LEVEL_ARRAY_STRIDE };
+        GLint values[8] = {};
+        const GLsizei propertyCount = variableInterface == GL_BUFFER_VARIABLE ? 8 : 6;
+        glGetProgramResourceiv(m_GLId, variableInterface, GLuint(variable), propertyCount, properties, propertyCount, nullptr, values);
+        const auto type = GLenum(values[0]);
+        const auto offset = size_t(values[1]);
+        const auto arraySize = size_t(values[2]), arrayStride = size_t(values[3]), matrixStride = size_t(values[4]);
+        if (variableInterface == GL_BUFFER_VARIABLE && values[6] == 0)
+        {
+            blockSize = size_t(values[7]);
+            arrayElements = true;
+        }
+
+        // Bytes covered by the variable, padding of arrays and matrices included; unknown for arrays without size
+        auto size = getUniformTypeSize(type);
+        if (arrayStride) {
+            size = arraySize * arrayStride;
+        }
+        else if (matrixStride) {
+            size = getMatrixVectorCount(type, values[5] != 0) * matrixStride;
+        }
+        if (offset != member->offset) {
+            report("\"" + name + "\" is at offset " + std::to_string(offset) + ", its member at " + std::to_string(member->offset));
+        }
+        if ((arraySize || !arrayStride) && size != member->size) {
+            report("\"" + name + "\" covers " + std::to_string(size) + " bytes, its member " + std::to_string(member->size));
+        }
+    }
+
+    for (size_t i = 0; i < layout.members.size(); ++i)
+    {
+        if (!memberFound[i]) {
+            report("member \"" + layout.members[i].name + "\" has no variable");
+        }
+    }
+    // Implementations can report the size of a block without its padding at the end, which only matters between array elements
+    if (arrayElements ? blockSize != layout.size : blockSize > layout.size) {
+        report("the block takes " + std::to_string(blockSize) + " bytes, the structure " + std::to_string(layout.size));
+    }
+    return matches;
+}
+
+// True if the driver builds programs on its own threads, with GL_COMPLETION_STATUS_KHR telling whether a build is done without waiting for it
+static bool initParallelShaderCompile()
+{
+    // Both extensions have the same entry point, but for its suffix
+    glMaxShaderCompilerThreadsKHR = nullptr;
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    }
+    else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    }
+    if (!glMaxShaderCompilerThreadsKHR) {
+        return false;
+    }
+    // As many threads as the driver wants
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    return true;
+}
+
+static std::string getProgramName(const std::vector<fs::path> & shaderPaths, const ShaderDefines & defines)
+{
+    std::string name;
+    for (const auto & path : shaderPaths) {
+        name += (name.empty() ? "" : " + ") + path.filename().string();
+    }
+    if (!defines.empty()) {
+        name += " [" + toString(defines) + "]";
+    }
+    return name;
+}
+
+GLProgram compileProgram(std::vector<fs::path> shaderPaths, const ShaderDefines & defines)
+{
+    auto programs = compilePrograms({ std::move(shaderPaths) }, { defines });
+    return std::move(programs.front());
+}
+
+std::vector<GLProgram> compilePrograms(const std::vector<std::vector<fs::path>> & programShaderPaths, const std::vector<ShaderDefines> & programDefines,
+    std::vector<ProgramCompileStatistics> * pStatistics)
+{
+    static const ShaderDefines noDefines;
+
+    const auto parallel = initParallelShaderCompile();
+
+    std::vector<GLProgram> programs(programShaderPaths.size());
+    std::vector<ProgramBuild> builds(programShaderPaths.size());
+    std::vector<ProgramCompileStatistics> statistics(programShaderPaths.size());
+
+    // Load the cached programs, and issue the compiles and links of the others without querying any status
+    for (size_t i = 0; i < programShaderPaths.size(); ++i)
+    {
+        const auto & shaderPaths = programShaderPaths[i];
+        const auto & defines = i < programDefines.size() ? programDefines[i] : noDefines;
+        if (shaderPaths.empty()) {
+            throw std::runtime_error("No shader to compile");
+        }
+        auto & build = builds[i];
+        build.startTime = std::chrono::steady_clock::now();
+
+        std::vector<std::string> sources;
+        sources.reserve(shaderPaths.size());
+        build.shaderFiles.resize(shaderPaths.size());
+        for (size_t j = 0; j < shaderPaths.size(); ++j) {
+            sources.emplace_back(preprocessShaderSource(shaderPaths[j], defines, &build.shaderFiles[j]));
+        }
+        build.key = makeProgramCacheKey(shaderPaths, sources);
+        build.cachePath = getProgramCachePath(shaderPaths, defines, build.key);
+
+        bool cacheHit = false;
+        try {
+            cacheHit = readProgramCache(build.cachePath, build.key, programs[i]);
+        }
+        catch (const std::exception & e) {
+            std::cerr << "Unable to read program cache " << build.cachePath << ": " << e.what() << std::endl;
+        }
+        if (cacheHit)
+        {
+            programs[i].reflectUniforms();
+            statistics[i].cached = true;
+            statistics[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build.startTime).count();
+            std::clog << "Loading program cache " << build.cachePath << " for " << getProgramName(shaderPaths, defines) << " (" << statistics[i].seconds * 1000 << " ms)" << std::endl;
+            continue;
+        }
+
+        // A program that failed to load a binary is not reused, so that nothing of it remains
+        programs[i] = GLProgram();
+        for (size_t j = 0; j < shaderPaths.size(); ++j)
+        {
+            std::clog << "Compiling shader " << shaderPaths[j] << "\n";
+            auto shader = createShader(shaderPaths[j]);
+            shader.setSource(sources[j]);
+            glCompileShader(shader.glId());
+            programs[i].attachShader(shader);
+            build.shaders.emplace_back(std::move(shader));
+        }
+        glProgramParameteri(programs[i].glId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(programs[i].glId());
+        build.pending = true;
+    }
+
+    // Without the extension, the status queries wait for each build in turn, so that the time of a program includes the builds issued before it
+    auto pendingCount = size_t(std::count_if(begin(builds), end(builds), [](const ProgramBuild & build) { return build.pending; }));
+    while (pendingCount)
+    {
+        for (size_t i = 0; i < builds.size(); ++i)
+        {
+            if (!builds[i].pending) {
+                continue;
+            }
+            if (parallel)
+            {
+                GLint completed = GL_FALSE;
+                glGetProgramiv(programs[i].glId(), GL_COMPLETION_STATUS_KHR, &completed);
+                if (!completed) {
+                    continue;
+                }
+            }
+            else {
+                programs[i].getLinkStatus();
+            }
+            builds[i].pending = false;
+            --pendingCount;
+            statistics[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - builds[i].startTime).count();
+        }
+        if (pendingCount) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::string error;
+    for (size_t i = 0; i < programs.size(); ++i)
+    {
+        if (statistics[i].cached) {
+            continue;
+        }
+        const auto & shaderPaths = programShaderPaths[i];
+        const auto & defines = i < programDefines.size() ? programDefines[i] : noDefines;
+        auto & build = builds[i];
+        if (!programs[i].getLinkStatus())
+        {
+            std::string programError;
+            for (size_t j = 0; j < build.shaders.size(); ++j)
+            {
+                if (!build.shaders[j].getCompileStatus())
+                {
+                    std::cerr << "Shader compilation error: " << shaderPaths[j] << " " << toString(defines) << " " << build.shaders[j].getInfoLog() << std::endl;
+                    for (size_t k = 1; k < build.shaderFiles[j].size(); ++k) {
+                        std::cerr << "    source string " << k << ": " << build.shaderFiles[j][k] << std::endl;
+                    }
+                    programError = programError.empty() ? "Shader compilation error:" + build.shaders[j].getInfoLog() : programError;
+                }
+            }
+            if (programError.empty())
+            {
+                std::cerr << "Program link error: " << getProgramName(shaderPaths, defines) << " " << programs[i].getInfoLog() << std::endl;
+                programError = "Program link error:" + programs[i].getInfoLog();
+            }
+            error = error.empty() ? programError : error;
+            continue;
+        }
+        build.shaders.clear();
+        programs[i].reflectUniforms();
+
+        std::clog << "Compiled program " << getProgramName(shaderPaths, defines) << " (" << statistics[i].seconds * 1000 << " ms)" << std::endl;
+        try {
+            writeProgramCache(build.cachePath, build.key, programs[i]);
+        }
+        catch (const std::exception & e) {
+            std::cerr << "Unable to write program cache " << build.cachePath << ": " << e.what() << std::endl;
+            continue;
+        }
+        try {
+            removeStaleProgramCaches(build.cachePath);
+        }
+        catch (const std::exception & e) {
+            std::cerr << "Unable to remove stale program caches of " << build.cachePath << ": " << e.what() << std::endl;
+        }
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+
+    if (pStatistics) {
+        *pStatistics = std::move(statistics);
+    }
+    return programs;
+}
+
+}
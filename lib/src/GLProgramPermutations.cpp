@@ -0,0 +1,40 @@
+#include <glmlv/GLProgramPermutations.hpp>
+
+#include <algorithm>
+
+namespace glmlv
+{
+
+GLProgram & GLProgramPermutations::get(ShaderDefines defines)
+{
+    std::sort(begin(defines), end(defines));
+    auto it = m_programs.find(defines);
+    if (it == end(m_programs)) {
+        auto program = compileProgram(m_shaderPaths, defines);
+        it = m_programs.emplace(std::move(defines), std::move(program)).first;
+    }
+    return (*it).second;
+}
+
+void GLProgramPermutations::prepare(std::vector<ShaderDefines> permutations)
+{
+    for (auto & defines : permutations) {
+        std::sort(begin(defines), end(defines));
+    }
+    std::sort(begin(permutations), end(permutations));
+    permutations.erase(std::unique(begin(permutations), end(permutations)), end(permutations));
+    permutations.erase(std::remove_if(begin(permutations), end(permutations), [&](const ShaderDefines & defines)
+    {
+        return m_programs.find(defines) != end(m_programs);
+    }), end(permutations));
+    if (permutations.empty()) {
+        return;
+    }
+
+    auto programs = compilePrograms(std::vector<std::vector<fs::path>>(permutations.size(), m_shaderPaths), permutations);
+    for (size_t i = 0; i < permutations.size(); ++i) {
+        m_programs.emplace(std::move(permutations[i]), std::move(programs[i]));
+    }
+}
+
+}
@@ -0,0 +1,163 @@
+#include <glmlv/GLReadbackRing.hpp>
+
+#include <iostream>
+#include <stdexcept>
+
+namespace glmlv
+{
+
+GLReadbackRing::GLReadbackRing(size_t bufferCount, size_t bufferSize):
+    m_Buffers(new Buffer[bufferCount]), m_nBufferCount(bufferCount), m_nBufferSize(bufferSize)
+{
+    // Client storage: the CPU reads the whole buffer, which is better in cached system memory than in video memory
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (size_t i = 0; i < m_nBufferCount; ++i)
+    {
+        auto & buffer = m_Buffers[i];
+        glGenBuffers(1, &buffer.glId);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.glId);
+        glBufferStorage(GL_PIXEL_PACK_BUFFER, m_nBufferSize, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+        // Writable, so that the images delivered can be modified in place (e.g. flipped)
+        buffer.pData = (unsigned char *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_nBufferSize, flags);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!buffer.pData)
+        {
+            std::cerr << "Unable to map read back buffer of " << m_nBufferSize << " bytes" << std::endl;
+            throw std::runtime_error("Unable to map read back buffer");
+        }
+    }
+}
+
+GLReadbackRing::~GLReadbackRing()
+{
+    for (size_t i = 0; i < m_nBufferCount; ++i)
+    {
+        auto & buffer = m_Buffers[i];
+        if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+        }
+        if (buffer.borrowed) {
+            std::cerr << "Read back buffer destroyed while an image uses it" << std::endl;
+        }
+        if (buffer.pData)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.glId);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer.glId);
+    }
+}
+
+bool GLReadbackRing::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, Callback callback)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto pBuffer = acquire(width, height);
+    if (!pBuffer) {
+        return false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pBuffer->glId);
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    issue(*pBuffer, width, height, std::move(callback), startTime);
+    return true;
+}
+
+bool GLReadbackRing::readTexture(GLuint texture, Callback callback)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    GLint width, height;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    const auto pBuffer = acquire(width, height);
+    if (pBuffer)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pBuffer->glId);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (!pBuffer) {
+        return false;
+    }
+    issue(*pBuffer, width, height, std::move(callback), startTime);
+    return true;
+}
+
+void GLReadbackRing::update()
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    while (deliver(0)) {
+    }
+    m_Statistics.glThreadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void GLReadbackRing::finish()
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    while (!m_PendingBuffers.empty()) {
+        deliver(1000000000);
+    }
+    m_Statistics.glThreadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+GLReadbackRing::Buffer * GLReadbackRing::acquire(size_t width, size_t height)
+{
+    if (width * height * Image2DRGBA::NumComponents <= m_nBufferSize)
+    {
+        for (size_t i = 0; i < m_nBufferCount; ++i)
+        {
+            auto & buffer = m_Buffers[i];
+            if (!buffer.fence && !buffer.borrowed) {
+                return &buffer;
+            }
+        }
+    }
+    ++m_Statistics.droppedCount;
+    return nullptr;
+}
+
+void GLReadbackRing::issue(Buffer & buffer, size_t width, size_t height, Callback callback, std::chrono::steady_clock::time_point startTime)
+{
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    buffer.width = width;
+    buffer.height = height;
+    buffer.callback = std::move(callback);
+    buffer.readTime = startTime;
+    m_PendingBuffers.push_back(&buffer);
+    m_Statistics.glThreadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+bool GLReadbackRing::deliver(GLuint64 timeout)
+{
+    if (m_PendingBuffers.empty()) {
+        return false;
+    }
+    auto & buffer = *m_PendingBuffers.front();
+    // The flush bit makes sure the fence is submitted, otherwise waiting for it could last forever
+    const auto status = glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    if (status == GL_WAIT_FAILED) {
+        std::cerr << "Unable to wait for read back fence, delivering the image anyway" << std::endl;
+    }
+    m_PendingBuffers.pop_front();
+    glDeleteSync(buffer.fence);
+    buffer.fence = 0;
+
+    // The pixels are borrowed by the image until its release (or the release of the last image moved from it)
+    buffer.borrowed = true;
+    const auto pBorrowed = &buffer.borrowed;
+    Image2DRGBA image(buffer.width, buffer.height, buffer.pData, std::shared_ptr<const void>(buffer.pData, [pBorrowed](const void *) { *pBorrowed = false; }));
+
+    ++m_Statistics.readCount;
+    m_Statistics.latencySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buffer.readTime).count();
+    const auto callback = std::move(buffer.callback);
+    buffer.callback = nullptr;
+    callback(std::move(image));
+    return true;
+}
+
+}
@@ -0,0 +1,153 @@
+#include <glmlv/GLTextureArrays.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace glmlv
+{
+
+static size_t getMaxLayerCount()
+{
+    GLint maxLayerCount = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayerCount);
+    return size_t(maxLayerCount);
+}
+
+static size_t getMaxUnitCount()
+{
+    GLint maxUnitCount = 0;
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxUnitCount);
+    return size_t(maxUnitCount);
+}
+
+GLTextureArrays::~GLTextureArrays()
+{
+    release();
+}
+
+GLTextureArrays::GLTextureArrays(GLTextureArrays&& rvalue)
+{
+    *this = std::move(rvalue);
+}
+
+GLTextureArrays& GLTextureArrays::operator =(GLTextureArrays&& rvalue)
+{
+    if (this != &rvalue)
+    {
+        release();
+        std::swap(m_arrays, rvalue.m_arrays);
+        std::swap(m_maxArrayCount, rvalue.m_maxArrayCount);
+        std::swap(m_glIds, rvalue.m_glIds);
+        std::swap(m_samplers, rvalue.m_samplers);
+    }
+    return *this;
+}
+
+void GLTextureArrays::setMaxArrayCount(size_t maxArrayCount)
+{
+    if (m_arrays.size() > maxArrayCount) {
+        std::cerr << "Too many texture arrays: " << m_arrays.size() << " for at most " << maxArrayCount << std::endl;
+        throw std::runtime_error("Too many texture arrays");
+    }
+    m_maxArrayCount = maxArrayCount;
+}
+
+GLTextureArrays::Layer GLTextureArrays::add(const CompressedImage2D & texture, const GLvoid * levels)
+{
+    const auto maxLayerCount = getMaxLayerCount();
+
+    // An array full at the maximum layer count is left as is, the texture goes to a new array of the same kind
+    size_t array = 0;
+    for (; array < m_arrays.size(); ++array)
+    {
+        const auto & candidate = m_arrays[array];
+        if (candidate.format == texture.format && candidate.width == texture.width && candidate.height == texture.height
+            && candidate.levelCount == texture.levelCount && (candidate.layerCount < candidate.capacity || candidate.capacity < maxLayerCount)) {
+            break;
+        }
+    }
+
+    if (array == m_arrays.size())
+    {
+        const auto maxArrayCount = m_maxArrayCount ? std::min(m_maxArrayCount, getMaxUnitCount()) : getMaxUnitCount();
+        if (m_arrays.size() >= maxArrayCount) {
+            std::cerr << "Too many texture arrays: " << m_arrays.size() + 1 << " for at most " << maxArrayCount << std::endl;
+            throw std::runtime_error("Too many texture arrays");
+        }
+        m_arrays.push_back({ texture.format, texture.width, texture.height, texture.levelCount, 0, 0 });
+        m_glIds.push_back(0);
+    }
+
+    auto & target = m_arrays[array];
+    if (target.layerCount == target.capacity) {
+        grow(array);
+    }
+
+    const auto layer = target.layerCount++;
+    const auto internalFormat = getGLInternalFormat(texture.format);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_glIds[array]);
+    for (size_t level = 0; level < texture.levelCount; ++level) {
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, texture.levelWidth(level), texture.levelHeight(level), 1,
+            internalFormat, texture.levelSize(level), (const unsigned char *) levels + texture.levelOffset(level));
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return { GLint(array), GLint(layer) };
+}
+
+void GLTextureArrays::bind(GLuint firstUnit, GLuint sampler) const
+{
+    if (m_glIds.empty()) {
+        return;
+    }
+    glBindTextures(firstUnit, m_glIds.size(), m_glIds.data());
+    if (sampler) {
+        m_samplers.assign(m_glIds.size(), sampler);
+        glBindSamplers(firstUnit, m_samplers.size(), m_samplers.data());
+    }
+}
+
+void GLTextureArrays::unbind(GLuint firstUnit) const
+{
+    if (m_glIds.empty()) {
+        return;
+    }
+    glBindTextures(firstUnit, m_glIds.size(), nullptr);
+    glBindSamplers(firstUnit, m_glIds.size(), nullptr);
+}
+
+void GLTextureArrays::grow(size_t array)
+{
+    auto & target = m_arrays[array];
+    const auto capacity = std::min(std::max(size_t(1), 2 * target.capacity), getMaxLayerCount());
+
+    GLuint glId;
+    glGenTextures(1, &glId);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, glId);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, target.levelCount, getGLInternalFormat(target.format), target.width, target.height, capacity);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Whole levels are copied, which is valid for block compressed formats even when their size is not a multiple of 4
+    for (size_t level = 0; target.layerCount && level < target.levelCount; ++level) {
+        glCopyImageSubData(m_glIds[array], GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, glId, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            std::max(size_t(1), target.width >> level), std::max(size_t(1), target.height >> level), target.layerCount);
+    }
+
+    glDeleteTextures(1, &m_glIds[array]);
+    m_glIds[array] = glId;
+    target.capacity = capacity;
+}
+
+void GLTextureArrays::release()
+{
+    if (!m_glIds.empty()) {
+        glDeleteTextures(m_glIds.size(), m_glIds.data());
+    }
+    m_arrays.clear();
+    m_glIds.clear();
+    m_samplers.clear();
+}
+
+}
@@ -0,0 +1,134 @@
+#include <glmlv/GLUploadRing.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace glmlv
+{
+
+static const size_t AllocationAlignment = 16;
+
+GLUploadRing::GLUploadRing(size_t capacity):
+    m_nCapacity(capacity / AllocationAlignment * AllocationAlignment)
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &m_GLId);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_GLId);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, m_nCapacity, nullptr, flags);
+    m_pData = (unsigned char *) glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_nCapacity, flags);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (!m_pData) {
+        glDeleteBuffers(1, &m_GLId);
+        std::cerr << "Unable to map upload ring of " << m_nCapacity << " bytes" << std::endl;
+        throw std::runtime_error("Unable to map upload ring");
+    }
+}
+
+GLUploadRing::~GLUploadRing()
+{
+    for (const auto & region : m_Regions) {
+        if (region.fence) {
+            glDeleteSync(region.fence);
+        }
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_GLId);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &m_GLId);
+}
+
+GLUploadRing::Allocation GLUploadRing::allocate(size_t size)
+{
+    const auto alignedSize = (size + AllocationAlignment - 1) / AllocationAlignment * AllocationAlignment;
+    if (!size || alignedSize > m_nCapacity) {
+        return Allocation();
+    }
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    const auto waitStartTime = std::chrono::steady_clock::now();
+    auto waited = false;
+    for (;;)
+    {
+        if (m_bClosed) {
+            return Allocation();
+        }
+        // An allocation is contiguous: when it does not fit before the end of the buffer, it starts at the beginning and the end is left as padding
+        const auto offset = size_t(m_nHead % m_nCapacity);
+        const auto padding = offset + alignedSize > m_nCapacity ? m_nCapacity - offset : 0;
+        if (m_nHead + padding + alignedSize - m_nTail <= m_nCapacity)
+        {
+            if (!m_nHead) {
+                m_FirstAllocationTime = waitStartTime;
+            }
+            if (waited) {
+                m_Statistics.stallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStartTime).count();
+            }
+            m_nHead += padding + alignedSize;
+            m_Regions.push_back({ m_nHead, 0 });
+
+            Allocation allocation;
+            allocation.offset = padding ? 0 : offset;
+            allocation.data = m_pData + allocation.offset;
+            allocation.size = size;
+            allocation.m_nEnd = m_nHead;
+            return allocation;
+        }
+        m_RecycleCondition.wait(lock);
+        waited = true;
+    }
+}
+
+void GLUploadRing::release(const Allocation & allocation)
+{
+    const auto fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const auto it = std::find_if(begin(m_Regions), end(m_Regions), [&](const Region & region) { return region.end == allocation.m_nEnd; });
+    if (it == end(m_Regions) || it->fence) {
+        glDeleteSync(fence);
+        std::cerr << "Invalid release of an upload ring allocation" << std::endl;
+        throw std::runtime_error("Invalid release of an upload ring allocation");
+    }
+    it->fence = fence;
+    m_Statistics.uploadedByteCount += allocation.size;
+    ++m_Statistics.uploadCount;
+    m_Statistics.uploadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_FirstAllocationTime).count();
+}
+
+void GLUploadRing::update()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto recycled = false;
+    while (!m_Regions.empty() && m_Regions.front().fence)
+    {
+        const auto status = glClientWaitSync(m_Regions.front().fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync(m_Regions.front().fence);
+        m_nTail = m_Regions.front().end;
+        m_Regions.pop_front();
+        recycled = true;
+    }
+    if (recycled) {
+        m_RecycleCondition.notify_all();
+    }
+}
+
+void GLUploadRing::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bClosed = true;
+    }
+    m_RecycleCondition.notify_all();
+}
+
+GLUploadRing::Statistics GLUploadRing::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
+
+}
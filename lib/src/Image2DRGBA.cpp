@@ -1,8 +1,22 @@
 #include <glmlv/Image2DRGBA.hpp>
+#include <glmlv/MappedFile.hpp>
+#include <glmlv/png_encoder.hpp>
 
 #include <iostream>
+#include <fstream>
 #include <algorithm>
 #include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLMLV_USE_SSE
+#include <emmintrin.h>
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -13,49 +27,285 @@
 namespace glmlv
 {
 
-void Image2DRGBA::Deleter::operator ()(unsigned char * ptr) const
+void Image2DDeleter::operator ()(void * ptr) const
 {
-    stbi_image_free(ptr);
+    // Borrowed pixels are released with pOwner
+    if (!pOwner) {
+        stbi_image_free(ptr);
+    }
 }
 
-Image2DRGBA::Image2DRGBA(size_t width, size_t height):
-    m_pData((unsigned char*) STBI_MALLOC(width * height * NumComponents * sizeof(unsigned char)))
+template<typename T>
+Image2D<T>::Image2D(size_t width, size_t height):
+    m_pData((T*) STBI_MALLOC(width * height * NumComponents * sizeof(T))), m_nWidth(width), m_nHeight(height)
 {
 }
 
-Image2DRGBA::Image2DRGBA(size_t width, size_t height, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
-    : Image2DRGBA(width, height)
+template<typename T>
+Image2D<T>::Image2D(size_t width, size_t height, T * pData, std::shared_ptr<const void> pOwner):
+    m_pData(pData, Image2DDeleter{ std::move(pOwner) }), m_nWidth(width), m_nHeight(height)
 {
-    unsigned char * pPixel = m_pData.get();
-    for (size_t i = 0, s = size(); i < size(); ++i)
-    {
-        pPixel[0] = r;
-        pPixel[1] = g;
-        pPixel[2] = b;
-        pPixel[3] = a;
-        pPixel += 4;
+}
+
+template<typename T>
+Image2D<T>::Image2D(size_t width, size_t height, T r, T g, T b, T a)
+    : Image2D(width, height)
+{
+    const T pixel[NumComponents] = { r, g, b, a };
+    T * pPixel = m_pData.get();
+    size_t i = 0;
+#ifdef GLMLV_USE_SSE
+    // A pixel is 4, 8 or 16 bytes: the 16 bytes stores are filled with whole pixels
+    const size_t pixelsPerStore = 16 / sizeof(pixel);
+    unsigned char pixels[16];
+    for (size_t j = 0; j < pixelsPerStore; ++j) {
+        std::memcpy(pixels + j * sizeof(pixel), pixel, sizeof(pixel));
+    }
+    const auto storedPixels = _mm_loadu_si128((const __m128i*) pixels);
+    for (; i + pixelsPerStore <= size(); i += pixelsPerStore, pPixel += pixelsPerStore * NumComponents) {
+        _mm_storeu_si128((__m128i*) pPixel, storedPixels);
+    }
+#endif
+    for (; i < size(); ++i, pPixel += NumComponents) {
+        std::memcpy(pPixel, pixel, sizeof(pixel));
     }
 }
 
-void Image2DRGBA::flipY()
+template<typename T>
+void Image2D<T>::flipY()
 {
-    unsigned char * pFirstLine = m_pData.get();
-    unsigned char * pLastLine = m_pData.get() + (m_nHeight - 1) * m_nWidth * 4;
+    const size_t rowSize = this->rowSize();
+    if (m_nHeight < 2 || !rowSize) {
+        return;
+    }
 
+    unsigned char * pFirstLine = (unsigned char *) m_pData.get();
+    unsigned char * pLastLine = pFirstLine + (m_nHeight - 1) * rowSize;
+
+#ifdef GLMLV_USE_SSE
+    // Swap 64 bytes per iteration, then 16 bytes, then the remaining bytes
     while (pFirstLine < pLastLine)
     {
-        for (size_t x = 0; x < m_nWidth * 4; ++x)
+        size_t x = 0;
+        for (; x + 64 <= rowSize; x += 64)
+        {
+            const auto first0 = _mm_loadu_si128((const __m128i*) (pFirstLine + x));
+            const auto first1 = _mm_loadu_si128((const __m128i*) (pFirstLine + x + 16));
+            const auto first2 = _mm_loadu_si128((const __m128i*) (pFirstLine + x + 32));
+            const auto first3 = _mm_loadu_si128((const __m128i*) (pFirstLine + x + 48));
+            const auto last0 = _mm_loadu_si128((const __m128i*) (pLastLine + x));
+            const auto last1 = _mm_loadu_si128((const __m128i*) (pLastLine + x + 16));
+            const auto last2 = _mm_loadu_si128((const __m128i*) (pLastLine + x + 32));
+            const auto last3 = _mm_loadu_si128((const __m128i*) (pLastLine + x + 48));
+            _mm_storeu_si128((__m128i*) (pFirstLine + x), last0);
+            _mm_storeu_si128((__m128i*) (pFirstLine + x + 16), last1);
+            _mm_storeu_si128((__m128i*) (pFirstLine + x + 32), last2);
+            _mm_storeu_si128((__m128i*) (pFirstLine + x + 48), last3);
+            _mm_storeu_si128((__m128i*) (pLastLine + x), first0);
+            _mm_storeu_si128((__m128i*) (pLastLine + x + 16), first1);
+            _mm_storeu_si128((__m128i*) (pLastLine + x + 32), first2);
+            _mm_storeu_si128((__m128i*) (pLastLine + x + 48), first3);
+        }
+        for (; x + 16 <= rowSize; x += 16)
+        {
+            const auto first = _mm_loadu_si128((const __m128i*) (pFirstLine + x));
+            const auto last = _mm_loadu_si128((const __m128i*) (pLastLine + x));
+            _mm_storeu_si128((__m128i*) (pFirstLine + x), last);
+            _mm_storeu_si128((__m128i*) (pLastLine + x), first);
+        }
+        for (; x < rowSize; ++x) {
             std::swap(pFirstLine[x], pLastLine[x]);
-        pFirstLine += m_nWidth * 4;
-        pLastLine -= m_nWidth * 4;
+        }
+        pFirstLine += rowSize;
+        pLastLine -= rowSize;
+    }
+#else
+    // Swap whole rows through a scratch row
+    std::vector<unsigned char> scratch(rowSize);
+    while (pFirstLine < pLastLine)
+    {
+        std::memcpy(scratch.data(), pFirstLine, rowSize);
+        std::memcpy(pFirstLine, pLastLine, rowSize);
+        std::memcpy(pLastLine, scratch.data(), rowSize);
+        pFirstLine += rowSize;
+        pLastLine -= rowSize;
+    }
+#endif
+}
+
+namespace
+{
+
+const char RawImageMagic[8] = { 'G', 'L', 'M', 'L', 'V', 'I', 'M', 'G' };
+const uint32_t RawImageVersion = 2; // Version 1 only stored 8 bits components
+
+enum class RawComponentType : uint16_t
+{
+    UInt8,
+    Half,
+    Float
+};
+
+template<typename T>
+RawComponentType getRawComponentType();
+
+template<>
+RawComponentType getRawComponentType<unsigned char>()
+{
+    return RawComponentType::UInt8;
+}
+
+template<>
+RawComponentType getRawComponentType<Half>()
+{
+    return RawComponentType::Half;
+}
+
+template<>
+RawComponentType getRawComponentType<float>()
+{
+    return RawComponentType::Float;
+}
+
+// Followed by the pixels of each level, from the largest
+struct RawImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint16_t levelCount;
+    RawComponentType componentType;
+    uint64_t width;
+    uint64_t height;
+};
+
+static_assert(sizeof(RawImageHeader) == 32, "Pixels of raw images must stay aligned on 16 bytes");
+
+bool isRawImage(const unsigned char * data, size_t size)
+{
+    return size >= sizeof(RawImageHeader) && !std::memcmp(data, RawImageMagic, sizeof(RawImageMagic));
+}
+
+}
+
+template<typename T>
+std::vector<Image2D<T>> Image2D<T>::viewRawImage(const std::shared_ptr<const MappedFile> & pFile, const fs::path& path)
+{
+    const auto onFailure = [&](const std::string & reason)
+    {
+        std::cerr << "Unable to read raw image " << path << ": " << reason << std::endl;
+        throw std::runtime_error("Unable to read raw image " + path.string() + ": " + reason);
+    };
+
+    RawImageHeader header;
+    if (!isRawImage(pFile->data(), pFile->size())) {
+        onFailure("invalid header");
+    }
+    std::memcpy(&header, pFile->data(), sizeof(header));
+    if (header.version != RawImageVersion || header.width > pFile->size() || header.height > pFile->size() ||
+        !header.levelCount || header.levelCount > computeMipLevelCount(header.width, header.height)) {
+        onFailure("invalid header");
+    }
+    if (header.componentType != getRawComponentType<T>()) {
+        onFailure("unexpected component type");
+    }
+
+    std::vector<Image2D> levels;
+    auto offset = sizeof(header);
+    for (uint32_t level = 0; level < header.levelCount; ++level)
+    {
+        const auto width = std::max(uint64_t(1), header.width >> level);
+        const auto height = std::max(uint64_t(1), header.height >> level);
+        const auto size = width * height * NumComponents * sizeof(T);
+        if (size > pFile->size() - offset) {
+            onFailure("truncated file");
+        }
+
+        levels.emplace_back(width, height, (T *) const_cast<unsigned char *>(pFile->data() + offset), pFile);
+        offset += size;
+    }
+    return levels;
+}
+
+template<typename T>
+std::vector<Image2D<T>> mapRawImage(const fs::path& path)
+{
+    return Image2D<T>::viewRawImage(std::make_shared<MappedFile>(path, true), path);
+}
+
+Image2DRGBA readImage(const fs::path& path, bool flipY)
+{
+    // Files are mapped rather than read by stb_image, so that raw images borrow the pages of the mapping
+    const auto pFile = std::make_shared<MappedFile>(path, true);
+    if (isRawImage(pFile->data(), pFile->size()))
+    {
+        auto image = std::move(Image2DRGBA::viewRawImage(pFile, path).front());
+        if (flipY) {
+            image.flipY();
+        }
+        return image;
+    }
+    return readImage(pFile->data(), pFile->size(), flipY);
+}
+
+Image2DRGBA32F readImageHDR(const fs::path& path, bool flipY)
+{
+    const auto pFile = std::make_shared<MappedFile>(path, true);
+    if (isRawImage(pFile->data(), pFile->size()))
+    {
+        auto image = std::move(Image2DRGBA32F::viewRawImage(pFile, path).front());
+        if (flipY) {
+            image.flipY();
+        }
+        return image;
     }
+    return readImageHDR(pFile->data(), pFile->size(), flipY);
 }
 
-Image2DRGBA readImage(const fs::path& path)
+Image2DRGBA32F readImageHDR(const unsigned char * data, size_t size, bool flipY)
+{
+    Image2DRGBA32F image;
+    int w, h, n;
+    image.m_pData.reset(stbi_loadf_from_memory(data, int(size), &w, &h, &n, Image2DRGBA32F::NumComponents));
+    if (!image.m_pData)
+    {
+        std::cerr << "Unable to load image " << stbi_failure_reason() << std::endl;
+        throw std::runtime_error(stbi_failure_reason());
+    }
+
+    image.m_nWidth = w;
+    image.m_nHeight = h;
+    if (flipY) {
+        image.flipY();
+    }
+
+    return image;
+}
+
+Image2DRGBA16F convertToHalf(const Image2DRGBA32F & image, size_t threadCount)
+{
+    Image2DRGBA16F result(image.width(), image.height());
+    parallelFor(image.height(), [&](size_t y)
+    {
+        floatToHalf(image(0, y), result(0, y), image.width() * Image2DRGBA32F::NumComponents);
+    }, threadCount);
+    return result;
+}
+
+Image2DRGBA32F convertToFloat(const Image2DRGBA16F & image, size_t threadCount)
+{
+    Image2DRGBA32F result(image.width(), image.height());
+    parallelFor(image.height(), [&](size_t y)
+    {
+        halfToFloat(image(0, y), result(0, y), image.width() * Image2DRGBA16F::NumComponents);
+    }, threadCount);
+    return result;
+}
+
+Image2DRGBA readImage(const unsigned char * data, size_t size, bool flipY)
 {
     Image2DRGBA image;
     int w, h, n;
-    image.m_pData.reset(stbi_load(path.string().c_str(), &w, &h, &n, Image2DRGBA::NumComponents));
+    image.m_pData.reset(stbi_load_from_memory(data, int(size), &w, &h, &n, Image2DRGBA::NumComponents));
     if (!image.m_pData)
     {
         std::cerr << "Unable to load image " << stbi_failure_reason() << std::endl;
@@ -64,37 +314,347 @@ Image2DRGBA readImage(const fs::path& path)
 
     image.m_nWidth = w;
     image.m_nHeight = h;
+    if (flipY) {
+        image.flipY();
+    }
 
     return image;
 }
 
+namespace
+{
+
+// Conversions between 8 bits sRGB and linear values; linear to sRGB uses a table fine enough to round trip all 8 bits values
+struct SRGBTables
+{
+    static const size_t FromLinearSize = 16384;
+
+    float toLinear[256];
+    unsigned char fromLinear[FromLinearSize];
+
+    SRGBTables()
+    {
+        for (size_t i = 0; i < 256; ++i)
+        {
+            const auto c = i / 255.f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (size_t i = 0; i < FromLinearSize; ++i)
+        {
+            const auto c = i / float(FromLinearSize - 1);
+            const auto srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+            fromLinear[i] = (unsigned char) std::min(255, int(srgb * 255.f + 0.5f));
+        }
+    }
+};
+
+const SRGBTables & getSRGBTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+// Pixels of a mip level, as floating point values (linear if filtered in linear space)
+struct MipLevel
+{
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<glm::vec4> pixels;
+};
+
+// Each pixel of the result averages the source pixels covered by its footprint: 2x2 pixels, or 2x3, 3x2 and 3x3 along odd dimensions.
+// loadPixel(x, y) returns a source pixel as a glm::vec4, so that the first level is filtered from the 8 bits pixels of the image without a floating point copy.
+template<typename LoadPixel>
+MipLevel downsample(size_t srcWidth, size_t srcHeight, LoadPixel && loadPixel, size_t threadCount)
+{
+    MipLevel dst;
+    dst.width = std::max(size_t(1), srcWidth / 2);
+    dst.height = std::max(size_t(1), srcHeight / 2);
+    dst.pixels.resize(dst.width * dst.height);
+
+    parallelFor(dst.height, [&](size_t y)
+    {
+        const auto y0 = y * srcHeight / dst.height;
+        const auto y1 = ((y + 1) * srcHeight + dst.height - 1) / dst.height;
+        for (size_t x = 0; x < dst.width; ++x)
+        {
+            const auto x0 = x * srcWidth / dst.width;
+            const auto x1 = ((x + 1) * srcWidth + dst.width - 1) / dst.width;
+            const auto weight = 1.f / float((x1 - x0) * (y1 - y0));
+#ifdef GLMLV_USE_SSE
+            auto sum = _mm_setzero_ps();
+            for (auto srcY = y0; srcY < y1; ++srcY)
+            {
+                for (auto srcX = x0; srcX < x1; ++srcX)
+                {
+                    const glm::vec4 pixel = loadPixel(srcX, srcY);
+                    sum = _mm_add_ps(sum, _mm_loadu_ps(&pixel.x));
+                }
+            }
+            _mm_storeu_ps(&dst.pixels[y * dst.width + x].x, _mm_mul_ps(sum, _mm_set1_ps(weight)));
+#else
+            glm::vec4 sum(0.f);
+            for (auto srcY = y0; srcY < y1; ++srcY)
+            {
+                for (auto srcX = x0; srcX < x1; ++srcX) {
+                    sum += loadPixel(srcX, srcY);
+                }
+            }
+            dst.pixels[y * dst.width + x] = sum * weight;
+#endif
+        }
+    }, threadCount);
+
+    return dst;
+}
+
+Image2DRGBA toImage(const MipLevel & level, bool sRGB, size_t threadCount)
+{
+    const auto & tables = getSRGBTables();
+    // Color channels are scaled to an index in the sRGB table, or to 8 bits values
+    const auto colorScale = sRGB ? float(SRGBTables::FromLinearSize - 1) : 255.f;
+
+    Image2DRGBA image(level.width, level.height);
+    parallelFor(level.height, [&](size_t y)
+    {
+        const auto src = level.pixels.data() + y * level.width;
+        auto dst = image(0, y);
+        for (size_t x = 0; x < level.width; ++x, dst += Image2DRGBA::NumComponents)
+        {
+            int32_t values[4];
+#ifdef GLMLV_USE_SSE
+            const auto clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&src[x].x), _mm_setzero_ps()), _mm_set1_ps(1.f));
+            const auto scaled = _mm_add_ps(_mm_mul_ps(clamped, _mm_setr_ps(colorScale, colorScale, colorScale, 255.f)), _mm_set1_ps(0.5f));
+            _mm_storeu_si128((__m128i*) values, _mm_cvttps_epi32(scaled));
+#else
+            const auto clamped = glm::clamp(src[x], glm::vec4(0.f), glm::vec4(1.f));
+            for (size_t c = 0; c < 4; ++c) {
+                values[c] = int32_t(clamped[c] * (c < 3 ? colorScale : 255.f) + 0.5f);
+            }
+#endif
+            for (size_t c = 0; c < 3; ++c) {
+                dst[c] = sRGB ? tables.fromLinear[values[c]] : (unsigned char) values[c];
+            }
+            dst[3] = (unsigned char) values[3];
+        }
+    }, threadCount);
+    return image;
+}
+
+float loadComponent(float value)
+{
+    return value;
+}
+
+float loadComponent(Half value)
+{
+    return halfToFloat(value);
+}
+
+void storeComponents(const float * src, float * dst, size_t count)
+{
+    std::memcpy(dst, src, count * sizeof(float));
+}
+
+void storeComponents(const float * src, Half * dst, size_t count)
+{
+    floatToHalf(src, dst, count);
+}
+
+// Floating point images store the filtered values as is, or rounded to half precision
+template<typename T>
+Image2D<T> toFloatingPointImage(const MipLevel & level, size_t threadCount)
+{
+    Image2D<T> image(level.width, level.height);
+    parallelFor(level.height, [&](size_t y)
+    {
+        storeComponents(&level.pixels[y * level.width].x, image(0, y), level.width * Image2D<T>::NumComponents);
+    }, threadCount);
+    return image;
+}
+
+// The first level is filtered from the pixels of the image returned by loadPixel(x, y), every level is converted to an image by toImage(level)
+template<typename T, typename LoadPixel, typename ToImage>
+std::vector<Image2D<T>> generateMipmaps(const Image2D<T> & image, LoadPixel && loadPixel, ToImage && toImage, size_t threadCount)
+{
+    std::vector<Image2D<T>> levels;
+    if (!image.size()) {
+        return levels;
+    }
+
+    MipLevel level;
+    for (size_t i = 1; i < computeMipLevelCount(image.width(), image.height()); ++i)
+    {
+        if (i == 1) {
+            level = downsample(image.width(), image.height(), loadPixel, threadCount);
+        }
+        else
+        {
+            const auto & src = level;
+            level = downsample(src.width, src.height, [&](size_t x, size_t y)
+            {
+                return src.pixels[x + y * src.width];
+            }, threadCount);
+        }
+        levels.emplace_back(toImage(level));
+    }
+    return levels;
+}
+
+template<typename T>
+std::vector<Image2D<T>> generateFloatingPointMipmaps(const Image2D<T> & image, size_t threadCount)
+{
+    return generateMipmaps(image, [&](size_t x, size_t y)
+    {
+        const auto pixel = image(x, y);
+        return glm::vec4(loadComponent(pixel[0]), loadComponent(pixel[1]), loadComponent(pixel[2]), loadComponent(pixel[3]));
+    }, [&](const MipLevel & level)
+    {
+        return toFloatingPointImage<T>(level, threadCount);
+    }, threadCount);
+}
+
+}
+
+size_t computeMipLevelCount(size_t width, size_t height)
+{
+    size_t count = 1;
+    for (auto size = std::max(width, height); size > 1; size /= 2) {
+        ++count;
+    }
+    return count;
+}
+
+std::vector<Image2DRGBA> generateMipmaps(const Image2DRGBA & image, bool sRGB, size_t threadCount)
+{
+    const auto & tables = getSRGBTables();
+    return generateMipmaps(image, [&](size_t x, size_t y)
+    {
+        const auto pixel = image(x, y);
+        if (sRGB) {
+            return glm::vec4(tables.toLinear[pixel[0]], tables.toLinear[pixel[1]], tables.toLinear[pixel[2]], pixel[3] / 255.f);
+        }
+        return glm::vec4(pixel[0], pixel[1], pixel[2], pixel[3]) / 255.f;
+    }, [&](const MipLevel & level)
+    {
+        return toImage(level, sRGB, threadCount);
+    }, threadCount);
+}
+
+std::vector<Image2DRGBA16F> generateMipmaps(const Image2DRGBA16F & image, size_t threadCount)
+{
+    return generateFloatingPointMipmaps(image, threadCount);
+}
+
+std::vector<Image2DRGBA32F> generateMipmaps(const Image2DRGBA32F & image, size_t threadCount)
+{
+    return generateFloatingPointMipmaps(image, threadCount);
+}
+
 void writeImage(const Image2DRGBA& image, const fs::path& path)
 {
-    const auto onFailure = []()
+    const auto onFailure = [&](const std::string & reason)
     {
-        std::cerr << "Unable to write image" << std::endl;
-        throw std::runtime_error("Unable to write image");
+        std::cerr << "Unable to write image " << path << ": " << reason << std::endl;
+        throw std::runtime_error("Unable to write image " + path.string() + ": " + reason);
     };
 
+    // stb_image_write returns 0 on failure
     const auto ext = path.extension();
-    if (ext == ".png")
+    if (ext == ".png") {
+        writePNG(image, path);
+    }
+    else if (ext == ".bmp")
     {
-        if (stbi_write_png(path.string().c_str(), image.width(), image.height(), Image2DRGBA::NumComponents, image.data(), 0)) {
-            onFailure();
+        if (!stbi_write_bmp(path.string().c_str(), image.width(), image.height(), Image2DRGBA::NumComponents, image.data())) {
+            onFailure("write error");
         }
     }
-    if (ext == ".bmp")
+    else if (ext == ".tga")
+    {
+        if (!stbi_write_tga(path.string().c_str(), image.width(), image.height(), Image2DRGBA::NumComponents, image.data())) {
+            onFailure("write error");
+        }
+    }
+    else {
+        onFailure("unsupported format");
+    }
+}
+
+void writeImage(const Image2DRGBA16F& image, const fs::path& path)
+{
+    writeImage(convertToFloat(image), path);
+}
+
+void writeImage(const Image2DRGBA32F& image, const fs::path& path)
+{
+    const auto onFailure = [&](const std::string & reason)
+    {
+        std::cerr << "Unable to write image " << path << ": " << reason << std::endl;
+        throw std::runtime_error("Unable to write image " + path.string() + ": " + reason);
+    };
+
+    if (path.extension() != ".hdr") {
+        onFailure("unsupported format");
+    }
+    if (!stbi_write_hdr(path.string().c_str(), image.width(), image.height(), Image2DRGBA32F::NumComponents, image.data())) {
+        onFailure("write error");
+    }
+}
+
+template<typename T>
+void writeRawImage(const Image2D<T>& image, const std::vector<Image2D<T>>& mipmaps, const fs::path& path)
+{
+    const auto onFailure = [&](const std::string & reason)
     {
-        if (stbi_write_bmp(path.string().c_str(), image.width(), image.height(), Image2DRGBA::NumComponents, image.data())) {
-            onFailure();
+        std::cerr << "Unable to write raw image " << path << ": " << reason << std::endl;
+        throw std::runtime_error("Unable to write raw image " + path.string() + ": " + reason);
+    };
+
+    if (mipmaps.size() >= computeMipLevelCount(image.width(), image.height())) {
+        onFailure("too many mipmaps");
+    }
+    for (size_t level = 1; level <= mipmaps.size(); ++level)
+    {
+        if (mipmaps[level - 1].width() != std::max(size_t(1), image.width() >> level) || mipmaps[level - 1].height() != std::max(size_t(1), image.height() >> level)) {
+            onFailure("invalid mipmap size");
         }
     }
-    if (ext == ".tga")
+
+    RawImageHeader header;
+    std::memcpy(header.magic, RawImageMagic, sizeof(RawImageMagic));
+    header.version = RawImageVersion;
+    header.levelCount = uint16_t(1 + mipmaps.size());
+    header.componentType = getRawComponentType<T>();
+    header.width = image.width();
+    header.height = image.height();
+
+    std::ofstream output(path.string(), std::ios::binary | std::ios::trunc);
+    const auto writeLevel = [&](const Image2D<T> & level)
+    {
+        return bool(output.write((const char *) level.data(), level.size() * Image2D<T>::NumComponents * sizeof(T)));
+    };
+    if (!output || !output.write((const char *) &header, sizeof(header)) || !writeLevel(image)) {
+        onFailure("write error");
+    }
+    for (const auto & mipmap : mipmaps)
     {
-        if (stbi_write_tga(path.string().c_str(), image.width(), image.height(), Image2DRGBA::NumComponents, image.data())) {
-            onFailure();
+        if (!writeLevel(mipmap)) {
+            onFailure("write error");
         }
     }
 }
 
-}
\ No newline at end of file
+template class Image2D<unsigned char>;
+template class Image2D<Half>;
+template class Image2D<float>;
+
+template void writeRawImage(const Image2DRGBA& image, const std::vector<Image2DRGBA>& mipmaps, const fs::path& path);
+template void writeRawImage(const Image2DRGBA16F& image, const std::vector<Image2DRGBA16F>& mipmaps, const fs::path& path);
+template void writeRawImage(const Image2DRGBA32F& image, const std::vector<Image2DRGBA32F>& mipmaps, const fs::path& path);
+
+template std::vector<Image2DRGBA> mapRawImage(const fs::path& path);
+template std::vector<Image2DRGBA16F> mapRawImage(const fs::path& path);
+template std::vector<Image2DRGBA32F> mapRawImage(const fs::path& path);
+
+}
@@ -0,0 +1,183 @@
+#include <glmlv/ImageWriter.hpp>
+#include <glmlv/png_encoder.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace glmlv
+{
+
+struct ImageWriter::Job
+{
+    Image2DRGBA image;
+    fs::path path;
+    bool flipY;
+    std::vector<PNGBlock> blocks; // Empty for other formats
+    std::atomic<size_t> remainingTaskCount{ 0 };
+    std::atomic<bool> failed{ false };
+    std::chrono::steady_clock::time_point queueTime;
+};
+
+ImageWriter::ImageWriter(size_t maxQueuedImageCount, size_t threadCount):
+    m_nMaxQueuedImageCount(std::max(size_t(1), maxQueuedImageCount))
+{
+    for (size_t i = 0; i < std::max(size_t(1), threadCount); ++i) {
+        m_Threads.emplace_back([this]() { run(); });
+    }
+}
+
+ImageWriter::~ImageWriter()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_FinishCondition.wait(lock, [&]() { return !m_nQueuedImageCount; });
+        m_bStopped = true;
+    }
+    m_TaskCondition.notify_all();
+    for (auto & thread : m_Threads) {
+        thread.join();
+    }
+}
+
+void ImageWriter::write(Image2DRGBA image, fs::path path, bool flipY)
+{
+    const auto pJob = std::make_shared<Job>();
+    pJob->image = std::move(image);
+    pJob->path = std::move(path);
+    pJob->flipY = flipY;
+    const auto isPNG = pJob->path.extension() == ".png" && pJob->image.size();
+    if (isPNG) {
+        pJob->blocks.resize(computePNGBlockCount(pJob->image));
+    }
+    const auto taskCount = isPNG ? pJob->blocks.size() : 1;
+    pJob->remainingTaskCount = taskCount;
+
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        const auto startTime = std::chrono::steady_clock::now();
+        m_FinishCondition.wait(lock, [&]() { return m_nQueuedImageCount < m_nMaxQueuedImageCount; });
+        pJob->queueTime = std::chrono::steady_clock::now();
+        m_Statistics.stallSeconds += std::chrono::duration<double>(pJob->queueTime - startTime).count();
+
+        ++m_nQueuedImageCount;
+        for (size_t i = 0; i < taskCount; ++i) {
+            m_Tasks.push_back(Task{ pJob, i });
+        }
+    }
+    m_TaskCondition.notify_all();
+}
+
+void ImageWriter::flush()
+{
+    size_t failureCount;
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_FinishCondition.wait(lock, [&]() { return !m_nQueuedImageCount; });
+        failureCount = m_nFailureCount;
+        m_nFailureCount = 0;
+    }
+    if (failureCount)
+    {
+        std::cerr << "Unable to write " << failureCount << " images" << std::endl;
+        throw std::runtime_error("Unable to write " + std::to_string(failureCount) + " images");
+    }
+}
+
+size_t ImageWriter::queuedImageCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_nQueuedImageCount;
+}
+
+ImageWriter::Statistics ImageWriter::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Statistics;
+}
+
+void ImageWriter::run()
+{
+    for (;;)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_TaskCondition.wait(lock, [&]() { return m_bStopped || !m_Tasks.empty(); });
+            if (m_Tasks.empty()) {
+                return;
+            }
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+
+        auto & job = *task.pJob;
+        if (!job.blocks.empty() && !job.failed)
+        {
+            try {
+                job.blocks[task.blockIndex] = encodePNGBlock(job.image, task.blockIndex, job.flipY);
+            }
+            catch (const std::exception & e)
+            {
+                std::cerr << "Unable to encode image " << job.path << ": " << e.what() << std::endl;
+                job.failed = true;
+            }
+        }
+        // The thread completing the last task of an image writes it
+        if (--job.remainingTaskCount) {
+            continue;
+        }
+
+        auto written = false;
+        if (!job.failed)
+        {
+            try
+            {
+                if (job.blocks.empty())
+                {
+                    if (job.flipY) {
+                        job.image.flipY();
+                    }
+                    writeImage(job.image, job.path);
+                }
+                else {
+                    writePNG(job.image, job.blocks, job.path);
+                }
+                written = true;
+            }
+            catch (const std::exception &) {
+                // Already logged by writeImage and writePNG
+            }
+        }
+        finish(job, written);
+    }
+}
+
+void ImageWriter::finish(Job & job, bool written)
+{
+    // Release the pixels before waking up a producer that could queue more
+    job.image = Image2DRGBA();
+    job.blocks.clear();
+    job.blocks.shrink_to_fit();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        --m_nQueuedImageCount;
+        if (written)
+        {
+            ++m_Statistics.writtenImageCount;
+            m_Statistics.writeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - job.queueTime).count();
+        }
+        else
+        {
+            ++m_Statistics.failedImageCount;
+            ++m_nFailureCount;
+        }
+    }
+    m_FinishCondition.notify_all();
+}
+
+}
@@ -0,0 +1,130 @@
+#include <glmlv/MappedFile.hpp>
+
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace glmlv
+{
+
+MappedFile::MappedFile(const fs::path & path, bool copyOnWrite)
+{
+    const auto onFailure = [&]()
+    {
+        close();
+        std::cerr << "Unable to map file " << path << std::endl;
+        throw std::runtime_error("Unable to map file " + path.string());
+    };
+
+#ifdef _WIN32
+    const HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        onFailure();
+    }
+    m_FileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        onFailure();
+    }
+    m_nSize = size_t(fileSize.QuadPart);
+    if (!m_nSize) {
+        return; // Empty files cannot be mapped, but are valid
+    }
+
+    m_MappingHandle = CreateFileMappingW(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if (!m_MappingHandle) {
+        onFailure();
+    }
+
+    m_pData = (const unsigned char *) MapViewOfFile(m_MappingHandle, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (!m_pData) {
+        onFailure();
+    }
+#else
+    const int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0) {
+        onFailure();
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0) {
+        ::close(fd);
+        onFailure();
+    }
+    m_nSize = size_t(fileStat.st_size);
+    if (!m_nSize) {
+        ::close(fd);
+        return; // Empty files cannot be mapped, but are valid
+    }
+
+    void * ptr = mmap(nullptr, m_nSize, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference on the file
+    if (ptr == MAP_FAILED) {
+        m_nSize = 0;
+        onFailure();
+    }
+    m_pData = (const unsigned char *) ptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& rvalue)
+{
+    *this = std::move(rvalue);
+}
+
+MappedFile& MappedFile::operator =(MappedFile&& rvalue)
+{
+    if (this != &rvalue)
+    {
+        close();
+        std::swap(m_pData, rvalue.m_pData);
+        std::swap(m_nSize, rvalue.m_nSize);
+#ifdef _WIN32
+        std::swap(m_FileHandle, rvalue.m_FileHandle);
+        std::swap(m_MappingHandle, rvalue.m_MappingHandle);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_pData) {
+        UnmapViewOfFile(m_pData);
+    }
+    if (m_MappingHandle) {
+        CloseHandle(m_MappingHandle);
+    }
+    if (m_FileHandle) {
+        CloseHandle(m_FileHandle);
+    }
+    m_FileHandle = nullptr;
+    m_MappingHandle = nullptr;
+#else
+    if (m_pData) {
+        munmap((void *) m_pData, m_nSize);
+    }
+#endif
+    m_pData = nullptr;
+    m_nSize = 0;
+}
+
+}
@@ -0,0 +1,27 @@
+#include <glmlv/bindless_material.hpp>
+
+namespace glmlv
+{
+
+std::vector<BindlessMaterial> makeBindlessMaterials(const std::vector<ObjData::PhongMaterial> & materials, const ObjData::PhongMaterial & defaultMaterial,
+    const std::vector<GLuint64> & textureHandles)
+{
+    std::vector<BindlessMaterial> bindlessMaterials;
+    bindlessMaterials.reserve(materials.size() + 1);
+    for (size_t i = 0; i <= materials.size(); ++i)
+    {
+        const auto & material = i < materials.size() ? materials[i] : defaultMaterial;
+        BindlessMaterial bindlessMaterial;
+        bindlessMaterial.Ka = glm::vec4(material.Ka, 0);
+        bindlessMaterial.Kd = glm::vec4(material.Kd, 0);
+        bindlessMaterial.KsShininess = glm::vec4(material.Ks, material.shininess);
+        bindlessMaterial.textures[0] = textureHandles[material.KaTextureId];
+        bindlessMaterial.textures[1] = textureHandles[material.KdTextureId];
+        bindlessMaterial.textures[2] = textureHandles[material.KsTextureId];
+        bindlessMaterial.textures[3] = textureHandles[material.shininessTextureId];
+        bindlessMaterials.push_back(bindlessMaterial);
+    }
+    return bindlessMaterials;
+}
+
+}
@@ -0,0 +1,110 @@
+#include <glmlv/frustum_culling.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLMLV_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace glmlv
+{
+
+Frustum extractFrustum(const glm::mat4 & viewProjMatrix)
+{
+    const auto m = glm::transpose(viewProjMatrix); // Rows of viewProjMatrix
+    Frustum frustum;
+    frustum.planes[0] = m[3] + m[0];
+    frustum.planes[1] = m[3] - m[0];
+    frustum.planes[2] = m[3] + m[1];
+    frustum.planes[3] = m[3] - m[1];
+    frustum.planes[4] = m[3] + m[2];
+    frustum.planes[5] = m[3] - m[2];
+    for (auto & plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+// A box is outside if it is entirely on the negative side of a plane, i.e. if its corner furthest along the plane normal is
+static bool isBoxVisible(const Frustum & frustum, const glm::vec3 & bboxMin, const glm::vec3 & bboxMax)
+{
+    const auto center = 0.5f * (bboxMin + bboxMax);
+    const auto extent = glm::max(0.5f * (bboxMax - bboxMin), glm::vec3(0));
+    for (const auto & plane : frustum.planes)
+    {
+        const auto normal = glm::vec3(plane);
+        if (glm::dot(normal, center) + glm::dot(glm::abs(normal), extent) + plane.w < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t cullBoxes(const Frustum & frustum, const glm::vec3 * bboxMin, const glm::vec3 * bboxMax, size_t count, uint8_t * visible)
+{
+    size_t visibleCount = 0;
+    size_t i = 0;
+
+#ifdef GLMLV_USE_SSE
+    const auto half = _mm_set1_ps(0.5f);
+    const auto zero = _mm_setzero_ps();
+    const auto signMask = _mm_set1_ps(-0.f);
+
+    // Planes splatted per component, with the absolute values of the normals
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+    for (size_t p = 0; p < 6; ++p)
+    {
+        planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+        planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+        absPlaneX[p] = _mm_andnot_ps(signMask, planeX[p]);
+        absPlaneY[p] = _mm_andnot_ps(signMask, planeY[p]);
+        absPlaneZ[p] = _mm_andnot_ps(signMask, planeZ[p]);
+    }
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // Boxes are stored as arrays of structures: transpose four of them to one register per coordinate
+        const auto minX = _mm_setr_ps(bboxMin[i].x, bboxMin[i + 1].x, bboxMin[i + 2].x, bboxMin[i + 3].x);
+        const auto minY = _mm_setr_ps(bboxMin[i].y, bboxMin[i + 1].y, bboxMin[i + 2].y, bboxMin[i + 3].y);
+        const auto minZ = _mm_setr_ps(bboxMin[i].z, bboxMin[i + 1].z, bboxMin[i + 2].z, bboxMin[i + 3].z);
+        const auto maxX = _mm_setr_ps(bboxMax[i].x, bboxMax[i + 1].x, bboxMax[i + 2].x, bboxMax[i + 3].x);
+        const auto maxY = _mm_setr_ps(bboxMax[i].y, bboxMax[i + 1].y, bboxMax[i + 2].y, bboxMax[i + 3].y);
+        const auto maxZ = _mm_setr_ps(bboxMax[i].z, bboxMax[i + 1].z, bboxMax[i + 2].z, bboxMax[i + 3].z);
+
+        const auto centerX = _mm_mul_ps(half, _mm_add_ps(minX, maxX));
+        const auto centerY = _mm_mul_ps(half, _mm_add_ps(minY, maxY));
+        const auto centerZ = _mm_mul_ps(half, _mm_add_ps(minZ, maxZ));
+        const auto extentX = _mm_max_ps(zero, _mm_mul_ps(half, _mm_sub_ps(maxX, minX)));
+        const auto extentY = _mm_max_ps(zero, _mm_mul_ps(half, _mm_sub_ps(maxY, minY)));
+        const auto extentZ = _mm_max_ps(zero, _mm_mul_ps(half, _mm_sub_ps(maxZ, minZ)));
+
+        auto outside = _mm_setzero_ps();
+        for (size_t p = 0; p < 6; ++p)
+        {
+            auto distance = _mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY));
+            distance = _mm_add_ps(distance, _mm_add_ps(_mm_mul_ps(planeZ[p], centerZ), planeW[p]));
+            auto radius = _mm_add_ps(_mm_mul_ps(absPlaneX[p], extentX), _mm_mul_ps(absPlaneY[p], extentY));
+            radius = _mm_add_ps(radius, _mm_mul_ps(absPlaneZ[p], extentZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        const auto outsideMask = _mm_movemask_ps(outside);
+        for (size_t k = 0; k < 4; ++k)
+        {
+            visible[i + k] = (outsideMask >> k) & 1 ? 0 : 1;
+            visibleCount += visible[i + k];
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        visible[i] = isBoxVisible(frustum, bboxMin[i], bboxMax[i]) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+
+    return visibleCount;
+}
+
+}
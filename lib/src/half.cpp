@@ -0,0 +1,138 @@
+#include <glmlv/half.hpp>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLMLV_USE_SSE
+#include <emmintrin.h>
+#endif
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+namespace glmlv
+{
+
+namespace
+{
+
+uint32_t asUint(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float asFloat(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Float bits from which values round to a half infinity (2^16), and below which they become half subnormals (2^-14)
+const uint32_t HalfOverflow = (127 + 16) << 23;
+const uint32_t HalfMinNormal = (127 - 14) << 23;
+// Adding this float to a value below 2^-14 aligns the half subnormal mantissa on the low bits of the float, rounded by the FPU to nearest even
+const uint32_t SubnormalMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+// Rebias the exponent and add half of a half precision unit minus one: with the lowest kept bit added, normal values round to nearest even
+const uint32_t NormalBias = 0xfff - ((127 - 15) << 23);
+
+#if defined(GLMLV_USE_SSE) && !defined(__F16C__)
+// Same algorithm as floatToHalf, branchless on 4 values; the halves are in the low 16 bits of each 32 bits lane
+__m128i floatToHalf4(__m128 values)
+{
+    const auto sign = _mm_and_ps(values, _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000u))));
+    const auto absValues = _mm_xor_ps(values, sign);
+    const auto absBits = _mm_castps_si128(absValues);
+
+    const auto isNaN = _mm_castps_si128(_mm_cmpunord_ps(absValues, absValues));
+    const auto isFinite = _mm_cmpgt_epi32(_mm_set1_epi32(int(HalfOverflow)), absBits);
+    const auto isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32(int(HalfMinNormal)), absBits);
+    const auto infOrNaN = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(isNaN, _mm_set1_epi32(0x200)));
+
+    const auto magic = _mm_set1_epi32(int(SubnormalMagic));
+    const auto subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValues, _mm_castsi128_ps(magic))), magic);
+
+    const auto oddMantissa = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31); // -1 if the lowest kept bit is set
+    const auto normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, _mm_set1_epi32(int(NormalBias))), oddMantissa), 13);
+
+    const auto finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+    const auto result = _mm_or_si128(_mm_and_si128(isFinite, finite), _mm_andnot_si128(isFinite, infOrNaN));
+    return _mm_or_si128(result, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+#endif
+
+}
+
+Half floatToHalf(float value)
+{
+    auto bits = asUint(value);
+    const auto sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t result;
+    if (bits >= HalfOverflow) {
+        result = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    }
+    else if (bits < HalfMinNormal) {
+        result = asUint(asFloat(bits) + asFloat(SubnormalMagic)) - SubnormalMagic;
+    }
+    else {
+        result = (bits + NormalBias + ((bits >> 13) & 1)) >> 13;
+    }
+    return Half{ uint16_t(result | (sign >> 16)) };
+}
+
+float halfToFloat(Half value)
+{
+    const uint32_t shiftedExponent = 0x7c00 << 13;
+    auto bits = uint32_t(value.bits & 0x7fff) << 13;
+    const auto exponent = bits & shiftedExponent;
+    bits += (127 - 15) << 23;
+    if (exponent == shiftedExponent) {
+        bits += (128 - 16) << 23; // Infinities and NaNs
+    }
+    else if (!exponent) {
+        bits = asUint(asFloat(bits + (1 << 23)) - asFloat(113 << 23)); // Subnormals are renormalized by the FPU
+    }
+    return asFloat(bits | (uint32_t(value.bits & 0x8000) << 16));
+}
+
+void floatToHalf(const float * src, Half * dst, size_t count)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 4 <= count; i += 4) {
+        _mm_storel_epi64((__m128i*) (dst + i), _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+#elif defined(GLMLV_USE_SSE)
+    for (; i + 8 <= count; i += 8)
+    {
+        // Sign extend the 16 bits results so that the saturating pack keeps them as is
+        const auto low = floatToHalf4(_mm_loadu_ps(src + i));
+        const auto high = floatToHalf4(_mm_loadu_ps(src + i + 4));
+        const auto packed = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(low, 16), 16), _mm_srai_epi32(_mm_slli_epi32(high, 16), 16));
+        _mm_storeu_si128((__m128i*) (dst + i), packed);
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = floatToHalf(src[i]);
+    }
+}
+
+void halfToFloat(const Half * src, float * dst, size_t count)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*) (src + i))));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = halfToFloat(src[i]);
+    }
+}
+
+}
@@ -1,4 +1,9 @@
 #include <glmlv/load_obj.hpp>
+#include <glmlv/MappedFile.hpp>
+#include <glmlv/parallel.hpp>
+#include <glmlv/FlatHashMap.hpp>
+#include <glmlv/texture_compression.hpp>
+#include <glmlv/mesh_optimizer.hpp>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
@@ -8,6 +13,16 @@
 #include <unordered_set>
 #include <string>
 #include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <chrono>
+#include <map>
+#include <limits>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <stb_image.h>
 
 namespace glmlv
 {
@@ -36,17 +51,520 @@ struct TinyObjLoaderEqualTo
     }
 };
 
-// Load an obj model with tinyobjloader
-// Obj models might use different set of indices per vertex. The default rendering mechanism of OpenGL does not support this feature to this functions duplicate attributes with different indices.
-void loadObj(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & data, bool loadTextures)
+// 96-bit key and 32-bit value: each slot of the map is 16 bytes
+using TinyObjLoaderIndexMap = FlatHashMap<tinyobj::index_t, uint32_t, TinyObjLoaderIndexHash, TinyObjLoaderEqualTo>;
+
+// Never produced by the parser, used to mark empty slots of TinyObjLoaderIndexMap
+static const tinyobj::index_t EmptyTinyObjLoaderIndex = { std::numeric_limits<int>::min(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min() };
+
+// Maximum number of bytes (encoded file and decoded pixels) of the images being decoded at the same time by readTextures.
+// An image bigger than the budget is still decoded, alone.
+static const size_t TextureDecodingMemoryBudget = size_t(512) << 20;
+
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(size_t capacity):
+        m_nCapacity(capacity)
+    {
+    }
+
+    void acquire(size_t size)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_ReleaseCondition.wait(lock, [&]() { return !m_nUsed || m_nUsed + size <= m_nCapacity; });
+        m_nUsed += size;
+    }
+
+    void release(size_t size)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_nUsed -= size;
+        }
+        m_ReleaseCondition.notify_all();
+    }
+
+private:
+    const size_t m_nCapacity;
+    size_t m_nUsed = 0;
+    std::mutex m_Mutex;
+    std::condition_variable m_ReleaseCondition;
+};
+
+// Each worker maps a file, decodes it, flips it and generates its mipmaps, so that I/O, decoding and filtering of different images overlap
+void readTextureMipmaps(const std::vector<fs::path> & paths, const std::function<void (size_t, std::vector<Image2DRGBA> &&)> & onLevels)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    MemoryBudget budget(TextureDecodingMemoryBudget);
+    std::atomic<size_t> cachedCount{ 0 };
+
+    parallelFor(paths.size(), [&](size_t i)
+    {
+        auto cachePath = paths[i];
+        cachePath += ".glmlvcache.raw";
+        if (fs::exists(cachePath) && fs::last_write_time(cachePath) >= fs::last_write_time(paths[i]))
+        {
+            std::vector<Image2DRGBA> levels;
+            try {
+                levels = mapRawImage<unsigned char>(cachePath);
+            }
+            catch (const std::runtime_error &) {
+                // Invalid cache, rebuilt below
+            }
+            // Caches without their mipmap chain are rebuilt too
+            if (!levels.empty() && levels.size() == computeMipLevelCount(levels.front().width(), levels.front().height()))
+            {
+                ++cachedCount;
+                onLevels(i, std::move(levels));
+                return;
+            }
+        }
+
+        std::clog << ("Loading image " + paths[i].string() + "\n");
+
+        const MappedFile file(paths[i]);
+        int width = 0, height = 0, componentCount = 0;
+        stbi_info_from_memory(file.data(), int(file.size()), &width, &height, &componentCount);
+
+        const auto size = file.size() + size_t(width) * size_t(height) * Image2DRGBA::NumComponents;
+        budget.acquire(size);
+        Image2DRGBA image;
+        try {
+            image = readImage(file.data(), file.size(), true);
+        }
+        catch (...) {
+            budget.release(size);
+            throw;
+        }
+        budget.release(size);
+
+        // Images are filtered in parallel, each of them on a single thread
+        auto mipmaps = generateMipmaps(image, true, 1);
+
+        // Write to a temporary file first so that a concurrent reader never sees a partial cache
+        auto tmpPath = cachePath;
+        tmpPath += ".tmp";
+        try {
+            writeRawImage(image, mipmaps, tmpPath);
+            fs::rename(tmpPath, cachePath);
+        }
+        catch (const std::exception & e) {
+            std::cerr << "Unable to write texture cache " << cachePath << ": " << e.what() << std::endl;
+        }
+
+        std::vector<Image2DRGBA> levels;
+        levels.reserve(1 + mipmaps.size());
+        levels.emplace_back(std::move(image));
+        for (auto & mipmap : mipmaps) {
+            levels.emplace_back(std::move(mipmap));
+        }
+        onLevels(i, std::move(levels));
+    });
+
+    std::clog << "Loaded " << paths.size() << " images (" << cachedCount << " from cache) in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+        << " ms using " << defaultThreadCount() << " threads" << std::endl;
+}
+
+void readCompressedTextures(const std::vector<fs::path> & paths, const std::function<void (size_t, CompressedImage2D &&)> & onTexture)
 {
+    const auto startTime = std::chrono::steady_clock::now();
+
+    MemoryBudget budget(TextureDecodingMemoryBudget);
+    std::atomic<size_t> cachedCount{ 0 };
+    // Images are compressed in parallel, each of them only gets the threads left
+    const auto compressionThreadCount = std::max(size_t(1), defaultThreadCount() / std::max(size_t(1), paths.size()));
+
+    parallelFor(paths.size(), [&](size_t i)
+    {
+        auto cachePath = paths[i];
+        cachePath += ".glmlvcache.dds";
+        if (fs::exists(cachePath) && fs::last_write_time(cachePath) >= fs::last_write_time(paths[i]))
+        {
+            CompressedImage2D texture;
+            try {
+                texture = readDDS(cachePath);
+            }
+            catch (const std::runtime_error &) {
+                // Invalid cache, rebuilt below
+            }
+            // Caches without the full mip chain are rebuilt
+            if (!texture.data.empty() && texture.levelCount == computeMipLevelCount(texture.width, texture.height))
+            {
+                ++cachedCount;
+                onTexture(i, std::move(texture));
+                return;
+            }
+        }
+
+        std::clog << ("Compressing image " + paths[i].string() + "\n");
+
+        const MappedFile file(paths[i]);
+        int width = 0, height = 0, componentCount = 0;
+        stbi_info_from_memory(file.data(), int(file.size()), &width, &height, &componentCount);
+
+        const auto size = file.size() + size_t(width) * size_t(height) * Image2DRGBA::NumComponents;
+        budget.acquire(size);
+        CompressedImage2D texture;
+        try {
+            const auto image = readImage(file.data(), file.size(), true);
+            texture = compressImageWithMipmaps(image, chooseBlockFormat(image), true, compressionThreadCount);
+        }
+        catch (...) {
+            budget.release(size);
+            throw;
+        }
+        budget.release(size);
+
+        // Write to a temporary file first so that a concurrent reader never sees a partial cache
+        auto tmpPath = cachePath;
+        tmpPath += ".tmp";
+        try {
+            writeDDS(texture, tmpPath);
+            fs::rename(tmpPath, cachePath);
+        }
+        catch (const std::exception & e) {
+            std::cerr << "Unable to write texture cache " << cachePath << ": " << e.what() << std::endl;
+        }
+
+        onTexture(i, std::move(texture));
+    });
+
+    std::clog << "Loaded " << paths.size() << " compressed images (" << cachedCount << " from cache) in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+        << " ms using " << defaultThreadCount() << " threads" << std::endl;
+}
+
+void readTextures(const std::vector<fs::path> & paths, const std::function<void (size_t, Image2DRGBA &&)> & onImage)
+{
+    readTextureMipmaps(paths, [&](size_t i, std::vector<Image2DRGBA> && levels)
+    {
+        onImage(i, std::move(levels.front()));
+    });
+}
+
+static std::vector<Image2DRGBA> readTextures(const std::vector<fs::path> & paths)
+{
+    std::vector<Image2DRGBA> images(paths.size());
+    readTextures(paths, [&](size_t i, Image2DRGBA && image)
+    {
+        images[i] = std::move(image);
+    });
+    return images;
+}
+
+// Faces, attributes and commands of a line-aligned range of an obj file, parsed independently of the other ranges
+struct ObjChunk
+{
+    // Face using relative (negative) indices, parsed again once the number of attributes preceding the chunk is known
+    struct RelativeFace
+    {
+        size_t firstVertex;
+        int vertexCount, normalCount, texCoordCount; // Attribute counts of the chunk when the face was parsed
+        std::string line;
+    };
+
+    // Line changing the state of the parser (usemtl, mtllib, g, o), replayed after the faces preceding it
+    struct Command
+    {
+        size_t faceIndex;
+        std::string line;
+    };
+
+    std::vector<float> v;
+    std::vector<float> vn;
+    std::vector<float> vt;
+    std::vector<tinyobj::index_t> faceVertices;
+    std::vector<uint32_t> faceVertexCounts;
+    std::vector<RelativeFace> relativeFaces;
+    std::vector<Command> commands;
+};
+
+// Parse the vertices of a face line with the same rules as tinyobj::LoadObj, appending them to indices
+static void parseObjFace(const char * token, int vertexCount, int normalCount, int texCoordCount, tinyobj::index_t * pIndices)
+{
+    while (!IS_NEW_LINE(token[0])) {
+        const auto vi = tinyobj::parseTriple(&token, vertexCount, normalCount, texCoordCount);
+        *pIndices++ = tinyobj::index_t{ vi.v_idx, vi.vn_idx, vi.vt_idx };
+        token += strspn(token, " \t\r");
+    }
+}
+
+// Line splitting and parsing follow tinyobj::LoadObj so that the result is exactly the same
+static void parseObjChunk(const char * pBegin, const char * pEnd, ObjChunk & chunk)
+{
+    std::string linebuf;
+    const char * lineStart = pBegin;
+    while (lineStart < pEnd)
+    {
+        const char * lineEnd = lineStart;
+        while (lineEnd < pEnd && *lineEnd != '\n' && *lineEnd != '\r') {
+            ++lineEnd;
+        }
+        linebuf.assign(lineStart, lineEnd);
+
+        lineStart = lineEnd;
+        if (lineStart < pEnd) {
+            lineStart += (lineStart[0] == '\r' && lineStart + 1 < pEnd && lineStart[1] == '\n') ? 2 : 1;
+        }
+
+        const char * token = linebuf.c_str();
+        token += strspn(token, " \t");
+
+        if (token[0] == '\0' || token[0] == '#') {
+            continue;
+        }
+
+        if (token[0] == 'v' && IS_SPACE(token[1])) {
+            token += 2;
+            float x, y, z;
+            tinyobj::parseFloat3(&x, &y, &z, &token);
+            chunk.v.push_back(x);
+            chunk.v.push_back(y);
+            chunk.v.push_back(z);
+            continue;
+        }
+
+        if (token[0] == 'v' && token[1] == 'n' && IS_SPACE(token[2])) {
+            token += 3;
+            float x, y, z;
+            tinyobj::parseFloat3(&x, &y, &z, &token);
+            chunk.vn.push_back(x);
+            chunk.vn.push_back(y);
+            chunk.vn.push_back(z);
+            continue;
+        }
+
+        if (token[0] == 'v' && token[1] == 't' && IS_SPACE(token[2])) {
+            token += 3;
+            float x, y;
+            tinyobj::parseFloat2(&x, &y, &token);
+            chunk.vt.push_back(x);
+            chunk.vt.push_back(y);
+            continue;
+        }
+
+        if (token[0] == 'f' && IS_SPACE(token[1])) {
+            token += 2;
+            token += strspn(token, " \t");
+
+            const int vertexCount = int(chunk.v.size() / 3);
+            const int normalCount = int(chunk.vn.size() / 3);
+            const int texCoordCount = int(chunk.vt.size() / 2);
+
+            const auto firstVertex = chunk.faceVertices.size();
+            const char * faceToken = token;
+            while (!IS_NEW_LINE(faceToken[0])) {
+                const auto vi = tinyobj::parseTriple(&faceToken, vertexCount, normalCount, texCoordCount);
+                chunk.faceVertices.push_back(tinyobj::index_t{ vi.v_idx, vi.vn_idx, vi.vt_idx });
+                faceToken += strspn(faceToken, " \t\r");
+            }
+            chunk.faceVertexCounts.emplace_back(uint32_t(chunk.faceVertices.size() - firstVertex));
+
+            if (strchr(token, '-')) {
+                chunk.relativeFaces.push_back({ firstVertex, vertexCount, normalCount, texCoordCount, token });
+            }
+            continue;
+        }
+
+        if ((0 == strncmp(token, "usemtl", 6) && IS_SPACE(token[6])) || (0 == strncmp(token, "mtllib", 6) && IS_SPACE(token[6])) ||
+            (token[0] == 'g' && IS_SPACE(token[1])) || (token[0] == 'o' && IS_SPACE(token[1]))) {
+            chunk.commands.push_back({ chunk.faceVertexCounts.size(), token });
+        }
+
+        // Other commands (such as tags) do not contribute to ObjData and are ignored
+    }
+}
+
+// Parse an obj file with the same output as tinyobj::LoadObj (triangulated), but with the text split in chunks parsed in parallel.
+// Shape names and tags are not extracted since loadObj does not use them. The material files that have been looked for, found or not,
+// are added to mtlPaths.
+static bool parseObj(const fs::path & objPath, const fs::path & mtlBaseDir, tinyobj::attrib_t & attribs, std::vector<tinyobj::shape_t> & shapes,
+    std::vector<tinyobj::material_t> & materials, std::string & err, std::vector<fs::path> & mtlPaths)
+{
+    if (!fs::exists(objPath)) {
+        err = "Cannot open file [" + objPath.string() + "]\n";
+        return false;
+    }
+
+    const MappedFile file(objPath);
+    const auto pBegin = (const char *) file.data();
+    const auto pEnd = pBegin + file.size();
+
+    // Split the file after line feeds, in more chunks than threads to balance the work
+    const size_t minChunkSize = 1 << 20;
+    const auto chunkCount = std::max(size_t(1), std::min(4 * defaultThreadCount(), file.size() / minChunkSize));
+    std::vector<const char *> chunkBounds{ pBegin };
+    for (size_t i = 1; i < chunkCount; ++i)
+    {
+        auto pBound = std::max(pBegin + i * file.size() / chunkCount, chunkBounds.back());
+        pBound = std::find(pBound, pEnd, '\n');
+        chunkBounds.emplace_back(pBound == pEnd ? pEnd : pBound + 1);
+    }
+    chunkBounds.emplace_back(pEnd);
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    parallelFor(chunkCount, [&](size_t i)
+    {
+        parseObjChunk(chunkBounds[i], chunkBounds[i + 1], chunks[i]);
+    });
+
+    // Offsets of attributes of each chunk in the merged attribute arrays
+    std::vector<size_t> vOffsets(chunkCount + 1, 0), vnOffsets(chunkCount + 1, 0), vtOffsets(chunkCount + 1, 0);
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        vOffsets[i + 1] = vOffsets[i] + chunks[i].v.size();
+        vnOffsets[i + 1] = vnOffsets[i] + chunks[i].vn.size();
+        vtOffsets[i + 1] = vtOffsets[i] + chunks[i].vt.size();
+    }
+    attribs.vertices.resize(vOffsets.back());
+    attribs.normals.resize(vnOffsets.back());
+    attribs.texcoords.resize(vtOffsets.back());
+
+    parallelFor(chunkCount, [&](size_t i)
+    {
+        auto & chunk = chunks[i];
+        std::copy(begin(chunk.v), end(chunk.v), begin(attribs.vertices) + vOffsets[i]);
+        std::copy(begin(chunk.vn), end(chunk.vn), begin(attribs.normals) + vnOffsets[i]);
+        std::copy(begin(chunk.vt), end(chunk.vt), begin(attribs.texcoords) + vtOffsets[i]);
+
+        for (const auto & face : chunk.relativeFaces) {
+            parseObjFace(face.line.c_str(), int(vOffsets[i] / 3) + face.vertexCount, int(vnOffsets[i] / 3) + face.normalCount,
+                int(vtOffsets[i] / 2) + face.texCoordCount, chunk.faceVertices.data() + face.firstVertex);
+        }
+    });
+
+    // Replay commands in file order to build shapes, as tinyobj::LoadObj does
+    struct FaceRange
+    {
+        const ObjChunk * pChunk;
+        size_t firstFace, lastFace, firstVertex;
+    };
+    std::vector<FaceRange> faceGroup;
+    std::map<std::string, int> materialMap;
+    int material = -1;
+    tinyobj::shape_t shape;
+    tinyobj::MaterialFileReader matFileReader(mtlBaseDir.string() + "/");
+
+    // Returns false if there is no face in the current group
+    const auto exportFaceGroupToShape = [&]()
+    {
+        if (faceGroup.empty()) {
+            return false;
+        }
+        for (const auto & range : faceGroup)
+        {
+            auto pFace = range.pChunk->faceVertices.data() + range.firstVertex;
+            for (auto f = range.firstFace; f < range.lastFace; ++f)
+            {
+                const auto count = range.pChunk->faceVertexCounts[f];
+                // Polygon -> triangle fan conversion
+                for (size_t k = 2; k < count; ++k)
+                {
+                    shape.mesh.indices.insert(end(shape.mesh.indices), { pFace[0], pFace[k - 1], pFace[k] });
+                    shape.mesh.num_face_vertices.push_back(3);
+                    shape.mesh.material_ids.push_back(material);
+                }
+                pFace += count;
+            }
+        }
+        return true;
+    };
+
+    for (const auto & chunk : chunks)
+    {
+        size_t currentFace = 0;
+        size_t currentVertex = 0;
+        const auto addFaces = [&](size_t lastFace)
+        {
+            if (lastFace > currentFace) {
+                faceGroup.push_back({ &chunk, currentFace, lastFace, currentVertex });
+            }
+            for (; currentFace < lastFace; ++currentFace) {
+                currentVertex += chunk.faceVertexCounts[currentFace];
+            }
+        };
+
+        for (const auto & command : chunk.commands)
+        {
+            addFaces(command.faceIndex);
+
+            const char * token = command.line.c_str();
+            if (token[0] == 'u') // usemtl
+            {
+                char namebuf[TINYOBJ_SSCANF_BUFFER_SIZE];
+                token += 7;
+#ifdef _MSC_VER
+                sscanf_s(token, "%s", namebuf, (unsigned)_countof(namebuf));
+#else
+                sscanf(token, "%s", namebuf);
+#endif
+                const auto it = materialMap.find(namebuf);
+                const int newMaterialId = it != end(materialMap) ? (*it).second : -1;
+                if (newMaterialId != material) {
+                    exportFaceGroupToShape();
+                    faceGroup.clear();
+                    material = newMaterialId;
+                }
+            }
+            else if (token[0] == 'm') // mtllib
+            {
+                token += 7;
+                std::vector<std::string> filenames;
+                tinyobj::SplitString(std::string(token), ' ', filenames);
+
+                bool found = false;
+                for (const auto & filename : filenames)
+                {
+                    mtlPaths.emplace_back(mtlBaseDir / filename);
+                    std::string errMtl;
+                    const bool ok = matFileReader(filename.c_str(), &materials, &materialMap, &errMtl);
+                    err += errMtl;
+                    if (ok) {
+                        found = true;
+                        break;
+                    }
+                }
+                if (filenames.empty()) {
+                    err += "WARN: Looks like empty filename for mtllib. Use default material. \n";
+                }
+                else if (!found) {
+                    err += "WARN: Failed to load material file(s). Use default material.\n";
+                }
+            }
+            else // g or o
+            {
+                if (exportFaceGroupToShape()) {
+                    shapes.push_back(shape);
+                }
+                shape = tinyobj::shape_t();
+                faceGroup.clear();
+            }
+        }
+
+        addFaces(chunk.faceVertexCounts.size());
+    }
+
+    if (exportFaceGroupToShape() || shape.mesh.indices.size()) {
+        shapes.push_back(shape);
+    }
+
+    return true;
+}
+
+// Load an obj model and return the material files it depends on (see parseObj). Attributes with different indices are duplicated since OpenGL
+// uses one index per vertex; parsing and welding are spread over all cores, and the result does not depend on the number of threads.
+static void loadObj(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & data, bool loadTextures, std::vector<fs::path> & mtlPaths)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
     // Load obj
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
     tinyobj::attrib_t attribs;
 
     std::string err;
-    bool ret = tinyobj::LoadObj(&attribs, &shapes, &materials, &err, objPath.string().c_str(), (mtlBaseDir.string() + "/").c_str());
+    bool ret = parseObj(objPath, mtlBaseDir, attribs, shapes, materials, err, mtlPaths);
 
     if (!err.empty()) { // `err` may contain warning message.
         std::cerr << err << std::endl;
@@ -56,43 +574,143 @@ void loadObj(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & da
         throw std::runtime_error(err);
     }
 
+    const auto parseEndTime = std::chrono::steady_clock::now();
+
     data.shapeCount += shapes.size();
     data.materialCount += materials.size();
 
-    std::unordered_map<tinyobj::index_t, uint32_t, TinyObjLoaderIndexHash, TinyObjLoaderEqualTo> indexMap;
+    // Weld vertices of each shape independently
+    struct ShapeVertices
+    {
+        std::vector<tinyobj::index_t> uniqueIndices; // In order of first appearance
+        std::vector<uint32_t> localIndices; // Index in uniqueIndices of each index of the mesh
+        std::vector<uint32_t> globalIndices; // Index in the vertex buffer of each element of uniqueIndices
+    };
+    std::vector<ShapeVertices> shapeVertices(shapes.size());
+
+    parallelFor(shapes.size(), [&](size_t shapeIdx)
+    {
+        const auto & mesh = shapes[shapeIdx].mesh;
+        auto & vertices = shapeVertices[shapeIdx];
+        // Closed triangle meshes have about one unique vertex for six indices: reserve for a quarter and let the map grow for less shared meshes
+        TinyObjLoaderIndexMap indexMap(EmptyTinyObjLoaderIndex, mesh.indices.size() / 4);
+        vertices.localIndices.reserve(mesh.indices.size());
+        for (const auto & idx : mesh.indices)
+        {
+            const auto it = indexMap.insert(idx, uint32_t(vertices.uniqueIndices.size()));
+            if (it.second) {
+                vertices.uniqueIndices.emplace_back(idx);
+            }
+            vertices.localIndices.emplace_back(*it.first);
+        }
+    });
 
-    std::unordered_set<std::string> texturePaths;
+    // Merge in shape order, so that vertices get the index of their first appearance in the whole model
+    size_t shapeVertexCount = 0;
+    for (const auto & vertices : shapeVertices) {
+        shapeVertexCount += vertices.uniqueIndices.size();
+    }
+    TinyObjLoaderIndexMap indexMap(EmptyTinyObjLoaderIndex, shapeVertexCount);
+    std::vector<tinyobj::index_t> newVertices;
+    const auto vertexOffset = data.vertexBuffer.size();
+    for (auto & vertices : shapeVertices)
+    {
+        vertices.globalIndices.reserve(vertices.uniqueIndices.size());
+        for (const auto & idx : vertices.uniqueIndices)
+        {
+            const auto it = indexMap.insert(idx, uint32_t(vertexOffset + newVertices.size()));
+            if (it.second) {
+                newVertices.emplace_back(idx);
+            }
+            vertices.globalIndices.emplace_back(*it.first);
+        }
+    }
+
+    // Put new vertices in the vertex buffer
+    data.vertexBuffer.resize(vertexOffset + newVertices.size());
+    const size_t vertexBlockSize = 1 << 14;
+    parallelFor((newVertices.size() + vertexBlockSize - 1) / vertexBlockSize, [&](size_t block)
+    {
+        const auto blockEnd = std::min(newVertices.size(), (block + 1) * vertexBlockSize);
+        for (auto i = block * vertexBlockSize; i < blockEnd; ++i)
+        {
+            const auto & idx = newVertices[i];
+            float vx = attribs.vertices[3 * idx.vertex_index + 0];
+            float vy = attribs.vertices[3 * idx.vertex_index + 1];
+            float vz = attribs.vertices[3 * idx.vertex_index + 2];
+            float nx = attribs.normals[3 * idx.normal_index + 0];
+            float ny = attribs.normals[3 * idx.normal_index + 1];
+            float nz = attribs.normals[3 * idx.normal_index + 2];
+            float tx = attribs.texcoords[2 * idx.texcoord_index + 0];
+            float ty = attribs.texcoords[2 * idx.texcoord_index + 1];
+
+            data.vertexBuffer[vertexOffset + i] = Vertex3f3f2f(glm::vec3(vx, vy, vz), glm::vec3(nx, ny, nz), glm::vec2(tx, ty));
+        }
+    });
+    for (auto i = vertexOffset; i < data.vertexBuffer.size(); ++i)
+    {
+        data.bboxMin = glm::min(data.bboxMin, data.vertexBuffer[i].position);
+        data.bboxMax = glm::max(data.bboxMax, data.vertexBuffer[i].position);
+    }
+
+    // Fill the index buffer and compute the bounding volumes of shapes
+    std::vector<size_t> indexOffsetPerShape(shapes.size());
+    auto indexOffset = data.indexBuffer.size();
+    for (size_t shapeIdx = 0; shapeIdx < shapes.size(); ++shapeIdx)
+    {
+        indexOffsetPerShape[shapeIdx] = indexOffset;
+        indexOffset += shapes[shapeIdx].mesh.indices.size();
+    }
+    data.indexBuffer.resize(indexOffset);
+    const auto shapeOffset = data.bboxMinPerShape.size();
+    data.bboxMinPerShape.resize(shapeOffset + shapes.size(), glm::vec3(std::numeric_limits<float>::max()));
+    data.bboxMaxPerShape.resize(shapeOffset + shapes.size(), glm::vec3(std::numeric_limits<float>::lowest()));
+    data.boundingSpherePerShape.resize(shapeOffset + shapes.size(), glm::vec4(0));
+    parallelFor(shapes.size(), [&](size_t shapeIdx)
+    {
+        const auto & vertices = shapeVertices[shapeIdx];
+        auto pIndex = data.indexBuffer.data() + indexOffsetPerShape[shapeIdx];
+        for (const auto localIndex : vertices.localIndices) {
+            *pIndex++ = vertices.globalIndices[localIndex];
+        }
+
+        if (vertices.globalIndices.empty()) {
+            return;
+        }
+        auto & bboxMin = data.bboxMinPerShape[shapeOffset + shapeIdx];
+        auto & bboxMax = data.bboxMaxPerShape[shapeOffset + shapeIdx];
+        for (const auto globalIndex : vertices.globalIndices)
+        {
+            bboxMin = glm::min(bboxMin, data.vertexBuffer[globalIndex].position);
+            bboxMax = glm::max(bboxMax, data.vertexBuffer[globalIndex].position);
+        }
+        // The sphere is centered on the box, which is tighter than the sphere circumscribing the box
+        const auto center = 0.5f * (bboxMin + bboxMax);
+        float squaredRadius = 0.f;
+        for (const auto globalIndex : vertices.globalIndices)
+        {
+            const auto v = data.vertexBuffer[globalIndex].position - center;
+            squaredRadius = std::max(squaredRadius, glm::dot(v, v));
+        }
+        data.boundingSpherePerShape[shapeOffset + shapeIdx] = glm::vec4(center, std::sqrt(squaredRadius));
+    });
+
+    const auto weldEndTime = std::chrono::steady_clock::now();
+
+    // Names of used textures, in order of first use
+    std::vector<std::string> textureNames;
+    std::unordered_set<std::string> textureNameSet;
+    const auto addTextureName = [&](const std::string & name)
+    {
+        if (!name.empty() && textureNameSet.emplace(name).second) {
+            textureNames.emplace_back(name);
+        }
+    };
 
     const auto materialIdOffset = data.materials.size();
     for (const auto & shape : shapes)
     {
         const auto & mesh = shape.mesh;
-        for (const auto & idx : mesh.indices)
-        {
-            const auto it = indexMap.find(idx);
-            if (it == end(indexMap))
-            {
-                // Put the vertex in the vertex buffer and record a new index if not found
-                float vx = attribs.vertices[3 * idx.vertex_index + 0];
-                float vy = attribs.vertices[3 * idx.vertex_index + 1];
-                float vz = attribs.vertices[3 * idx.vertex_index + 2];
-                float nx = attribs.normals[3 * idx.normal_index + 0];
-                float ny = attribs.normals[3 * idx.normal_index + 1];
-                float nz = attribs.normals[3 * idx.normal_index + 2];
-                float tx = attribs.texcoords[2 * idx.texcoord_index + 0];
-                float ty = attribs.texcoords[2 * idx.texcoord_index + 1];
-
-                uint32_t newIndex = data.vertexBuffer.size();
-                data.vertexBuffer.emplace_back(glm::vec3(vx, vy, vz), glm::vec3(nx, ny, nz), glm::vec2(tx, ty));
-                data.bboxMin = glm::min(data.bboxMin, data.vertexBuffer.back().position);
-                data.bboxMax = glm::max(data.bboxMax, data.vertexBuffer.back().position);
-
-                indexMap[idx] = newIndex;
-                data.indexBuffer.emplace_back(newIndex);
-            }
-            else
-                data.indexBuffer.emplace_back((*it).second);
-        }
         data.indexCountPerShape.emplace_back(mesh.indices.size());
 
         const int32_t localMaterialID = mesh.material_ids.empty() ? -1 : mesh.material_ids[0];
@@ -104,41 +722,61 @@ void loadObj(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & da
         if (localMaterialID >= 0)
         {
             const auto & material = materials[localMaterialID];
-            texturePaths.emplace(material.ambient_texname);
-            texturePaths.emplace(material.diffuse_texname);
-            texturePaths.emplace(material.specular_texname);
-            texturePaths.emplace(material.specular_highlight_texname);
+            addTextureName(material.ambient_texname);
+            addTextureName(material.diffuse_texname);
+            addTextureName(material.specular_texname);
+            addTextureName(material.specular_highlight_texname);
         }
     }
 
+    const auto toMilliseconds = [](std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    std::clog << "Loaded " << objPath << " in " << toMilliseconds(weldEndTime - startTime) << " ms (parse: " << toMilliseconds(parseEndTime - startTime)
+        << " ms, weld: " << toMilliseconds(weldEndTime - parseEndTime) << " ms) using " << defaultThreadCount() << " threads" << std::endl;
+
     std::unordered_map<std::string, int32_t> textureIdMap;
 
-    if (loadTextures)
+    // Files are identified by their path, so that an image referenced under several names (or already loaded in data) is decoded once
+    std::unordered_map<std::string, int32_t> pathIdMap;
+    for (size_t i = 0; i < data.texturePaths.size(); ++i) {
+        pathIdMap.emplace(data.texturePaths[i].string(), int32_t(i));
+    }
+
+    std::vector<fs::path> newTexturePaths;
+    for (const auto & textureName : textureNames)
     {
-        const auto textureIdOffset = data.textures.size();
-        for (const auto & texturePath : texturePaths)
+        auto newTexturePath = textureName;
+        std::replace(begin(newTexturePath), end(newTexturePath), '\\', '/');
+        const auto completePath = mtlBaseDir / newTexturePath;
+        if (fs::exists(completePath))
         {
-            if (!texturePath.empty())
-            {
-                auto newTexturePath = texturePath;
-                std::replace(begin(newTexturePath), end(newTexturePath), '\\', '/');
-                const auto completePath = mtlBaseDir / newTexturePath;
-                if (fs::exists(completePath))
-                {
-                    std::clog << "Loading image " << completePath << std::endl;
-                    data.textures.emplace_back(readImage(completePath));
-                    data.textures.back().flipY();
-
-                    const auto localTexId = textureIdMap.size();
-                    textureIdMap[texturePath] = textureIdOffset + localTexId;
-                }
-                else
-                {
-                    std::clog << "'Warning: image " << completePath << " not found" << std::endl;
-                }
+            const auto it = pathIdMap.emplace(completePath.string(), int32_t(data.texturePaths.size() + newTexturePaths.size()));
+            if (it.second) {
+                newTexturePaths.emplace_back(completePath);
             }
+            textureIdMap[textureName] = (*it.first).second;
+        }
+        else
+        {
+            std::clog << "'Warning: image " << completePath << " not found" << std::endl;
+        }
+    }
+
+    // Texture ids index both vectors, so images cannot be loaded for a part of the textures only
+    if (!data.texturePaths.empty() && !newTexturePaths.empty() && data.textures.empty() == loadTextures)
+    {
+        std::cerr << "Unable to load obj " << objPath << ": textures are loaded for a part of the objects only" << std::endl;
+        throw std::runtime_error("Unable to load obj " + objPath.string() + ": textures are loaded for a part of the objects only");
+    }
+    if (loadTextures)
+    {
+        for (auto & image : readTextures(newTexturePaths)) {
+            data.textures.emplace_back(std::move(image));
         }
     }
+    data.texturePaths.insert(end(data.texturePaths), begin(newTexturePaths), end(newTexturePaths));
 
     for (const auto & material : materials)
     {
@@ -169,4 +807,367 @@ void loadObj(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & da
     }
 }
 
+void loadObj(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & data, bool loadTextures)
+{
+    std::vector<fs::path> mtlPaths;
+    loadObj(objPath, mtlBaseDir, data, loadTextures, mtlPaths);
+}
+
+static const char ObjCacheMagic[8] = { 'G', 'L', 'M', 'L', 'V', 'O', 'B', 'J' };
+static const uint32_t ObjCacheVersion = 5;
+
+// Size and modification time of a file, to detect its changes
+struct ObjCacheFileStamp
+{
+    uint64_t fileSize = std::numeric_limits<uint64_t>::max(); // The maximum for a missing file
+    int64_t lastWriteTime = 0;
+
+    bool operator ==(const ObjCacheFileStamp & rhs) const
+    {
+        return fileSize == rhs.fileSize && lastWriteTime == rhs.lastWriteTime;
+    }
+};
+
+static ObjCacheFileStamp getObjCacheFileStamp(const fs::path & path)
+{
+    ObjCacheFileStamp stamp;
+    if (!fs::exists(path)) {
+        return stamp;
+    }
+    stamp.fileSize = fs::file_size(path);
+#ifdef GLMLV_USE_BOOST_FILESYSTEM
+    stamp.lastWriteTime = int64_t(fs::last_write_time(path));
+#else
+    stamp.lastWriteTime = int64_t(fs::last_write_time(path).time_since_epoch().count());
+#endif
+    return stamp;
+}
+
+// Identify the obj file from which a cache has been built. The material files it references are only known once it is parsed, so they are
+// stored with the cache and checked against their current stamps when it is read.
+struct ObjCacheKey
+{
+    std::string objPath;
+    std::string mtlBaseDir;
+    ObjCacheFileStamp objStamp;
+    uint8_t optimized = 0; // The buffers have been processed by optimizeMesh
+
+    bool operator ==(const ObjCacheKey & rhs) const
+    {
+        return objPath == rhs.objPath && mtlBaseDir == rhs.mtlBaseDir && objStamp == rhs.objStamp && optimized == rhs.optimized;
+    }
+};
+
+static ObjCacheKey makeObjCacheKey(const fs::path & objPath, const fs::path & mtlBaseDir, bool optimized)
+{
+    ObjCacheKey key;
+    key.optimized = optimized;
+    key.objPath = fs::absolute(objPath).string();
+    key.mtlBaseDir = fs::absolute(mtlBaseDir).string();
+    key.objStamp = getObjCacheFileStamp(objPath);
+    return key;
+}
+
+class ObjCacheWriter
+{
+public:
+    template<typename T>
+    void write(const T & value)
+    {
+        write(&value, 1);
+    }
+
+    template<typename T>
+    void write(const T * values, size_t count)
+    {
+        const auto ptr = (const char *) values;
+        m_Buffer.insert(end(m_Buffer), ptr, ptr + count * sizeof(T));
+    }
+
+    template<typename T>
+    void writeVector(const std::vector<T> & values)
+    {
+        write(uint64_t(values.size()));
+        write(values.data(), values.size());
+    }
+
+    void writeString(const std::string & str)
+    {
+        write(uint64_t(str.size()));
+        write(str.data(), str.size());
+    }
+
+    const std::vector<char> & buffer() const
+    {
+        return m_Buffer;
+    }
+
+private:
+    std::vector<char> m_Buffer;
+};
+
+// Read values from a memory range; every function returns false instead of reading past the end
+class ObjCacheReader
+{
+public:
+    ObjCacheReader(const unsigned char * data, size_t size):
+        m_pCurrent(data), m_pEnd(data + size)
+    {
+    }
+
+    template<typename T>
+    bool read(T & value)
+    {
+        return read(&value, 1);
+    }
+
+    template<typename T>
+    bool read(T * values, size_t count)
+    {
+        if (count > size_t(m_pEnd - m_pCurrent) / sizeof(T)) {
+            return false;
+        }
+        std::memcpy(values, m_pCurrent, count * sizeof(T));
+        m_pCurrent += count * sizeof(T);
+        return true;
+    }
+
+    template<typename T>
+    bool readVector(std::vector<T> & values)
+    {
+        uint64_t count;
+        if (!read(count) || count > size_t(m_pEnd - m_pCurrent) / sizeof(T)) {
+            return false;
+        }
+        values.resize(count);
+        return read(values.data(), values.size());
+    }
+
+    bool readString(std::string & str)
+    {
+        uint64_t count;
+        if (!read(count) || count > size_t(m_pEnd - m_pCurrent)) {
+            return false;
+        }
+        str.assign((const char *) m_pCurrent, count);
+        m_pCurrent += count;
+        return true;
+    }
+
+private:
+    const unsigned char * m_pCurrent;
+    const unsigned char * m_pEnd;
+};
+
+static void writeObjCache(const fs::path & cachePath, const ObjCacheKey & key, const std::vector<fs::path> & mtlPaths, const ObjData & data)
+{
+    ObjCacheWriter writer;
+    writer.write(ObjCacheMagic, sizeof(ObjCacheMagic));
+    writer.write(ObjCacheVersion);
+
+    writer.writeString(key.objPath);
+    writer.writeString(key.mtlBaseDir);
+    writer.write(key.objStamp.fileSize);
+    writer.write(key.objStamp.lastWriteTime);
+    writer.write(key.optimized);
+
+    writer.write(uint64_t(mtlPaths.size()));
+    for (const auto & mtlPath : mtlPaths)
+    {
+        const auto stamp = getObjCacheFileStamp(mtlPath);
+        writer.writeString(fs::absolute(mtlPath).string());
+        writer.write(stamp.fileSize);
+        writer.write(stamp.lastWriteTime);
+    }
+
+    writer.write(uint64_t(data.shapeCount));
+    writer.write(uint64_t(data.materialCount));
+    writer.write(data.bboxMin);
+    writer.write(data.bboxMax);
+    writer.writeVector(data.vertexBuffer);
+    writer.writeVector(data.indexBuffer);
+    writer.writeVector(data.indexCountPerShape);
+    writer.writeVector(data.materialIDPerShape);
+    writer.writeVector(data.bboxMinPerShape);
+    writer.writeVector(data.bboxMaxPerShape);
+    writer.writeVector(data.boundingSpherePerShape);
+    writer.writeVector(data.materials);
+
+    writer.write(uint64_t(data.texturePaths.size()));
+    for (const auto & texturePath : data.texturePaths) {
+        writer.writeString(texturePath.string());
+    }
+
+    // Write to a temporary file first so that a concurrent reader never sees a partial cache
+    auto tmpPath = cachePath;
+    tmpPath += ".tmp";
+    {
+        std::ofstream output(tmpPath.string(), std::ios::binary | std::ios::trunc);
+        if (!output || !output.write(writer.buffer().data(), writer.buffer().size())) {
+            throw std::runtime_error("Unable to write obj cache " + tmpPath.string());
+        }
+    }
+    fs::rename(tmpPath, cachePath);
+}
+
+// Returns false if the cache is missing, corrupted or stale (the obj file or one of its material files changed)
+static bool readObjCache(const fs::path & cachePath, const ObjCacheKey & key, ObjData & data)
+{
+    if (!fs::exists(cachePath)) {
+        return false;
+    }
+
+    MappedFile file(cachePath);
+    ObjCacheReader reader(file.data(), file.size());
+
+    char magic[sizeof(ObjCacheMagic)];
+    uint32_t version;
+    if (!reader.read(magic, sizeof(magic)) || std::memcmp(magic, ObjCacheMagic, sizeof(magic)) || !reader.read(version) || version != ObjCacheVersion) {
+        return false;
+    }
+
+    ObjCacheKey cacheKey;
+    if (!reader.readString(cacheKey.objPath) || !reader.readString(cacheKey.mtlBaseDir) || !reader.read(cacheKey.objStamp.fileSize) ||
+        !reader.read(cacheKey.objStamp.lastWriteTime) || !reader.read(cacheKey.optimized) || !(cacheKey == key)) {
+        return false;
+    }
+
+    uint64_t mtlCount;
+    if (!reader.read(mtlCount)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < mtlCount; ++i)
+    {
+        std::string mtlPath;
+        ObjCacheFileStamp stamp;
+        if (!reader.readString(mtlPath) || !reader.read(stamp.fileSize) || !reader.read(stamp.lastWriteTime) || !(stamp == getObjCacheFileStamp(mtlPath))) {
+            return false;
+        }
+    }
+
+    uint64_t shapeCount, materialCount, textureCount;
+    if (!reader.read(shapeCount) || !reader.read(materialCount) || !reader.read(data.bboxMin) || !reader.read(data.bboxMax) ||
+        !reader.readVector(data.vertexBuffer) || !reader.readVector(data.indexBuffer) || !reader.readVector(data.indexCountPerShape) ||
+        !reader.readVector(data.materialIDPerShape) || !reader.readVector(data.bboxMinPerShape) || !reader.readVector(data.bboxMaxPerShape) ||
+        !reader.readVector(data.boundingSpherePerShape) || !reader.readVector(data.materials) || !reader.read(textureCount)) {
+        return false;
+    }
+    data.shapeCount = shapeCount;
+    data.materialCount = materialCount;
+
+    for (uint64_t i = 0; i < textureCount; ++i)
+    {
+        std::string texturePath;
+        if (!reader.readString(texturePath) || !fs::exists(texturePath)) {
+            return false;
+        }
+        data.texturePaths.emplace_back(texturePath);
+    }
+
+    return true;
+}
+
+// Append the content of src at the end of dst, offsetting indices of vertices, materials and textures
+static void appendObjData(ObjData & dst, ObjData && src)
+{
+    if (dst.vertexBuffer.empty() && dst.indexBuffer.empty() && dst.materials.empty() && dst.textures.empty() && dst.texturePaths.empty()) {
+        const auto shapeCount = dst.shapeCount + src.shapeCount;
+        const auto materialCount = dst.materialCount + src.materialCount;
+        dst = std::move(src);
+        dst.shapeCount = shapeCount;
+        dst.materialCount = materialCount;
+        return;
+    }
+
+    // Texture ids index both vectors, so images cannot be loaded for a part of the textures only
+    if (!dst.texturePaths.empty() && !src.texturePaths.empty() && dst.textures.empty() != src.textures.empty())
+    {
+        std::cerr << "Unable to append obj data: textures are loaded for a part of the objects only" << std::endl;
+        throw std::runtime_error("Unable to append obj data: textures are loaded for a part of the objects only");
+    }
+
+    const auto vertexOffset = uint32_t(dst.vertexBuffer.size());
+    const auto materialIdOffset = int32_t(dst.materials.size());
+    const auto textureIdOffset = int32_t(dst.texturePaths.size());
+
+    dst.shapeCount += src.shapeCount;
+    dst.materialCount += src.materialCount;
+    dst.bboxMin = glm::min(dst.bboxMin, src.bboxMin);
+    dst.bboxMax = glm::max(dst.bboxMax, src.bboxMax);
+
+    dst.vertexBuffer.insert(end(dst.vertexBuffer), begin(src.vertexBuffer), end(src.vertexBuffer));
+    for (const auto index : src.indexBuffer) {
+        dst.indexBuffer.emplace_back(vertexOffset + index);
+    }
+    dst.indexCountPerShape.insert(end(dst.indexCountPerShape), begin(src.indexCountPerShape), end(src.indexCountPerShape));
+    for (const auto materialID : src.materialIDPerShape) {
+        dst.materialIDPerShape.emplace_back(materialID >= 0 ? materialIdOffset + materialID : -1);
+    }
+    dst.bboxMinPerShape.insert(end(dst.bboxMinPerShape), begin(src.bboxMinPerShape), end(src.bboxMinPerShape));
+    dst.bboxMaxPerShape.insert(end(dst.bboxMaxPerShape), begin(src.bboxMaxPerShape), end(src.bboxMaxPerShape));
+    dst.boundingSpherePerShape.insert(end(dst.boundingSpherePerShape), begin(src.boundingSpherePerShape), end(src.boundingSpherePerShape));
+
+    const auto offsetTextureId = [&](int32_t & textureId)
+    {
+        if (textureId >= 0) {
+            textureId += textureIdOffset;
+        }
+    };
+    for (auto material : src.materials)
+    {
+        offsetTextureId(material.KaTextureId);
+        offsetTextureId(material.KdTextureId);
+        offsetTextureId(material.KsTextureId);
+        offsetTextureId(material.shininessTextureId);
+        dst.materials.emplace_back(material);
+    }
+
+    for (auto & texture : src.textures) {
+        dst.textures.emplace_back(std::move(texture));
+    }
+    dst.texturePaths.insert(end(dst.texturePaths), begin(src.texturePaths), end(src.texturePaths));
+}
+
+void loadObjCached(const fs::path & objPath, const fs::path & mtlBaseDir, ObjData & data, bool loadTextures, bool optimizeMeshes)
+{
+    auto cachePath = objPath;
+    cachePath += optimizeMeshes ? ".optimized.glmlvcache" : ".glmlvcache";
+
+    const auto key = makeObjCacheKey(objPath, mtlBaseDir, optimizeMeshes);
+
+    ObjData localData;
+    bool cacheHit = false;
+    try {
+        cacheHit = readObjCache(cachePath, key, localData);
+    }
+    catch (const std::exception & e) {
+        std::cerr << "Unable to read obj cache " << cachePath << ": " << e.what() << std::endl;
+    }
+
+    if (cacheHit)
+    {
+        std::clog << "Loading obj cache " << cachePath << std::endl;
+        if (loadTextures) {
+            localData.textures = readTextures(localData.texturePaths);
+        }
+    }
+    else
+    {
+        localData = ObjData();
+        std::vector<fs::path> mtlPaths;
+        loadObj(objPath, mtlBaseDir, localData, loadTextures, mtlPaths);
+        if (optimizeMeshes) {
+            optimizeMesh(localData);
+        }
+        try {
+            writeObjCache(cachePath, key, mtlPaths, localData);
+        }
+        catch (const std::exception & e) {
+            std::cerr << "Unable to write obj cache " << cachePath << ": " << e.what() << std::endl;
+        }
+    }
+
+    appendObjData(data, std::move(localData));
+}
+
 }
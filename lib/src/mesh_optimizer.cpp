@@ -0,0 +1,807 @@
+#include <glmlv/mesh_optimizer.hpp>
+#include <glmlv/parallel.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+namespace glmlv
+{
+
+static const uint32_t InvalidIndex = ~uint32_t(0);
+
+// Map the vertices referenced by an index range to [0, localVertexCount) in order of first use, so that per vertex data can be stored densely.
+// The remap table spans [minIndex, maxIndex]. Shapes of a welded ObjData share a single vertex buffer and can reference vertices anywhere in it,
+// so the table can be as large as the vertex buffer; it is a temporary array of 4 bytes per vertex, filled once per call.
+static size_t makeLocalIndices(const uint32_t * indices, size_t indexCount, std::vector<uint32_t> & localIndices, std::vector<uint32_t> & localToGlobal)
+{
+    const auto range = std::minmax_element(indices, indices + indexCount);
+    const auto minIndex = *range.first;
+    std::vector<uint32_t> globalToLocal(*range.second - minIndex + 1, InvalidIndex);
+
+    localToGlobal.clear();
+    localIndices.resize(indexCount);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        auto & localIndex = globalToLocal[indices[i] - minIndex];
+        if (localIndex == InvalidIndex)
+        {
+            localIndex = uint32_t(localToGlobal.size());
+            localToGlobal.emplace_back(indices[i]);
+        }
+        localIndices[i] = localIndex;
+    }
+    return localToGlobal.size();
+}
+
+// FIFO cache simulation on local indices; returns the number of misses of each triangle
+class FifoCache
+{
+public:
+    FifoCache(size_t vertexCount, size_t cacheSize):
+        m_Timestamps(vertexCount, 0), m_nCacheSize(uint32_t(cacheSize))
+    {
+    }
+
+    uint32_t processTriangle(const uint32_t * triangle)
+    {
+        uint32_t misses = 0;
+        for (size_t k = 0; k < 3; ++k)
+        {
+            // A vertex is in the cache if it has been pushed less than cacheSize pushes ago
+            if (m_nTime - m_Timestamps[triangle[k]] >= m_nCacheSize || !m_Timestamps[triangle[k]])
+            {
+                m_Timestamps[triangle[k]] = ++m_nTime;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void reset()
+    {
+        m_nTime += m_nCacheSize + 1;
+    }
+
+private:
+    std::vector<uint32_t> m_Timestamps;
+    uint32_t m_nTime = 0;
+    uint32_t m_nCacheSize;
+};
+
+VertexCacheStatistics analyzeVertexCache(const uint32_t * indices, size_t indexCount, size_t cacheSize)
+{
+    VertexCacheStatistics stats;
+    if (!indexCount) {
+        return stats;
+    }
+
+    std::vector<uint32_t> localIndices, localToGlobal;
+    const auto vertexCount = makeLocalIndices(indices, indexCount, localIndices, localToGlobal);
+
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        stats.transformedVertexCount += cache.processTriangle(localIndices.data() + i);
+    }
+
+    stats.triangleCount = indexCount / 3;
+    stats.vertexCount = vertexCount;
+    stats.acmr = float(stats.transformedVertexCount) / stats.triangleCount;
+    stats.atvr = float(stats.transformedVertexCount) / stats.vertexCount;
+    return stats;
+}
+
+static const size_t ForsythCacheSize = 32;
+static const size_t ForsythMaxValence = 32;
+
+// Scores of the Forsyth algorithm, tabulated since they are evaluated several times per emitted triangle
+struct ForsythScoreTables
+{
+    float cacheScores[ForsythCacheSize + 1]; // Indexed by position in the LRU cache, the last entry is for vertices out of the cache
+    float valenceScores[ForsythMaxValence + 1]; // Indexed by number of remaining triangles
+
+    ForsythScoreTables()
+    {
+        static const float CacheDecayPower = 1.5f;
+        static const float LastTriangleScore = 0.75f;
+        static const float ValenceBoostScale = 2.f;
+        static const float ValenceBoostPower = 0.5f;
+
+        for (size_t i = 0; i < ForsythCacheSize; ++i)
+        {
+            // The vertices of the last triangle are penalized so that strips are not always preferred
+            cacheScores[i] = i < 3 ? LastTriangleScore : std::pow(1.f - float(i - 3) / (ForsythCacheSize - 3), CacheDecayPower);
+        }
+        cacheScores[ForsythCacheSize] = 0.f;
+
+        valenceScores[0] = 0.f;
+        for (size_t i = 1; i <= ForsythMaxValence; ++i) {
+            valenceScores[i] = ValenceBoostScale * std::pow(float(i), -ValenceBoostPower);
+        }
+    }
+
+    // Score of a vertex from its position in the LRU cache (-1 if not in the cache) and its number of remaining triangles
+    float vertexScore(int cachePosition, uint32_t remainingTriangles) const
+    {
+        if (!remainingTriangles) {
+            return -1.f;
+        }
+        return cacheScores[cachePosition < 0 ? ForsythCacheSize : size_t(cachePosition)] + valenceScores[std::min<size_t>(remainingTriangles, ForsythMaxValence)];
+    }
+};
+
+void optimizeVertexCache(uint32_t * destination, const uint32_t * indices, size_t indexCount)
+{
+    static const ForsythScoreTables scoreTables;
+
+    const auto triangleCount = indexCount / 3;
+    if (!triangleCount) {
+        return;
+    }
+
+    std::vector<uint32_t> localIndices, localToGlobal;
+    const auto vertexCount = makeLocalIndices(indices, triangleCount * 3, localIndices, localToGlobal);
+
+    // Triangles adjacent to each vertex, in a compressed array; live triangles are kept at the beginning of each range
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (const auto index : localIndices) {
+        ++remainingTriangles[index];
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(begin(remainingTriangles), end(remainingTriangles), begin(adjacencyOffsets) + 1);
+    std::vector<uint32_t> adjacency(adjacencyOffsets.back());
+    {
+        auto fillOffsets = adjacencyOffsets;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            for (size_t k = 0; k < 3; ++k) {
+                adjacency[fillOffsets[localIndices[3 * t + k]]++] = uint32_t(t);
+            }
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = scoreTables.vertexScore(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = vertexScores[localIndices[3 * t]] + vertexScores[localIndices[3 * t + 1]] + vertexScores[localIndices[3 * t + 2]];
+    }
+
+    auto bestTriangle = uint32_t(std::max_element(begin(triangleScores), end(triangleScores)) - begin(triangleScores));
+    size_t nextUnemittedTriangle = 0;
+
+    std::vector<uint32_t> cache, newCache, evicted;
+    cache.reserve(ForsythCacheSize + 3);
+    newCache.reserve(ForsythCacheSize + 3);
+    evicted.reserve(3);
+
+    for (size_t outputTriangle = 0; outputTriangle < triangleCount; ++outputTriangle)
+    {
+        if (bestTriangle == InvalidIndex)
+        {
+            // No candidate adjacent to the cache: restart from the next triangle not emitted yet
+            while (emitted[nextUnemittedTriangle]) {
+                ++nextUnemittedTriangle;
+            }
+            bestTriangle = uint32_t(nextUnemittedTriangle);
+        }
+
+        const auto triangle = localIndices.data() + 3 * bestTriangle;
+        for (size_t k = 0; k < 3; ++k) {
+            destination[3 * outputTriangle + k] = localToGlobal[triangle[k]];
+        }
+        emitted[bestTriangle] = true;
+
+        // Remove the triangle from the adjacency of its vertices
+        for (size_t k = 0; k < 3; ++k)
+        {
+            const auto v = triangle[k];
+            const auto first = begin(adjacency) + adjacencyOffsets[v];
+            const auto last = first + remainingTriangles[v];
+            std::iter_swap(std::find(first, last, bestTriangle), last - 1);
+            --remainingTriangles[v];
+        }
+
+        // Vertices of the emitted triangle go to the front of the LRU cache
+        newCache.assign(triangle, triangle + 3);
+        for (const auto v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache.emplace_back(v);
+            }
+        }
+        // Vertices pushed past the end of the cache are evicted; they are not always the last ones of the old cache, since the vertices of the
+        // triangle can come from anywhere in it
+        evicted.clear();
+        for (size_t i = ForsythCacheSize; i < newCache.size(); ++i)
+        {
+            cachePositions[newCache[i]] = -1;
+            evicted.emplace_back(newCache[i]);
+        }
+        newCache.resize(std::min(newCache.size(), ForsythCacheSize));
+
+        // Update scores of cached and evicted vertices and of their remaining triangles
+        for (size_t i = 0; i < newCache.size() + evicted.size(); ++i)
+        {
+            const auto v = i < newCache.size() ? newCache[i] : evicted[i - newCache.size()];
+            if (i < newCache.size()) {
+                cachePositions[v] = int(i);
+            }
+
+            const auto newScore = scoreTables.vertexScore(cachePositions[v], remainingTriangles[v]);
+            const auto delta = newScore - vertexScores[v];
+            vertexScores[v] = newScore;
+
+            for (auto j = adjacencyOffsets[v], end = adjacencyOffsets[v] + remainingTriangles[v]; j < end; ++j) {
+                triangleScores[adjacency[j]] += delta;
+            }
+        }
+
+        // Then pick the best triangle adjacent to the cache, once every score is final (a triangle can share vertices with both the cache and
+        // the evicted vertices)
+        bestTriangle = InvalidIndex;
+        float bestScore = -1.f;
+        for (const auto v : newCache)
+        {
+            for (auto j = adjacencyOffsets[v], end = adjacencyOffsets[v] + remainingTriangles[v]; j < end; ++j)
+            {
+                const auto t = adjacency[j];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        std::swap(cache, newCache);
+    }
+}
+
+void optimizeOverdraw(uint32_t * destination, const uint32_t * indices, size_t indexCount, const std::vector<Vertex3f3f2f> & vertices, float threshold)
+{
+    static const size_t CacheSize = 16;
+
+    const auto triangleCount = indexCount / 3;
+    if (!triangleCount) {
+        return;
+    }
+
+    std::vector<uint32_t> localIndices, localToGlobal;
+    const auto vertexCount = makeLocalIndices(indices, triangleCount * 3, localIndices, localToGlobal);
+
+    // Hard boundaries: triangles missing the cache for all their vertices start a new cluster
+    std::vector<uint32_t> misses(triangleCount);
+    {
+        FifoCache cache(vertexCount, CacheSize);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            misses[t] = cache.processTriangle(localIndices.data() + 3 * t);
+        }
+    }
+
+    std::vector<size_t> clusterStarts;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (t == 0 || misses[t] == 3) {
+            clusterStarts.emplace_back(t);
+        }
+    }
+    clusterStarts.emplace_back(triangleCount);
+
+    // Soft boundaries: split hard clusters where the running ACMR stays within threshold of the cluster ACMR,
+    // since the cache restarts cold at the split
+    std::vector<size_t> softClusterStarts;
+    for (size_t c = 0; c + 1 < clusterStarts.size(); ++c)
+    {
+        const auto first = clusterStarts[c];
+        const auto last = clusterStarts[c + 1];
+
+        size_t clusterMisses = 0;
+        for (auto t = first; t < last; ++t) {
+            clusterMisses += misses[t];
+        }
+        const auto clusterAcmr = float(clusterMisses) / (last - first);
+
+        softClusterStarts.emplace_back(first);
+        FifoCache cache(vertexCount, CacheSize);
+        size_t runningMisses = 0;
+        auto runningStart = first;
+        for (auto t = first; t < last; ++t)
+        {
+            runningMisses += cache.processTriangle(localIndices.data() + 3 * t);
+            const auto runningAcmr = float(runningMisses) / (t + 1 - runningStart);
+            if (t + 1 < last && t + 1 - runningStart >= 16 && runningAcmr <= clusterAcmr * threshold && misses[t + 1] >= 2)
+            {
+                softClusterStarts.emplace_back(t + 1);
+                cache.reset();
+                runningMisses = 0;
+                runningStart = t + 1;
+            }
+        }
+    }
+    softClusterStarts.emplace_back(triangleCount);
+    const auto clusterCount = softClusterStarts.size() - 1;
+
+    // Sort clusters by how much they face away from the mesh centroid
+    glm::vec3 meshCentroid(0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        meshCentroid += vertices[localToGlobal[v]].position;
+    }
+    meshCentroid /= float(vertexCount);
+
+    std::vector<float> clusterScores(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        glm::vec3 centroid(0), normal(0);
+        float area = 0.f;
+        for (auto t = softClusterStarts[c]; t < softClusterStarts[c + 1]; ++t)
+        {
+            const auto & p0 = vertices[localToGlobal[localIndices[3 * t]]].position;
+            const auto & p1 = vertices[localToGlobal[localIndices[3 * t + 1]]].position;
+            const auto & p2 = vertices[localToGlobal[localIndices[3 * t + 2]]].position;
+            const auto n = glm::cross(p1 - p0, p2 - p0); // Length is twice the area
+            const auto triangleArea = glm::length(n);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal += n;
+            area += triangleArea;
+        }
+        if (area > 0.f) {
+            centroid /= area;
+        }
+        const auto normalLength = glm::length(normal);
+        clusterScores[c] = normalLength > 0.f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.f;
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    std::iota(begin(clusterOrder), end(clusterOrder), 0);
+    std::stable_sort(begin(clusterOrder), end(clusterOrder), [&](uint32_t lhs, uint32_t rhs)
+    {
+        return clusterScores[lhs] > clusterScores[rhs];
+    });
+
+    auto pOutput = destination;
+    for (const auto c : clusterOrder) {
+        for (auto i = 3 * softClusterStarts[c]; i < 3 * softClusterStarts[c + 1]; ++i) {
+            *pOutput++ = localToGlobal[localIndices[i]];
+        }
+    }
+}
+
+void optimizeVertexFetch(std::vector<Vertex3f3f2f> & vertexBuffer, std::vector<uint32_t> & indexBuffer)
+{
+    std::vector<uint32_t> remap(vertexBuffer.size(), InvalidIndex);
+    uint32_t newVertexCount = 0;
+    for (auto & index : indexBuffer)
+    {
+        if (remap[index] == InvalidIndex) {
+            remap[index] = newVertexCount++;
+        }
+        index = remap[index];
+    }
+    for (auto & newIndex : remap)
+    {
+        if (newIndex == InvalidIndex) {
+            newIndex = newVertexCount++;
+        }
+    }
+
+    std::vector<Vertex3f3f2f> newVertexBuffer(vertexBuffer.size());
+    for (size_t i = 0; i < vertexBuffer.size(); ++i) {
+        newVertexBuffer[remap[i]] = vertexBuffer[i];
+    }
+    vertexBuffer.swap(newVertexBuffer);
+}
+
+static void accumulate(VertexCacheStatistics & total, const VertexCacheStatistics & stats)
+{
+    total.triangleCount += stats.triangleCount;
+    total.vertexCount += stats.vertexCount;
+    total.transformedVertexCount += stats.transformedVertexCount;
+    total.acmr = total.triangleCount ? float(total.transformedVertexCount) / total.triangleCount : 0.f;
+    total.atvr = total.vertexCount ? float(total.transformedVertexCount) / total.vertexCount : 0.f;
+}
+
+MeshOptimizationStatistics optimizeMesh(ObjData & data, float overdrawThreshold)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<size_t> indexOffsetPerShape(data.indexCountPerShape.size());
+    size_t indexOffset = 0;
+    for (size_t shape = 0; shape < data.indexCountPerShape.size(); ++shape)
+    {
+        indexOffsetPerShape[shape] = indexOffset;
+        indexOffset += data.indexCountPerShape[shape];
+    }
+
+    std::vector<MeshOptimizationStatistics> statsPerShape(data.indexCountPerShape.size());
+    parallelFor(data.indexCountPerShape.size(), [&](size_t shape)
+    {
+        const auto pIndices = data.indexBuffer.data() + indexOffsetPerShape[shape];
+        const auto indexCount = data.indexCountPerShape[shape];
+
+        statsPerShape[shape].before = analyzeVertexCache(pIndices, indexCount);
+
+        std::vector<uint32_t> cacheOptimized(indexCount);
+        optimizeVertexCache(cacheOptimized.data(), pIndices, indexCount);
+        optimizeOverdraw(pIndices, cacheOptimized.data(), indexCount, data.vertexBuffer, overdrawThreshold);
+
+        statsPerShape[shape].after = analyzeVertexCache(pIndices, indexCount);
+    });
+
+    optimizeVertexFetch(data.vertexBuffer, data.indexBuffer);
+
+    MeshOptimizationStatistics stats;
+    for (const auto & shapeStats : statsPerShape)
+    {
+        accumulate(stats.before, shapeStats.before);
+        accumulate(stats.after, shapeStats.after);
+    }
+
+    std::clog << "Mesh optimized in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << " ms: ACMR "
+        << stats.before.acmr << " -> " << stats.after.acmr << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr << std::endl;
+
+    return stats;
+}
+
+// Sum of squared distances to planes, weighted by the area of the triangles defining them
+struct Quadric
+{
+    double a2 = 0., ab = 0., ac = 0., ad = 0.;
+    double b2 = 0., bc = 0., bd = 0.;
+    double c2 = 0., cd = 0.;
+    double d2 = 0.;
+    double weight = 0.;
+
+    Quadric() = default;
+
+    // Plane n.p + d = 0, with |n| = 1
+    Quadric(const glm::dvec3 & n, double d, double w):
+        a2(w * n.x * n.x), ab(w * n.x * n.y), ac(w * n.x * n.z), ad(w * n.x * d),
+        b2(w * n.y * n.y), bc(w * n.y * n.z), bd(w * n.y * d),
+        c2(w * n.z * n.z), cd(w * n.z * d),
+        d2(w * d * d),
+        weight(w)
+    {
+    }
+
+    Quadric & operator +=(const Quadric & q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        weight += q.weight;
+        return *this;
+    }
+
+    // Weighted mean of the squared distances of p to the planes
+    double error(const glm::vec3 & p) const
+    {
+        const double x = p.x, y = p.y, z = p.z;
+        const auto e = a2 * x * x + b2 * y * y + c2 * z * z + 2. * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z) + d2;
+        return weight > 0. ? std::max(e, 0.) / weight : 0.;
+    }
+};
+
+static Quadric operator +(Quadric lhs, const Quadric & rhs)
+{
+    return lhs += rhs;
+}
+
+size_t simplifyMesh(uint32_t * destination, const uint32_t * indices, size_t indexCount, const std::vector<Vertex3f3f2f> & vertices,
+    size_t targetIndexCount, float targetError, float * resultError)
+{
+    indexCount -= indexCount % 3;
+    if (resultError) {
+        *resultError = 0.f;
+    }
+    if (!indexCount) {
+        return 0;
+    }
+
+    std::vector<uint32_t> localIndices, localToGlobal;
+    const auto vertexCount = makeLocalIndices(indices, indexCount, localIndices, localToGlobal);
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        positions[v] = vertices[localToGlobal[v]].position;
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        const glm::dvec3 p0 = positions[localIndices[i]], p1 = positions[localIndices[i + 1]], p2 = positions[localIndices[i + 2]];
+        const auto n = glm::cross(p1 - p0, p2 - p0);
+        const auto doubleArea = glm::length(n);
+        if (doubleArea > 0.)
+        {
+            const auto unitNormal = n / doubleArea;
+            const Quadric q(unitNormal, -glm::dot(unitNormal, p0), 0.5 * doubleArea);
+            for (size_t k = 0; k < 3; ++k) {
+                quadrics[localIndices[i + k]] += q;
+            }
+        }
+    }
+
+    // A directed edge is interior if it appears once, and its opposite once; vertices of other edges are locked
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::vector<uint64_t> edges;
+        edges.reserve(indexCount);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                edges.emplace_back((uint64_t(localIndices[i + k]) << 32) | localIndices[i + (k + 1) % 3]);
+            }
+        }
+        std::sort(begin(edges), end(edges));
+
+        const auto edgeCount = [&](uint64_t edge)
+        {
+            const auto range = std::equal_range(begin(edges), end(edges), edge);
+            return range.second - range.first;
+        };
+        for (size_t e = 0; e < edges.size(); ++e)
+        {
+            const auto a = uint32_t(edges[e] >> 32), b = uint32_t(edges[e]);
+            const auto duplicated = (e > 0 && edges[e - 1] == edges[e]) || (e + 1 < edges.size() && edges[e + 1] == edges[e]);
+            if (duplicated || edgeCount((uint64_t(b) << 32) | a) != 1) {
+                locked[a] = locked[b] = true;
+            }
+        }
+    }
+
+    struct Collapse
+    {
+        uint32_t from, to;
+        double error;
+    };
+
+    const auto maxError = targetError < std::numeric_limits<float>::max() ? double(targetError) * targetError : std::numeric_limits<double>::max();
+    double error = 0.;
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1), adjacency, remap(vertexCount);
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> neighbourStamps(vertexCount, 0), linkStamps(vertexCount, 0);
+    uint32_t stamp = 0;
+
+    // Collapses are done by passes: the cheapest collapses whose neighbourhoods do not overlap, then the index list is rebuilt
+    while (localIndices.size() > targetIndexCount)
+    {
+        const auto triangleCount = localIndices.size() / 3;
+
+        std::fill(begin(adjacencyOffsets), end(adjacencyOffsets), 0);
+        for (const auto v : localIndices) {
+            ++adjacencyOffsets[v + 1];
+        }
+        std::partial_sum(begin(adjacencyOffsets), end(adjacencyOffsets), begin(adjacencyOffsets));
+        adjacency.resize(localIndices.size());
+        {
+            auto fillOffsets = adjacencyOffsets;
+            for (size_t t = 0; t < triangleCount; ++t) {
+                for (size_t k = 0; k < 3; ++k) {
+                    adjacency[fillOffsets[localIndices[3 * t + k]]++] = uint32_t(t);
+                }
+            }
+        }
+
+        // Cheapest collapse of each unlocked vertex onto one of its neighbours
+        collapses.clear();
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            if (locked[v] || adjacencyOffsets[v] == adjacencyOffsets[v + 1]) {
+                continue;
+            }
+            Collapse best{ v, v, std::numeric_limits<double>::max() };
+            for (auto j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; ++j)
+            {
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    const auto w = localIndices[3 * adjacency[j] + k];
+                    if (w != v)
+                    {
+                        const auto collapseError = (quadrics[v] + quadrics[w]).error(positions[w]);
+                        if (collapseError < best.error) {
+                            best = Collapse{ v, w, collapseError };
+                        }
+                    }
+                }
+            }
+            if (best.error <= maxError) {
+                collapses.emplace_back(best);
+            }
+        }
+        std::sort(begin(collapses), end(collapses), [](const Collapse & lhs, const Collapse & rhs)
+        {
+            return lhs.error < rhs.error;
+        });
+
+        std::fill(begin(touched), end(touched), false);
+        std::iota(begin(remap), end(remap), 0);
+        const auto trianglesToRemove = triangleCount - targetIndexCount / 3;
+        size_t removedTriangleCount = 0;
+
+        for (const auto & collapse : collapses)
+        {
+            if (removedTriangleCount >= trianglesToRemove) {
+                break;
+            }
+            const auto u = collapse.from, v = collapse.to;
+            // Adjacency of a vertex is up to date as long as none of its neighbours has been collapsed in this pass
+            if (touched[u] || touched[v]) {
+                continue;
+            }
+
+            // Link condition: the common neighbours of u and v must be the opposite vertices of the triangles of edge uv,
+            // otherwise the collapse would make the surface non manifold
+            ++stamp;
+            for (auto j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; ++j) {
+                for (size_t k = 0; k < 3; ++k) {
+                    neighbourStamps[localIndices[3 * adjacency[j] + k]] = stamp;
+                }
+            }
+            size_t commonNeighbourCount = 0, sharedTriangleCount = 0;
+            auto flipped = false;
+            for (auto j = adjacencyOffsets[u]; j < adjacencyOffsets[u + 1]; ++j)
+            {
+                const auto triangle = localIndices.data() + 3 * adjacency[j];
+                const auto shared = triangle[0] == v || triangle[1] == v || triangle[2] == v;
+                if (shared) {
+                    ++sharedTriangleCount;
+                }
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    const auto w = triangle[k];
+                    if (w != u && w != v && neighbourStamps[w] == stamp && linkStamps[w] != stamp)
+                    {
+                        linkStamps[w] = stamp;
+                        ++commonNeighbourCount;
+                    }
+                }
+
+                // Reject collapses flipping the remaining triangles of u
+                if (!shared)
+                {
+                    glm::vec3 p[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+                    const auto oldNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    for (size_t k = 0; k < 3; ++k) {
+                        if (triangle[k] == u) {
+                            p[k] = positions[v];
+                        }
+                    }
+                    const auto newNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    if (glm::dot(oldNormal, newNormal) <= 0.f) {
+                        flipped = true;
+                        break;
+                    }
+                }
+            }
+            if (flipped || commonNeighbourCount != sharedTriangleCount) {
+                continue;
+            }
+
+            for (auto j = adjacencyOffsets[u]; j < adjacencyOffsets[u + 1]; ++j) {
+                for (size_t k = 0; k < 3; ++k) {
+                    touched[localIndices[3 * adjacency[j] + k]] = true;
+                }
+            }
+            remap[u] = v;
+            quadrics[v] += quadrics[u];
+            error = std::max(error, collapse.error);
+            removedTriangleCount += sharedTriangleCount;
+        }
+
+        if (!removedTriangleCount) {
+            break;
+        }
+
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < localIndices.size(); i += 3)
+        {
+            const auto a = remap[localIndices[i]], b = remap[localIndices[i + 1]], c = remap[localIndices[i + 2]];
+            if (a != b && b != c && c != a)
+            {
+                localIndices[writeIndex++] = a;
+                localIndices[writeIndex++] = b;
+                localIndices[writeIndex++] = c;
+            }
+        }
+        localIndices.resize(writeIndex);
+    }
+
+    for (size_t i = 0; i < localIndices.size(); ++i) {
+        destination[i] = localToGlobal[localIndices[i]];
+    }
+    if (resultError) {
+        *resultError = float(std::sqrt(error));
+    }
+    return localIndices.size();
+}
+
+MeshLods generateLods(const ObjData & data, size_t levelCount, float reductionPerLevel)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    MeshLods lods;
+    lods.levelCount = std::max(levelCount, size_t(1));
+    lods.shapeCount = data.indexCountPerShape.size();
+    lods.indexOffsets.resize(lods.levelCount * lods.shapeCount);
+    lods.indexCounts.resize(lods.levelCount * lods.shapeCount);
+    lods.errors.resize(lods.levelCount * lods.shapeCount, 0.f);
+
+    std::vector<size_t> indexOffsetPerShape(lods.shapeCount);
+    size_t indexOffset = 0;
+    for (size_t shape = 0; shape < lods.shapeCount; ++shape)
+    {
+        indexOffsetPerShape[shape] = indexOffset;
+        indexOffset += data.indexCountPerShape[shape];
+    }
+
+    // Indices of the levels > 0, per shape
+    std::vector<std::vector<std::vector<uint32_t>>> lodIndices(lods.shapeCount);
+    parallelFor(lods.shapeCount, [&](size_t shape)
+    {
+        const auto pIndices = data.indexBuffer.data() + indexOffsetPerShape[shape];
+        const auto indexCount = data.indexCountPerShape[shape];
+
+        auto & shapeLods = lodIndices[shape];
+        shapeLods.resize(lods.levelCount - 1);
+        const uint32_t * pPreviousIndices = pIndices;
+        size_t previousIndexCount = indexCount;
+        float previousError = 0.f;
+        for (size_t level = 1; level < lods.levelCount; ++level)
+        {
+            auto & indices = shapeLods[level - 1];
+            indices.resize(previousIndexCount);
+            const auto targetIndexCount = size_t(previousIndexCount / 3 * reductionPerLevel) * 3;
+
+            // Each level is simplified from the previous one, so errors add up
+            float error = 0.f;
+            indices.resize(simplifyMesh(indices.data(), pPreviousIndices, previousIndexCount, data.vertexBuffer, targetIndexCount, std::numeric_limits<float>::max(), &error));
+            std::vector<uint32_t> optimizedIndices(indices.size());
+            optimizeVertexCache(optimizedIndices.data(), indices.data(), indices.size());
+            indices.swap(optimizedIndices);
+
+            lods.errors[level * lods.shapeCount + shape] = previousError + error;
+            previousError += error;
+            pPreviousIndices = indices.data();
+            previousIndexCount = indices.size();
+        }
+    });
+
+    lods.indexBuffer = data.indexBuffer;
+    for (size_t shape = 0; shape < lods.shapeCount; ++shape)
+    {
+        lods.indexOffsets[shape] = uint32_t(indexOffsetPerShape[shape]);
+        lods.indexCounts[shape] = data.indexCountPerShape[shape];
+    }
+    for (size_t level = 1; level < lods.levelCount; ++level)
+    {
+        for (size_t shape = 0; shape < lods.shapeCount; ++shape)
+        {
+            const auto & indices = lodIndices[shape][level - 1];
+            lods.indexOffsets[level * lods.shapeCount + shape] = uint32_t(lods.indexBuffer.size());
+            lods.indexCounts[level * lods.shapeCount + shape] = uint32_t(indices.size());
+            lods.indexBuffer.insert(end(lods.indexBuffer), begin(indices), end(indices));
+        }
+    }
+
+    std::clog << "Generated " << lods.levelCount << " levels of detail in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << " ms:";
+    for (size_t level = 0; level < lods.levelCount; ++level)
+    {
+        size_t indexCount = 0;
+        for (size_t shape = 0; shape < lods.shapeCount; ++shape) {
+            indexCount += lods.indexCounts[level * lods.shapeCount + shape];
+        }
+        std::clog << " " << indexCount / 3;
+    }
+    std::clog << " triangles" << std::endl;
+
+    return lods;
+}
+
+}
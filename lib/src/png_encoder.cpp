@@ -0,0 +1,529 @@
+#include <glmlv/png_encoder.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+
+namespace glmlv
+{
+
+namespace
+{
+
+const size_t BytesPerPixel = Image2DRGBA::NumComponents;
+const size_t BlockSize = 128 * 1024; // Pixel bytes per block, a few times the deflate window so that the restarts of the matches cost little
+
+// Throws std::runtime_error for an empty image, which has no row to split into blocks
+size_t computeRowsPerBlock(const Image2DRGBA & image)
+{
+    if (!image.size())
+    {
+        std::cerr << "Unable to encode PNG image: empty image" << std::endl;
+        throw std::runtime_error("Unable to encode PNG image: empty image");
+    }
+    return std::max(size_t(1), BlockSize / image.rowSize());
+}
+
+const uint32_t Adler32Modulus = 65521;
+
+uint32_t updateAdler32(uint32_t adler, const unsigned char * data, size_t size)
+{
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size)
+    {
+        const auto count = std::min(size, size_t(5552)); // Largest count before b can overflow
+        for (size_t i = 0; i < count; ++i)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= Adler32Modulus;
+        b %= Adler32Modulus;
+        data += count;
+        size -= count;
+    }
+    return a | (b << 16);
+}
+
+// Checksum of the concatenation of two sequences from their checksums, size2 being the size of the second one (adler32_combine of zlib)
+uint32_t combineAdler32(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+    const auto remainder = uint32_t(size2 % Adler32Modulus);
+    auto sum1 = adler1 & 0xffff;
+    auto sum2 = uint32_t((uint64_t(remainder) * sum1) % Adler32Modulus);
+    sum1 += (adler2 & 0xffff) + Adler32Modulus - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + Adler32Modulus - remainder;
+    if (sum1 >= Adler32Modulus) {
+        sum1 -= Adler32Modulus;
+    }
+    if (sum1 >= Adler32Modulus) {
+        sum1 -= Adler32Modulus;
+    }
+    if (sum2 >= 2 * Adler32Modulus) {
+        sum2 -= 2 * Adler32Modulus;
+    }
+    if (sum2 >= Adler32Modulus) {
+        sum2 -= Adler32Modulus;
+    }
+    return sum1 | (sum2 << 16);
+}
+
+// Continue the CRC crc (0 for an empty sequence) with data
+uint32_t updateCRC32(uint32_t crc, const unsigned char * data, size_t size)
+{
+    static const auto table = []()
+    {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            auto c = n;
+            for (size_t k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+const unsigned char IDATChunkType[] = { 'I', 'D', 'A', 'T' };
+
+// Filter the row of size bytes with filter type (0 to 4); prior is the previous row, zeros for the first one
+void filterRow(const unsigned char * row, const unsigned char * prior, size_t size, int type, unsigned char * dst)
+{
+    switch (type)
+    {
+    case 0:
+        std::memcpy(dst, row, size);
+        break;
+    case 1:
+        std::memcpy(dst, row, BytesPerPixel);
+        for (size_t i = BytesPerPixel; i < size; ++i) {
+            dst[i] = row[i] - row[i - BytesPerPixel];
+        }
+        break;
+    case 2:
+        for (size_t i = 0; i < size; ++i) {
+            dst[i] = row[i] - prior[i];
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < BytesPerPixel; ++i) {
+            dst[i] = row[i] - (prior[i] >> 1);
+        }
+        for (size_t i = BytesPerPixel; i < size; ++i) {
+            dst[i] = row[i] - ((row[i - BytesPerPixel] + prior[i]) >> 1);
+        }
+        break;
+    default:
+        for (size_t i = 0; i < BytesPerPixel; ++i) {
+            dst[i] = row[i] - prior[i]; // The Paeth predictor of the first pixel is the pixel above
+        }
+        for (size_t i = BytesPerPixel; i < size; ++i)
+        {
+            const int a = row[i - BytesPerPixel], b = prior[i], c = prior[i - BytesPerPixel];
+            const int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+            dst[i] = row[i] - (unsigned char) ((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+        }
+        break;
+    }
+}
+
+// Sum of the filtered bytes as signed values, the heuristic of stb_image_write (and of the PNG specification) to choose the filter of each row
+size_t filterCost(const unsigned char * filtered, size_t size)
+{
+    size_t cost = 0;
+    for (size_t i = 0; i < size; ++i) {
+        cost += std::abs(int((signed char) filtered[i]));
+    }
+    return cost;
+}
+
+// Huffman code with its bits reversed, since deflate writes codes from their most significant bit in a stream filled from the least significant bits
+struct HuffmanCode
+{
+    uint16_t bits;
+    uint8_t length;
+};
+
+const uint16_t LengthBases[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t LengthExtraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t DistanceBases[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t DistanceExtraBits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Codes of the fixed Huffman deflate blocks, and symbols of the lengths and distances of matches
+struct DeflateTables
+{
+    HuffmanCode literalCodes[288];
+    HuffmanCode distanceCodes[30];
+    uint8_t lengthSymbols[259]; // Indexed by length, symbol minus 257
+    uint8_t distanceSymbols[512]; // Indexed by distance - 1 below 256, 256 + (distance - 1) / 128 above (distance_code of zlib)
+
+    DeflateTables()
+    {
+        const auto reverse = [](uint32_t code, uint8_t length)
+        {
+            uint32_t result = 0;
+            for (uint8_t i = 0; i < length; ++i) {
+                result |= ((code >> i) & 1) << (length - 1 - i);
+            }
+            return HuffmanCode{ uint16_t(result), length };
+        };
+        for (uint32_t symbol = 0; symbol < 288; ++symbol)
+        {
+            literalCodes[symbol] = symbol < 144 ? reverse(0x30 + symbol, 8) :
+                symbol < 256 ? reverse(0x190 + symbol - 144, 9) :
+                symbol < 280 ? reverse(symbol - 256, 7) : reverse(0xc0 + symbol - 280, 8);
+        }
+        for (uint32_t symbol = 0; symbol < 30; ++symbol) {
+            distanceCodes[symbol] = reverse(symbol, 5);
+        }
+        for (uint8_t symbol = 0; symbol < 28; ++symbol)
+        {
+            for (size_t length = LengthBases[symbol]; length < LengthBases[symbol] + (1u << LengthExtraBits[symbol]); ++length) {
+                lengthSymbols[length] = symbol;
+            }
+        }
+        lengthSymbols[258] = 28; // Also the last length of symbol 27, but 258 has its own symbol without extra bits
+        for (uint8_t symbol = 0; symbol < 30; ++symbol)
+        {
+            for (size_t distance = DistanceBases[symbol]; distance < DistanceBases[symbol] + (1u << DistanceExtraBits[symbol]); ++distance) {
+                distanceSymbols[distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7)] = symbol;
+            }
+        }
+    }
+};
+
+const DeflateTables & getDeflateTables()
+{
+    static const DeflateTables tables;
+    return tables;
+}
+
+// Writes bits from the least significant ones, 32 at a time, in output resized beforehand for maxSize more bytes
+class BitWriter
+{
+public:
+    BitWriter(std::vector<unsigned char> & output, size_t maxSize):
+        m_Output(output), m_nSize(output.size())
+    {
+        m_Output.resize(m_nSize + maxSize + 4);
+    }
+
+    void write(uint32_t bits, size_t count)
+    {
+        m_nBits |= uint64_t(bits) << m_nCount;
+        m_nCount += count;
+        if (m_nCount >= 32)
+        {
+            const auto dst = m_Output.data() + m_nSize;
+            dst[0] = (unsigned char) m_nBits;
+            dst[1] = (unsigned char) (m_nBits >> 8);
+            dst[2] = (unsigned char) (m_nBits >> 16);
+            dst[3] = (unsigned char) (m_nBits >> 24);
+            m_nSize += 4;
+            m_nBits >>= 32;
+            m_nCount -= 32;
+        }
+    }
+
+    void write(HuffmanCode code)
+    {
+        write(code.bits, code.length);
+    }
+
+    void alignToByte()
+    {
+        write(0, (8 - m_nCount % 8) % 8);
+    }
+
+    // Write the remaining bits, padded to a byte, and shrink output to the written bytes
+    void finish()
+    {
+        alignToByte();
+        for (; m_nCount; m_nCount -= 8)
+        {
+            m_Output[m_nSize++] = (unsigned char) m_nBits;
+            m_nBits >>= 8;
+        }
+        m_Output.resize(m_nSize);
+    }
+
+private:
+    std::vector<unsigned char> & m_Output;
+    size_t m_nSize;
+    uint64_t m_nBits = 0;
+    size_t m_nCount = 0;
+};
+
+const size_t WindowSize = 32768;
+const size_t MinMatchLength = 3;
+const size_t MaxMatchLength = 258;
+const size_t MaxChainLength = 8; // Candidates tested per position, zlib uses 4 to 4096 depending on the level
+const size_t NiceMatchLength = 128; // Stop searching once a match is this long
+const size_t LazyMatchLength = 32; // Only look for a longer match at the next position below this length
+const size_t HashBits = 15;
+
+// Append data to output as fixed Huffman deflate blocks, with LZ77 matches found in hash chains and one step lazy matching (like stb_image_write,
+// with a few more candidates). If final is false, an empty stored block follows so that another deflate stream can be appended.
+void deflate(const unsigned char * data, size_t size, bool final, std::vector<unsigned char> & output)
+{
+    const auto & tables = getDeflateTables();
+    BitWriter writer(output, size + size / 8 + 16); // Literals take at most 9 bits, matches less than 9 bits per byte
+    writer.write(final ? 1 : 0, 1);
+    writer.write(1, 2); // Fixed Huffman codes
+
+    std::vector<int32_t> head(size_t(1) << HashBits, -1);
+    std::vector<int32_t> previous(size); // Previous position with the same hash, as a chain from head
+
+    const auto hash = [&](size_t i)
+    {
+        const auto value = uint32_t(data[i]) | (uint32_t(data[i + 1]) << 8) | (uint32_t(data[i + 2]) << 16);
+        return (value * 2654435761u) >> (32 - HashBits);
+    };
+    const auto insert = [&](size_t i, uint32_t hash)
+    {
+        auto & first = head[hash];
+        previous[i] = first;
+        first = int32_t(i);
+    };
+    // Length of the longest match at i, 0 if none; to call only if size - i >= MinMatchLength
+    const auto findMatch = [&](size_t i, uint32_t hash, size_t & distance)
+    {
+        const auto maxLength = std::min(MaxMatchLength, size - i);
+        const auto current = data + i;
+        size_t bestLength = MinMatchLength - 1;
+        auto candidate = head[hash];
+        for (size_t chain = 0; candidate >= 0 && i - candidate <= WindowSize && chain < MaxChainLength; ++chain, candidate = previous[candidate])
+        {
+            const auto match = data + candidate;
+            if (match[bestLength] != current[bestLength]) {
+                continue;
+            }
+            size_t length = 0;
+            while (length < maxLength && match[length] == current[length]) {
+                ++length;
+            }
+            if (length > bestLength)
+            {
+                bestLength = length;
+                distance = i - candidate;
+                if (length >= NiceMatchLength || length == maxLength) {
+                    break;
+                }
+            }
+        }
+        return bestLength >= MinMatchLength ? bestLength : 0;
+    };
+
+    size_t i = 0;
+    size_t pendingLength = 0, pendingDistance = 0; // Match at i found by the lazy evaluation of the previous position
+    bool hasPendingMatch = false;
+    while (i < size)
+    {
+        size_t length = 0, distance = 0;
+        if (size - i >= MinMatchLength)
+        {
+            const auto currentHash = hash(i);
+            if (hasPendingMatch)
+            {
+                length = pendingLength;
+                distance = pendingDistance;
+                hasPendingMatch = false;
+            }
+            else {
+                length = findMatch(i, currentHash, distance);
+            }
+            insert(i, currentHash);
+        }
+
+        if (length && length < LazyMatchLength && size - (i + 1) >= MinMatchLength)
+        {
+            pendingLength = findMatch(i + 1, hash(i + 1), pendingDistance);
+            hasPendingMatch = true;
+            if (pendingLength > length) {
+                length = 0; // Emit a literal, then the longer match
+            }
+        }
+
+        if (!length)
+        {
+            writer.write(tables.literalCodes[data[i]]);
+            ++i;
+            continue;
+        }
+
+        const auto lengthSymbol = tables.lengthSymbols[length];
+        writer.write(tables.literalCodes[257 + lengthSymbol]);
+        writer.write(uint32_t(length - LengthBases[lengthSymbol]), LengthExtraBits[lengthSymbol]);
+        const auto distanceSymbol = tables.distanceSymbols[distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7)];
+        writer.write(tables.distanceCodes[distanceSymbol]);
+        writer.write(uint32_t(distance - DistanceBases[distanceSymbol]), DistanceExtraBits[distanceSymbol]);
+
+        for (size_t j = i + 1; j < i + length && size - j >= MinMatchLength; ++j) {
+            insert(j, hash(j));
+        }
+        i += length;
+        hasPendingMatch = false;
+    }
+    writer.write(tables.literalCodes[256]); // End of block
+
+    if (!final)
+    {
+        writer.write(0, 3); // Stored block, not final
+        writer.alignToByte();
+        writer.write(0x0000, 16); // Length
+        writer.write(0xffff, 16); // One's complement of the length
+    }
+    writer.finish();
+}
+
+void writeBigEndian(uint32_t value, unsigned char * dst)
+{
+    dst[0] = (unsigned char) (value >> 24);
+    dst[1] = (unsigned char) (value >> 16);
+    dst[2] = (unsigned char) (value >> 8);
+    dst[3] = (unsigned char) value;
+}
+
+}
+
+size_t computePNGBlockCount(const Image2DRGBA & image)
+{
+    const auto rowsPerBlock = computeRowsPerBlock(image);
+    return (image.height() + rowsPerBlock - 1) / rowsPerBlock;
+}
+
+PNGBlock encodePNGBlock(const Image2DRGBA & image, size_t blockIndex, bool flipY)
+{
+    const auto rowsPerBlock = computeRowsPerBlock(image);
+    const auto firstRow = blockIndex * rowsPerBlock;
+    const auto rowCount = std::min(rowsPerBlock, image.height() - firstRow);
+    const auto rowSize = image.rowSize();
+
+    // Each filtered row is preceded by its filter type
+    std::vector<unsigned char> filtered(rowCount * (rowSize + 1));
+    std::vector<unsigned char> candidate(rowSize);
+    const std::vector<unsigned char> zeros(firstRow ? 0 : rowSize);
+    const auto imageRow = [&](size_t fileRow) { return image(0, flipY ? image.height() - 1 - fileRow : fileRow); };
+    for (size_t y = firstRow; y < firstRow + rowCount; ++y)
+    {
+        const auto row = imageRow(y);
+        const auto prior = y ? imageRow(y - 1) : zeros.data();
+        const auto dst = filtered.data() + (y - firstRow) * (rowSize + 1);
+        size_t bestCost = 0;
+        for (int type = 0; type < 5; ++type)
+        {
+            filterRow(row, prior, rowSize, type, candidate.data());
+            const auto cost = filterCost(candidate.data(), rowSize);
+            if (!type || cost < bestCost)
+            {
+                bestCost = cost;
+                dst[0] = (unsigned char) type;
+                std::memcpy(dst + 1, candidate.data(), rowSize);
+            }
+        }
+    }
+
+    PNGBlock block;
+    block.filteredSize = filtered.size();
+    block.adler32 = updateAdler32(1, filtered.data(), filtered.size());
+    block.data.reserve(filtered.size() + filtered.size() / 8 + 16);
+    if (!blockIndex)
+    {
+        // zlib header: deflate with a 32 kB window, fast compression level
+        block.data.push_back(0x78);
+        block.data.push_back(0x5e);
+    }
+    deflate(filtered.data(), filtered.size(), firstRow + rowCount == image.height(), block.data);
+    block.crc = updateCRC32(updateCRC32(0, IDATChunkType, sizeof(IDATChunkType)), block.data.data(), block.data.size());
+    return block;
+}
+
+void writePNG(const Image2DRGBA & image, const std::vector<PNGBlock> & blocks, const fs::path & path)
+{
+    const auto onFailure = [&](const std::string & reason)
+    {
+        std::cerr << "Unable to write PNG image " << path << ": " << reason << std::endl;
+        throw std::runtime_error("Unable to write PNG image " + path.string() + ": " + reason);
+    };
+
+    if (!image.size()) {
+        onFailure("empty image");
+    }
+    if (blocks.size() != computePNGBlockCount(image)) {
+        onFailure("missing blocks");
+    }
+
+    std::ofstream output(path.string(), std::ios::binary | std::ios::trunc);
+    const auto writeChunk = [&](const char * type, const unsigned char * data, size_t size, const unsigned char * suffix, size_t suffixSize, uint32_t crc)
+    {
+        unsigned char header[8];
+        writeBigEndian(uint32_t(size + suffixSize), header);
+        std::memcpy(header + 4, type, 4);
+        unsigned char footer[4];
+        writeBigEndian(updateCRC32(crc, suffix, suffixSize), footer);
+        output.write((const char *) header, sizeof(header));
+        output.write((const char *) data, size);
+        output.write((const char *) suffix, suffixSize);
+        output.write((const char *) footer, sizeof(footer));
+    };
+    const auto writeSmallChunk = [&](const char * type, const unsigned char * data, size_t size)
+    {
+        writeChunk(type, data, size, nullptr, 0, updateCRC32(updateCRC32(0, (const unsigned char *) type, 4), data, size));
+    };
+
+    const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    output.write((const char *) signature, sizeof(signature));
+
+    unsigned char header[13];
+    writeBigEndian(uint32_t(image.width()), header);
+    writeBigEndian(uint32_t(image.height()), header + 4);
+    header[8] = 8; // Bits per component
+    header[9] = 6; // RGBA
+    header[10] = 0; // Deflate
+    header[11] = 0; // Adaptive filtering
+    header[12] = 0; // No interlace
+    writeSmallChunk("IHDR", header, sizeof(header));
+
+    // The zlib stream ends with the Adler-32 checksum of all the filtered rows, appended to the last block
+    auto adler32 = blocks.front().adler32;
+    for (size_t i = 1; i < blocks.size(); ++i) {
+        adler32 = combineAdler32(adler32, blocks[i].adler32, blocks[i].filteredSize);
+    }
+    unsigned char checksum[4];
+    writeBigEndian(adler32, checksum);
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        const auto last = i + 1 == blocks.size();
+        writeChunk("IDAT", blocks[i].data.data(), blocks[i].data.size(), last ? checksum : nullptr, last ? sizeof(checksum) : 0, blocks[i].crc);
+    }
+
+    writeSmallChunk("IEND", nullptr, 0);
+
+    if (!output.flush()) {
+        onFailure("write error");
+    }
+}
+
+void writePNG(const Image2DRGBA & image, const fs::path & path, size_t threadCount)
+{
+    std::vector<PNGBlock> blocks(computePNGBlockCount(image));
+    parallelFor(blocks.size(), [&](size_t i)
+    {
+        blocks[i] = encodePNGBlock(image, i);
+    }, threadCount);
+    writePNG(image, blocks, path);
+}
+
+}
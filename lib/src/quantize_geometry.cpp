@@ -0,0 +1,71 @@
+#include <glmlv/quantize_geometry.hpp>
+#include <glmlv/parallel.hpp>
+
+#include <glm/gtc/packing.hpp>
+
+namespace glmlv
+{
+
+static glm::vec2 signNotZero(const glm::vec2 & v)
+{
+    return glm::vec2(v.x >= 0.f ? 1.f : -1.f, v.y >= 0.f ? 1.f : -1.f);
+}
+
+glm::vec2 octahedralEncode(const glm::vec3 & n)
+{
+    // Project on the octahedron |x| + |y| + |z| = 1, then fold the lower hemisphere over the diagonals
+    const auto l1Norm = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+    if (l1Norm == 0.f) {
+        return glm::vec2(0.f);
+    }
+    const auto p = glm::vec2(n.x, n.y) / l1Norm;
+    if (n.z >= 0.f) {
+        return p;
+    }
+    return (1.f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+}
+
+glm::vec3 octahedralDecode(const glm::vec2 & e)
+{
+    auto n = glm::vec3(e.x, e.y, 1.f - glm::abs(e.x) - glm::abs(e.y));
+    if (n.z < 0.f)
+    {
+        const auto p = (1.f - glm::abs(glm::vec2(e.y, e.x))) * signNotZero(e);
+        n.x = p.x;
+        n.y = p.y;
+    }
+    return glm::normalize(n);
+}
+
+QuantizedGeometry quantizeGeometry(const std::vector<Vertex3f3f2f> & vertexBuffer, const glm::vec3 & bboxMin, const glm::vec3 & bboxMax)
+{
+    // Flat boxes keep a non zero extent so that the scale stays invertible
+    const auto extent = glm::max(bboxMax - bboxMin, glm::vec3(1e-20f));
+
+    QuantizedGeometry geometry;
+    geometry.dequantizationMatrix = glm::scale(glm::translate(glm::mat4(1), bboxMin), extent);
+    geometry.vertexBuffer.resize(vertexBuffer.size());
+
+    static const size_t BlockSize = 16384;
+    parallelFor((vertexBuffer.size() + BlockSize - 1) / BlockSize, [&](size_t block)
+    {
+        const auto end = std::min(vertexBuffer.size(), (block + 1) * BlockSize);
+        for (auto i = block * BlockSize; i < end; ++i)
+        {
+            const auto & vertex = vertexBuffer[i];
+            auto & quantized = geometry.vertexBuffer[i];
+
+            const auto position = (vertex.position - bboxMin) / extent;
+            quantized.position = glm::u16vec4(glm::packUnorm1x16(position.x), glm::packUnorm1x16(position.y), glm::packUnorm1x16(position.z), 0xFFFF);
+
+            const auto normal = octahedralEncode(vertex.normal);
+            quantized.normal = glm::i16vec2(int16_t(glm::packSnorm1x16(normal.x)), int16_t(glm::packSnorm1x16(normal.y)));
+
+            quantized.texCoords = glm::u16vec2(glm::packHalf1x16(vertex.texCoords.x), glm::packHalf1x16(vertex.texCoords.y));
+        }
+    });
+
+    return geometry;
+}
+
+}
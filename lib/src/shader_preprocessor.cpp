@@ -0,0 +1,220 @@
+#include <glmlv/shader_preprocessor.hpp>
+#include <glmlv/GLShader.hpp>
+
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace glmlv
+{
+
+static bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Name of the directive of the line [begin, end), empty if the line is not a directive; argumentBegin is set to the first character after the name
+static std::string parseDirective(const std::string & source, size_t begin, size_t end, size_t & argumentBegin)
+{
+    auto i = begin;
+    while (i < end && isBlank(source[i])) {
+        ++i;
+    }
+    if (i == end || source[i] != '#') {
+        return std::string();
+    }
+    ++i;
+    while (i < end && isBlank(source[i])) {
+        ++i;
+    }
+    const auto nameBegin = i;
+    while (i < end && source[i] >= 'a' && source[i] <= 'z') {
+        ++i;
+    }
+    argumentBegin = i;
+    return source.substr(nameBegin, i - nameBegin);
+}
+
+namespace
+{
+
+class ShaderPreprocessor
+{
+public:
+    explicit ShaderPreprocessor(const ShaderDefines & defines):
+        m_defines(defines)
+    {
+    }
+
+    std::string run(const fs::path & path)
+    {
+        include(path);
+        return std::move(m_output);
+    }
+
+    std::vector<fs::path> & files()
+    {
+        return m_files;
+    }
+
+private:
+    void include(const fs::path & path)
+    {
+        const auto fileIndex = m_files.size();
+        m_files.push_back(path);
+        const auto source = loadShaderSource(path);
+        if (!fileIndex) {
+            m_includedFiles.insert(fs::canonical(path).string());
+        }
+        const auto fileNumber = std::to_string(fileIndex);
+
+        // The defines follow the #version directive of the main file, or start the shader if there is none
+        auto definesPending = fileIndex == 0;
+        if (definesPending && !hasVersionDirective(source))
+        {
+            appendDefines();
+            m_output += "#line 1 0\n";
+            definesPending = false;
+        }
+        if (fileIndex) {
+            m_output += "#line 1 " + fileNumber + "\n";
+        }
+
+        // For each conditional group being read, whether an included file has been expanded in it: if the group is skipped by the compiler, so
+        // is the #line directive that follows the included content, and the line numbers must be restored after the group's next directive
+        std::vector<bool> conditionalIncludes;
+
+        size_t lineNumber = 0;
+        for (size_t begin = 0; begin < source.size(); )
+        {
+            auto end = source.find('\n', begin);
+            if (end == std::string::npos) {
+                end = source.size();
+            }
+            ++lineNumber;
+
+            size_t argumentBegin = 0;
+            const auto directive = parseDirective(source, begin, end, argumentBegin);
+            if (directive == "version")
+            {
+                // Empty lines replace ignored directives, so that line numbers are kept
+                if (definesPending)
+                {
+                    m_output.append(source, begin, end - begin);
+                    m_output += '\n';
+                    appendDefines();
+                    m_output += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+                    definesPending = false;
+                }
+                else {
+                    m_output += '\n';
+                }
+            }
+            else if (directive == "include")
+            {
+                const auto nameBegin = source.find('"', argumentBegin);
+                const auto nameEnd = nameBegin < end ? source.find('"', nameBegin + 1) : std::string::npos;
+                if (nameEnd >= end)
+                {
+                    std::cerr << "Invalid #include directive in " << path << " line " << lineNumber << std::endl;
+                    throw std::runtime_error("Invalid #include directive in " + path.string() + " line " + std::to_string(lineNumber));
+                }
+                const auto includePath = path.parent_path() / source.substr(nameBegin + 1, nameEnd - nameBegin - 1);
+                if (!fs::exists(includePath))
+                {
+                    std::cerr << "Unable to find " << includePath << " included by " << path << " line " << lineNumber << std::endl;
+                    throw std::runtime_error("Unable to find " + includePath.string() + " included by " + path.string());
+                }
+                if (m_includedFiles.insert(fs::canonical(includePath).string()).second)
+                {
+                    include(includePath);
+                    m_output += "#line " + std::to_string(lineNumber + 1) + " " + fileNumber + "\n";
+                    conditionalIncludes.assign(conditionalIncludes.size(), true);
+                }
+                else {
+                    m_output += '\n';
+                }
+            }
+            else
+            {
+                m_output.append(source, begin, end - begin);
+                m_output += '\n';
+
+                if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+                    conditionalIncludes.push_back(false);
+                }
+                else if ((directive == "elif" || directive == "else" || directive == "endif") && !conditionalIncludes.empty())
+                {
+                    if (conditionalIncludes.back()) {
+                        m_output += "#line " + std::to_string(lineNumber + 1) + " " + fileNumber + "\n";
+                    }
+                    if (directive == "endif") {
+                        conditionalIncludes.pop_back();
+                    }
+                }
+            }
+            begin = end + 1;
+        }
+    }
+
+    static bool hasVersionDirective(const std::string & source)
+    {
+        for (size_t begin = 0; begin < source.size(); )
+        {
+            auto end = source.find('\n', begin);
+            if (end == std::string::npos) {
+                end = source.size();
+            }
+            size_t argumentBegin;
+            if (parseDirective(source, begin, end, argumentBegin) == "version") {
+                return true;
+            }
+            begin = end + 1;
+        }
+        return false;
+    }
+
+    void appendDefines()
+    {
+        for (const auto & define : m_defines)
+        {
+            m_output += "#define " + define.first;
+            if (!define.second.empty()) {
+                m_output += " " + define.second;
+            }
+            m_output += '\n';
+        }
+    }
+
+    const ShaderDefines & m_defines;
+    std::vector<fs::path> m_files;
+    std::unordered_set<std::string> m_includedFiles; // Canonical paths
+    std::string m_output;
+};
+
+}
+
+std::string preprocessShaderSource(const fs::path & path, const ShaderDefines & defines, std::vector<fs::path> * pFiles)
+{
+    ShaderPreprocessor preprocessor(defines);
+    auto source = preprocessor.run(path);
+    if (pFiles) {
+        *pFiles = std::move(preprocessor.files());
+    }
+    return source;
+}
+
+std::string toString(const ShaderDefines & defines)
+{
+    std::string string;
+    for (const auto & define : defines)
+    {
+        string += (string.empty() ? "" : " ") + define.first;
+        if (!define.second.empty()) {
+            string += "=" + define.second;
+        }
+    }
+    return string;
+}
+
+}
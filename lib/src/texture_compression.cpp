@@ -0,0 +1,566 @@
+#include <glmlv/texture_compression.hpp>
+#include <glmlv/MappedFile.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstring>
+
+namespace glmlv
+{
+
+namespace
+{
+
+// Pixels of the block (blockX, blockY), row by row; coordinates outside of the image are clamped to its borders
+void loadBlock(const Image2DRGBA & image, size_t blockX, size_t blockY, glm::u8vec4 pixels[16])
+{
+    for (size_t y = 0; y < 4; ++y)
+    {
+        const auto imageY = std::min(blockY * 4 + y, image.height() - 1);
+        for (size_t x = 0; x < 4; ++x)
+        {
+            const auto imageX = std::min(blockX * 4 + x, image.width() - 1);
+            std::memcpy(&pixels[x + 4 * y], image(imageX, imageY), Image2DRGBA::NumComponents);
+        }
+    }
+}
+
+void storeBlock(const glm::u8vec4 pixels[16], size_t blockX, size_t blockY, Image2DRGBA & image)
+{
+    for (size_t y = 0; y < 4 && blockY * 4 + y < image.height(); ++y)
+    {
+        for (size_t x = 0; x < 4 && blockX * 4 + x < image.width(); ++x) {
+            std::memcpy(image(blockX * 4 + x, blockY * 4 + y), &pixels[x + 4 * y], Image2DRGBA::NumComponents);
+        }
+    }
+}
+
+// color in [0, 255]
+uint16_t packRGB565(const glm::vec3 & color)
+{
+    const auto r = glm::clamp(int(color.r * (31.f / 255.f) + 0.5f), 0, 31);
+    const auto g = glm::clamp(int(color.g * (63.f / 255.f) + 0.5f), 0, 63);
+    const auto b = glm::clamp(int(color.b * (31.f / 255.f) + 0.5f), 0, 31);
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+glm::ivec3 unpackRGB565(uint16_t color)
+{
+    const auto r = (color >> 11) & 31;
+    const auto g = (color >> 5) & 63;
+    const auto b = color & 31;
+    return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// BC1 blocks with c0 <= c1 have three colors and transparent black, except in BC3 blocks which always have four colors
+void decodeBC1Palette(uint16_t c0, uint16_t c1, bool fourColors, glm::ivec4 palette[4])
+{
+    const auto p0 = unpackRGB565(c0);
+    const auto p1 = unpackRGB565(c1);
+    palette[0] = glm::ivec4(p0, 255);
+    palette[1] = glm::ivec4(p1, 255);
+    if (fourColors || c0 > c1)
+    {
+        palette[2] = glm::ivec4((2 * p0 + p1) / 3, 255);
+        palette[3] = glm::ivec4((p0 + 2 * p1) / 3, 255);
+    }
+    else
+    {
+        palette[2] = glm::ivec4((p0 + p1) / 2, 255);
+        palette[3] = glm::ivec4(0);
+    }
+}
+
+struct BC1Fit
+{
+    uint16_t c0 = 0;
+    uint16_t c1 = 0;
+    uint8_t indices[16] = {};
+    int error = std::numeric_limits<int>::max(); // Sum of squared RGB errors
+};
+
+// Nearest palette color of each pixel, for endpoints ordered so that the block is decoded with four colors
+BC1Fit fitBC1Indices(const glm::u8vec4 pixels[16], uint16_t c0, uint16_t c1)
+{
+    BC1Fit fit;
+    fit.c0 = std::max(c0, c1);
+    fit.c1 = std::min(c0, c1);
+    fit.error = 0;
+
+    glm::ivec4 palette[4];
+    decodeBC1Palette(fit.c0, fit.c1, true, palette);
+    // Equal endpoints would decode with three colors: only the first one is used
+    const auto paletteSize = fit.c0 == fit.c1 ? 1 : 4;
+
+    for (size_t i = 0; i < 16; ++i)
+    {
+        const auto pixel = glm::ivec3(pixels[i]);
+        auto bestError = std::numeric_limits<int>::max();
+        for (auto p = 0; p < paletteSize; ++p)
+        {
+            const auto difference = pixel - glm::ivec3(palette[p]);
+            const auto error = difference.x * difference.x + difference.y * difference.y + difference.z * difference.z;
+            if (error < bestError)
+            {
+                bestError = error;
+                fit.indices[i] = uint8_t(p);
+            }
+        }
+        fit.error += bestError;
+    }
+
+    return fit;
+}
+
+// Endpoints minimizing the squared error of the pixels for their current indices; returns false if the system is singular
+bool refineBC1Endpoints(const glm::u8vec4 pixels[16], const BC1Fit & fit, uint16_t & c0, uint16_t & c1)
+{
+    static const float Weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f }; // Weight of the first endpoint for each index
+
+    float aa = 0.f, bb = 0.f, ab = 0.f;
+    glm::vec3 ax(0.f), bx(0.f);
+    for (size_t i = 0; i < 16; ++i)
+    {
+        const auto a = Weights[fit.indices[i]];
+        const auto b = 1.f - a;
+        const auto pixel = glm::vec3(pixels[i]);
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        ax += a * pixel;
+        bx += b * pixel;
+    }
+
+    const auto determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f) {
+        return false;
+    }
+    c0 = packRGB565((ax * bb - bx * ab) / determinant);
+    c1 = packRGB565((bx * aa - ax * ab) / determinant);
+    return true;
+}
+
+void encodeBC1Block(const glm::u8vec4 pixels[16], unsigned char * dst)
+{
+    glm::vec3 colors[16];
+    glm::vec3 mean(0.f), colorMin(255.f), colorMax(0.f);
+    for (size_t i = 0; i < 16; ++i)
+    {
+        colors[i] = glm::vec3(pixels[i]);
+        mean += colors[i];
+        colorMin = glm::min(colorMin, colors[i]);
+        colorMax = glm::max(colorMax, colors[i]);
+    }
+    mean /= 16.f;
+
+    BC1Fit best;
+    if (colorMin == colorMax) {
+        best = fitBC1Indices(pixels, packRGB565(mean), packRGB565(mean));
+    }
+    else
+    {
+        // Principal axis of the colors by power iteration on their covariance, starting from the diagonal of their bounding box
+        glm::mat3 covariance(0.f);
+        for (size_t i = 0; i < 16; ++i)
+        {
+            const auto d = colors[i] - mean;
+            covariance += glm::outerProduct(d, d);
+        }
+        auto axis = colorMax - colorMin;
+        for (size_t iteration = 0; iteration < 4; ++iteration)
+        {
+            const auto next = covariance * axis;
+            const auto length = glm::length(next);
+            if (length < 1e-6f) {
+                break;
+            }
+            axis = next / length;
+        }
+
+        size_t first = 0, last = 0;
+        auto tMin = std::numeric_limits<float>::max(), tMax = std::numeric_limits<float>::lowest();
+        for (size_t i = 0; i < 16; ++i)
+        {
+            const auto t = glm::dot(colors[i], axis);
+            if (t < tMin)
+            {
+                tMin = t;
+                first = i;
+            }
+            if (t > tMax)
+            {
+                tMax = t;
+                last = i;
+            }
+        }
+
+        best = fitBC1Indices(pixels, packRGB565(colors[last]), packRGB565(colors[first]));
+        for (size_t iteration = 0; iteration < 2 && best.error > 0; ++iteration)
+        {
+            uint16_t c0, c1;
+            if (!refineBC1Endpoints(pixels, best, c0, c1)) {
+                break;
+            }
+            const auto refined = fitBC1Indices(pixels, c0, c1);
+            if (refined.error >= best.error) {
+                break;
+            }
+            best = refined;
+        }
+    }
+
+    uint32_t indices = 0;
+    for (size_t i = 0; i < 16; ++i) {
+        indices |= uint32_t(best.indices[i]) << (2 * i);
+    }
+    std::memcpy(dst, &best.c0, 2);
+    std::memcpy(dst + 2, &best.c1, 2);
+    std::memcpy(dst + 4, &indices, 4);
+}
+
+void decodeBC1Block(const unsigned char * src, bool fourColors, glm::u8vec4 pixels[16])
+{
+    uint16_t c0, c1;
+    uint32_t indices;
+    std::memcpy(&c0, src, 2);
+    std::memcpy(&c1, src + 2, 2);
+    std::memcpy(&indices, src + 4, 4);
+
+    glm::ivec4 palette[4];
+    decodeBC1Palette(c0, c1, fourColors, palette);
+    for (size_t i = 0; i < 16; ++i) {
+        pixels[i] = glm::u8vec4(palette[(indices >> (2 * i)) & 3]);
+    }
+}
+
+// a0 > a1: eight values interpolated between the endpoints; otherwise six values, 0 and 255
+void decodeBC4Palette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (auto i = 2; i < 8; ++i) {
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+        }
+    }
+    else
+    {
+        for (auto i = 2; i < 6; ++i) {
+            palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// Encode the channel of the pixels with eight values between its extrema
+void encodeBC4Block(const glm::u8vec4 pixels[16], size_t channel, unsigned char * dst)
+{
+    int valueMin = 255, valueMax = 0;
+    for (size_t i = 0; i < 16; ++i)
+    {
+        valueMin = std::min(valueMin, int(pixels[i][channel]));
+        valueMax = std::max(valueMax, int(pixels[i][channel]));
+    }
+
+    uint64_t indices = 0;
+    if (valueMax > valueMin)
+    {
+        int palette[8];
+        decodeBC4Palette(valueMax, valueMin, palette);
+        for (size_t i = 0; i < 16; ++i)
+        {
+            const auto value = int(pixels[i][channel]);
+            uint64_t bestIndex = 0;
+            auto bestError = std::numeric_limits<int>::max();
+            for (auto p = 0; p < 8; ++p)
+            {
+                const auto error = std::abs(value - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = uint64_t(p);
+                }
+            }
+            indices |= bestIndex << (3 * i);
+        }
+    }
+
+    dst[0] = (unsigned char) valueMax;
+    dst[1] = (unsigned char) valueMin;
+    for (size_t i = 0; i < 6; ++i) {
+        dst[2 + i] = (unsigned char) (indices >> (8 * i));
+    }
+}
+
+void decodeBC4Block(const unsigned char * src, size_t channel, glm::u8vec4 pixels[16])
+{
+    int palette[8];
+    decodeBC4Palette(src[0], src[1], palette);
+    uint64_t indices = 0;
+    for (size_t i = 0; i < 6; ++i) {
+        indices |= uint64_t(src[2 + i]) << (8 * i);
+    }
+    for (size_t i = 0; i < 16; ++i) {
+        pixels[i][channel] = uint8_t(palette[(indices >> (3 * i)) & 7]);
+    }
+}
+
+// Layout of the header following the "DDS " magic number
+struct DDSPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t bitMasks[4];
+};
+
+struct DDSHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps[4];
+    uint32_t reserved2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+const char DDSMagic[4] = { 'D', 'D', 'S', ' ' };
+
+const uint32_t DDSD_CAPS = 0x1;
+const uint32_t DDSD_HEIGHT = 0x2;
+const uint32_t DDSD_WIDTH = 0x4;
+const uint32_t DDSD_PIXELFORMAT = 0x1000;
+const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+const uint32_t DDSD_LINEARSIZE = 0x80000;
+const uint32_t DDPF_FOURCC = 0x4;
+const uint32_t DDSCAPS_COMPLEX = 0x8;
+const uint32_t DDSCAPS_TEXTURE = 0x1000;
+const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+constexpr uint32_t makeFourCC(char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
+
+uint32_t getFourCC(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        return makeFourCC('D', 'X', 'T', '1');
+    case BlockFormat::BC3:
+        return makeFourCC('D', 'X', 'T', '5');
+    default:
+        return makeFourCC('A', 'T', 'I', '2');
+    }
+}
+
+}
+
+BlockFormat chooseBlockFormat(const Image2DRGBA & image)
+{
+    for (size_t i = 0; i < image.size(); ++i)
+    {
+        if (image.data()[i * Image2DRGBA::NumComponents + 3] != 255) {
+            return BlockFormat::BC3;
+        }
+    }
+    return BlockFormat::BC1;
+}
+
+CompressedImage2D compressImage(const Image2DRGBA & image, BlockFormat format, size_t threadCount)
+{
+    CompressedImage2D result;
+    result.format = format;
+    result.width = image.width();
+    result.height = image.height();
+    if (!image.size()) {
+        return result;
+    }
+
+    const auto rowSize = result.blockCountX() * blockSize(format);
+    result.data.resize(result.blockCountY() * rowSize);
+
+    parallelFor(result.blockCountY(), [&](size_t blockY)
+    {
+        glm::u8vec4 pixels[16];
+        auto dst = result.data.data() + blockY * rowSize;
+        for (size_t blockX = 0; blockX < result.blockCountX(); ++blockX, dst += blockSize(format))
+        {
+            loadBlock(image, blockX, blockY, pixels);
+            switch (format)
+            {
+            case BlockFormat::BC1:
+                encodeBC1Block(pixels, dst);
+                break;
+            case BlockFormat::BC3:
+                encodeBC4Block(pixels, 3, dst);
+                encodeBC1Block(pixels, dst + 8);
+                break;
+            case BlockFormat::BC5:
+                encodeBC4Block(pixels, 0, dst);
+                encodeBC4Block(pixels, 1, dst + 8);
+                break;
+            }
+        }
+    }, threadCount);
+
+    return result;
+}
+
+CompressedImage2D compressImageWithMipmaps(const Image2DRGBA & image, BlockFormat format, bool sRGB, size_t threadCount)
+{
+    auto result = compressImage(image, format, threadCount);
+    for (const auto & level : generateMipmaps(image, sRGB, threadCount))
+    {
+        const auto compressedLevel = compressImage(level, format, threadCount);
+        result.data.insert(end(result.data), begin(compressedLevel.data), end(compressedLevel.data));
+        ++result.levelCount;
+    }
+    return result;
+}
+
+Image2DRGBA decompressImage(const CompressedImage2D & image, size_t level)
+{
+    if (!image.width || !image.height) {
+        return Image2DRGBA();
+    }
+    Image2DRGBA result(image.levelWidth(level), image.levelHeight(level));
+
+    const auto rowSize = image.blockCountX(level) * blockSize(image.format);
+    parallelFor(image.blockCountY(level), [&](size_t blockY)
+    {
+        glm::u8vec4 pixels[16];
+        auto src = image.levelData(level) + blockY * rowSize;
+        for (size_t blockX = 0; blockX < image.blockCountX(level); ++blockX, src += blockSize(image.format))
+        {
+            switch (image.format)
+            {
+            case BlockFormat::BC1:
+                decodeBC1Block(src, false, pixels);
+                break;
+            case BlockFormat::BC3:
+                decodeBC1Block(src + 8, true, pixels);
+                decodeBC4Block(src, 3, pixels);
+                break;
+            case BlockFormat::BC5:
+                std::fill(pixels, pixels + 16, glm::u8vec4(0, 0, 0, 255));
+                decodeBC4Block(src, 0, pixels);
+                decodeBC4Block(src + 8, 1, pixels);
+                break;
+            }
+            storeBlock(pixels, blockX, blockY, result);
+        }
+    });
+
+    return result;
+}
+
+double computePSNR(const Image2DRGBA & reference, const Image2DRGBA & image, size_t channelCount)
+{
+    if (reference.width() != image.width() || reference.height() != image.height())
+    {
+        std::cerr << "Unable to compute PSNR of images of different sizes" << std::endl;
+        throw std::runtime_error("Unable to compute PSNR of images of different sizes");
+    }
+
+    double squaredError = 0.;
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+        for (size_t c = 0; c < channelCount; ++c)
+        {
+            const auto difference = double(reference.data()[i * Image2DRGBA::NumComponents + c]) - double(image.data()[i * Image2DRGBA::NumComponents + c]);
+            squaredError += difference * difference;
+        }
+    }
+    if (squaredError == 0.) {
+        return std::numeric_limits<double>::infinity();
+    }
+    const auto meanSquaredError = squaredError / double(reference.size() * channelCount);
+    return 10. * std::log10(255. * 255. / meanSquaredError);
+}
+
+void writeDDS(const CompressedImage2D & image, const fs::path & path)
+{
+    DDSHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | (image.levelCount > 1 ? DDSD_MIPMAPCOUNT : 0);
+    header.height = uint32_t(image.height);
+    header.width = uint32_t(image.width);
+    header.pitchOrLinearSize = uint32_t(image.levelSize(0));
+    header.mipMapCount = uint32_t(image.levelCount);
+    header.pixelFormat.size = sizeof(DDSPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    header.pixelFormat.fourCC = getFourCC(image.format);
+    header.caps[0] = DDSCAPS_TEXTURE | (image.levelCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+    std::ofstream output(path.string(), std::ios::binary | std::ios::trunc);
+    if (!output || !output.write(DDSMagic, sizeof(DDSMagic)) || !output.write((const char *) &header, sizeof(header)) ||
+        !output.write((const char *) image.data.data(), image.data.size()))
+    {
+        std::cerr << "Unable to write DDS file " << path << std::endl;
+        throw std::runtime_error("Unable to write DDS file " + path.string());
+    }
+}
+
+CompressedImage2D readDDS(const fs::path & path)
+{
+    const auto onFailure = [&](const std::string & reason)
+    {
+        std::cerr << "Unable to read DDS file " << path << ": " << reason << std::endl;
+        throw std::runtime_error("Unable to read DDS file " + path.string() + ": " + reason);
+    };
+
+    const MappedFile file(path);
+    DDSHeader header;
+    if (file.size() < sizeof(DDSMagic) + sizeof(header) || std::memcmp(file.data(), DDSMagic, sizeof(DDSMagic))) {
+        onFailure("invalid header");
+    }
+    std::memcpy(&header, file.data() + sizeof(DDSMagic), sizeof(header));
+    if (header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPF_FOURCC)) {
+        onFailure("invalid header");
+    }
+
+    CompressedImage2D image;
+    const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5 };
+    const auto format = std::find_if(std::begin(formats), std::end(formats), [&](BlockFormat format) { return getFourCC(format) == header.pixelFormat.fourCC; });
+    if (format == std::end(formats)) {
+        onFailure("unsupported format");
+    }
+    image.format = *format;
+    image.width = header.width;
+    image.height = header.height;
+    image.levelCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount ? header.mipMapCount : 1;
+    if (image.levelCount > computeMipLevelCount(image.width, image.height)) {
+        onFailure("invalid mip level count");
+    }
+
+    const auto dataSize = image.levelOffset(image.levelCount);
+    if (file.size() - sizeof(DDSMagic) - sizeof(header) < dataSize) {
+        onFailure("truncated file");
+    }
+    const auto data = file.data() + sizeof(DDSMagic) + sizeof(header);
+    image.data.assign(data, data + dataSize);
+
+    return image;
+}
+
+}